@@ -0,0 +1,178 @@
+#!/usr/bin/env bash
+#
+# Partial overwrites of erasure coded objects that update the parity from
+# the change to the data (osd_ec_parity_delta_writes): read back, degraded
+# reads and rollback of an overwrite that did not reach every shard.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7155" # git grep '\<7155\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+    CEPH_ARGS+="--osd_ec_parity_delta_writes=true "
+    export poolname=ecpool
+    export objname=SOMETHING
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+# k=4 m=2 with 4K chunks: a 4K overwrite inside one chunk reads and writes
+# one data shard and the two parity shards
+function setup_cluster() {
+    local dir=$1
+    shift
+
+    run_mon $dir a || return 1
+    run_mgr $dir x || return 1
+    for id in $(seq 0 5) ; do
+        run_osd $dir $id || return 1
+    done
+    ceph osd set noout || return 1
+
+    ceph osd erasure-code-profile set myprofile \
+        "$@" k=4 m=2 stripe_unit=4K \
+        crush-failure-domain=osd || return 1
+    create_pool $poolname 1 1 erasure myprofile || return 1
+    ceph osd pool set $poolname allow_ec_overwrites true || return 1
+    ceph osd pool set $poolname min_size 4 || return 1
+    wait_for_clean || return 1
+
+    # four stripes
+    dd if=/dev/urandom of=$dir/EXPECTED bs=4096 count=16 || return 1
+    rados --pool $poolname put $objname $dir/EXPECTED || return 1
+}
+
+function check_read() {
+    local dir=$1
+
+    rados --pool $poolname get $objname $dir/COPY || return 1
+    cmp $dir/EXPECTED $dir/COPY || return 1
+    rm $dir/COPY
+}
+
+function used_parity_delta() {
+    local dir=$1
+    local primary=$(get_primary $poolname $objname)
+
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path osd.$primary) \
+        log flush || return 1
+    grep -q "parity delta update for .*:::$objname:head" \
+        $dir/osd.$primary.log || return 1
+}
+
+# overwrite 4K in the second chunk of the second stripe
+function overwrite() {
+    local dir=$1
+    local offset=$((4 * 4096 + 4096))
+
+    dd if=/dev/urandom of=$dir/PATCH bs=4096 count=1 || return 1
+    rados --pool $poolname put $objname $dir/PATCH --offset $offset || return 1
+    dd if=$dir/PATCH of=$dir/EXPECTED bs=4096 seek=5 conv=notrunc || return 1
+}
+
+# read with each shard down in turn, then with the overwritten data
+# shard and a parity shard down so the data is decoded from the other
+# parity
+function degraded_reads() {
+    local dir=$1
+    local -a osds=($(get_osds $poolname $objname))
+
+    for osd in ${osds[@]} "${osds[1]} ${osds[4]}" ; do
+        for id in $osd ; do
+            kill_daemons $dir TERM osd.$id || return 1
+            ceph osd down osd.$id || return 1
+        done
+        check_read $dir || return 1
+        for id in $osd ; do
+            activate_osd $dir $id || return 1
+        done
+        wait_for_clean || return 1
+    done
+}
+
+function parity_delta_overwrite() {
+    local dir=$1
+
+    overwrite $dir || return 1
+    used_parity_delta $dir || return 1
+    check_read $dir || return 1
+    degraded_reads $dir || return 1
+}
+
+function TEST_parity_delta_overwrite_jerasure() {
+    local dir=$1
+
+    setup_cluster $dir plugin=jerasure technique=reed_sol_van || return 1
+    parity_delta_overwrite $dir || return 1
+}
+
+function TEST_parity_delta_overwrite_isa() {
+    if ! erasure_code_plugin_exists isa ; then
+        echo "SKIP because plugin isa has not been built"
+        return 0
+    fi
+    local dir=$1
+
+    setup_cluster $dir plugin=isa || return 1
+    parity_delta_overwrite $dir || return 1
+}
+
+# An overwrite that one shard never got is rolled back on the shards
+# that applied it once the shard is back, because erasure coded pools
+# take the oldest log as authoritative.
+function TEST_parity_delta_rollback() {
+    local dir=$1
+
+    setup_cluster $dir plugin=jerasure technique=reed_sol_van || return 1
+    local -a osds=($(get_osds $poolname $objname))
+
+    # shard 3 is neither read nor modified by the overwrite, but has to
+    # commit it
+    kill -STOP $(cat $dir/osd.${osds[3]}.pid)
+    dd if=/dev/urandom of=$dir/PATCH bs=4096 count=1 || return 1
+    rados --pool $poolname put $objname $dir/PATCH --offset $((5 * 4096)) &
+    local pid=$!
+    sleep 5
+    used_parity_delta $dir || return 1
+
+    # Use SIGKILL so the stopped osd terminates too, and drop the client
+    # so it does not resend the write
+    kill_daemons $dir KILL osd || return 1
+    kill $pid
+    wait
+
+    for osd in ${osds[@]} ; do
+        activate_osd $dir $osd || return 1
+    done
+    wait_for_clean || return 1
+
+    check_read $dir || return 1
+    degraded_reads $dir || return 1
+}
+
+main test-erasure-parity-delta "$@"
+
+# Local Variables:
+# compile-command: "cd ../../../build ; make -j4 && ../qa/run-standalone.sh test-erasure-parity-delta.sh"
+# End:
@@ -0,0 +1,87 @@
+#!/usr/bin/env bash
+#
+# Idle op shard threads helping a busy shard (osd_op_shard_work_stealing):
+# at most one helper per shard, and the ops of a PG still complete in
+# order.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7158" # git grep '\<7158\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+    # a single thread per shard, so that one busy pg keeps its shard busy
+    CEPH_ARGS+="--osd_op_queue=wpq "
+    CEPH_ARGS+="--osd_op_num_shards=4 "
+    CEPH_ARGS+="--osd_op_num_threads_per_shard=1 "
+    CEPH_ARGS+="--osd_op_shard_work_stealing=true "
+    export poolname=test
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+function pq_state() {
+    CEPH_ARGS='' ceph --admin-daemon $(get_asok_path osd.0) dump_op_pq_state
+}
+
+function TEST_work_stealing() {
+    local dir=$1
+
+    run_mon $dir a --osd_pool_default_size=1 || return 1
+    run_mgr $dir x || return 1
+    run_osd $dir 0 || return 1
+    # all the ops go to the shard of the only pg
+    create_pool $poolname 1 1 || return 1
+    wait_for_clean || return 1
+
+    # concurrent writes to a few objects; ceph_test_rados aborts if the
+    # writes to an object complete out of order
+    ceph_test_rados --pool $poolname --max-ops 4000 --objects 8 \
+        --max-in-flight 64 --size 65536 --min-stride-size 4096 \
+        --max-stride-size 16384 --no-omap \
+        --op write 50 --op append 25 --op read 25 \
+        > $dir/test_rados.log 2>&1 &
+    local pid=$!
+
+    local max_helpers=0
+    while kill -0 $pid 2> /dev/null ; do
+        local helpers=$(pq_state | jq '[.[] | .utilization.helpers] | max')
+        if [ "$helpers" -gt "$max_helpers" ]; then
+            max_helpers=$helpers
+        fi
+        sleep 0.1
+    done
+    wait $pid || return 1
+
+    # one helper per shard at most...
+    test $max_helpers -le 1 || return 1
+    # ... but there was one
+    local stolen=$(pq_state | jq '[.[] | .utilization.stolen] | add')
+    test $stolen -gt 0 || return 1
+}
+
+main osd-work-stealing "$@"
+
+# Local Variables:
+# compile-command: "cd ../../../build ; make -j4 && ../qa/run-standalone.sh osd-work-stealing.sh"
+# End:
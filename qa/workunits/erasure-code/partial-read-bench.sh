@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+#
+# 4K random read IOPS from an RBD image on a k=8 m=3 erasure coded data
+# pool, with and without osd_ec_partial_reads.
+#
+# Needs at least 11 OSDs (the profile spreads chunks over OSDs, not
+# hosts).  Against a vstart cluster:
+#
+#  MON=1 OSD=11 MDS=0 ../src/vstart.sh -n -x
+#  ../qa/workunits/erasure-code/partial-read-bench.sh
+#
+# Environment:
+#  IMAGE_SIZE   size of the image that is written then read (default 1G)
+#  READ_TOTAL   bytes read per run (default 256M)
+#  THREADS      concurrent ios (default 16)
+
+set -ex
+
+IMAGE_SIZE=${IMAGE_SIZE:-1G}
+READ_TOTAL=${READ_TOTAL:-256M}
+THREADS=${THREADS:-16}
+
+PROFILE=partial-read-bench
+DATA_POOL=partial-read-bench-data
+META_POOL=partial-read-bench-meta
+IMAGE=$META_POOL/img
+
+function cleanup() {
+    rbd rm $IMAGE || true
+    ceph osd pool rm $META_POOL $META_POOL --yes-i-really-really-mean-it || true
+    ceph osd pool rm $DATA_POOL $DATA_POOL --yes-i-really-really-mean-it || true
+    ceph osd erasure-code-profile rm $PROFILE || true
+    ceph config rm osd osd_ec_partial_reads || true
+}
+trap cleanup EXIT
+
+ceph osd erasure-code-profile set $PROFILE k=8 m=3 crush-failure-domain=osd
+ceph osd pool create $DATA_POOL 32 32 erasure $PROFILE
+ceph osd pool set $DATA_POOL allow_ec_overwrites true
+ceph osd pool create $META_POOL 8
+rbd pool init $META_POOL
+
+rbd create --size $IMAGE_SIZE --data-pool $DATA_POOL $IMAGE
+rbd bench --io-type write --io-size 4M --io-pattern seq \
+    --io-total $IMAGE_SIZE $IMAGE
+
+for partial in false true ; do
+    ceph config set osd osd_ec_partial_reads $partial
+    # let the setting reach the osds
+    sleep 5
+    set +x
+    echo "osd_ec_partial_reads=$partial"
+    rbd bench --io-type read --io-size 4K --io-pattern rand \
+        --io-threads $THREADS --io-total $READ_TOTAL $IMAGE | tail -n 1
+    set -x
+done
@@ -23,6 +23,9 @@ int ceph_arch_intel_ssse3 = 0;
 int ceph_arch_intel_sse3 = 0;
 int ceph_arch_intel_sse2 = 0;
 int ceph_arch_intel_aesni = 0;
+int ceph_arch_intel_avx2 = 0;
+int ceph_arch_intel_avx512f = 0;
+int ceph_arch_intel_avx512bw = 0;
 
 #ifdef __x86_64__
 #include <cpuid.h>
@@ -36,6 +39,24 @@ int ceph_arch_intel_aesni = 0;
 #define CPUID_SSE3	(1)
 #define CPUID_SSE2	(1 << 26)
 #define CPUID_AESNI (1 << 25)
+#define CPUID_OSXSAVE	(1 << 27)
+#define CPUID_AVX	(1 << 28)
+
+/* leaf 7, ebx */
+#define CPUID7_AVX2	(1 << 5)
+#define CPUID7_AVX512F	(1 << 16)
+#define CPUID7_AVX512BW	(1 << 30)
+
+/* XCR0: the OS saves and restores these register states */
+#define XCR0_YMM	0x06
+#define XCR0_ZMM	0xe6
+
+static unsigned long long xgetbv0(void)
+{
+	unsigned int lo, hi;
+	__asm__ __volatile__ ("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+	return ((unsigned long long)hi << 32) | lo;
+}
 
 int ceph_arch_intel_probe(void)
 {
@@ -65,6 +86,23 @@ int ceph_arch_intel_probe(void)
   if ((ecx & CPUID_AESNI) != 0) {
           ceph_arch_intel_aesni = 1;
   }
+	if ((ecx & CPUID_OSXSAVE) != 0 && (ecx & CPUID_AVX) != 0) {
+		unsigned long long xcr0 = xgetbv0();
+		if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+			if ((xcr0 & XCR0_YMM) == XCR0_YMM &&
+			    (ebx & CPUID7_AVX2) != 0) {
+				ceph_arch_intel_avx2 = 1;
+			}
+			if ((xcr0 & XCR0_ZMM) == XCR0_ZMM &&
+			    (ebx & CPUID7_AVX512F) != 0) {
+				ceph_arch_intel_avx512f = 1;
+			}
+			if ((xcr0 & XCR0_ZMM) == XCR0_ZMM &&
+			    (ebx & CPUID7_AVX512BW) != 0) {
+				ceph_arch_intel_avx512bw = 1;
+			}
+		}
+	}
 
 	return 0;
 }
@@ -12,6 +12,9 @@ extern int ceph_arch_intel_ssse3;  /* true if we have ssse 3 features */
 extern int ceph_arch_intel_sse3;   /* true if we have sse 3 features */
 extern int ceph_arch_intel_sse2;   /* true if we have sse 2 features */
 extern int ceph_arch_intel_aesni;  /* true if we have aesni features */
+extern int ceph_arch_intel_avx2;   /* true if we have avx2 features */
+extern int ceph_arch_intel_avx512f; /* true if we have avx512f features */
+extern int ceph_arch_intel_avx512bw; /* true if we have avx512bw features */
 
 extern int ceph_arch_intel_probe(void);
 
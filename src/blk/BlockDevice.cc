@@ -35,6 +35,10 @@
 #include "zoned/HMSMRDevice.h"
 #endif
 
+#if defined(HAVE_NVME_EMU)
+#include "nvme_emu/NVMeEmuDevice.h"
+#endif
+
 #include "common/debug.h"
 #include "common/EventTrace.h"
 #include "common/errno.h"
@@ -85,7 +89,7 @@ uint64_t IOContext::get_num_ios() const
 #if defined(HAVE_LIBAIO) || defined(HAVE_POSIXAIO)
   ios += pending_aios.size();
 #endif
-#ifdef HAVE_SPDK
+#if defined(HAVE_SPDK) || defined(HAVE_NVME_EMU)
   ios += total_nseg;
 #endif
   return ios;
@@ -147,6 +151,12 @@ BlockDevice::device_type_from_name(const std::string& blk_dev_name)
   if (blk_dev_name == "hm_smr") {
     return block_device_t::hm_smr;
   }
+#endif
+#if defined(HAVE_NVME_EMU)
+  // never detected, only used when asked for
+  if (blk_dev_name == "nvme_emu") {
+    return block_device_t::nvme_emu;
+  }
 #endif
   return block_device_t::unknown;
 }
@@ -172,6 +182,10 @@ BlockDevice* BlockDevice::create_with_type(block_device_t device_type,
 #if (defined(HAVE_LIBAIO) || defined(HAVE_POSIXAIO)) && defined(HAVE_LIBZBD)
   case block_device_t::hm_smr:
     return new HMSMRDevice(cct, cb, cbpriv, d_cb, d_cbpriv);
+#endif
+#if defined(HAVE_NVME_EMU)
+  case block_device_t::nvme_emu:
+    return new NVMeEmuDevice(cct, cb, cbpriv);
 #endif
   default:
     ceph_abort_msg("unsupported device");
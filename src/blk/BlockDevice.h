@@ -85,7 +85,7 @@ private:
 public:
   CephContext* cct;
   void *priv;
-#ifdef HAVE_SPDK
+#if defined(HAVE_SPDK) || defined(HAVE_NVME_EMU)
   void *nvme_task_first = nullptr;
   void *nvme_task_last = nullptr;
   std::atomic_int total_nseg = {0};
@@ -164,6 +164,9 @@ private:
 #endif
 #if defined(HAVE_BLUESTORE_PMEM)
     pmem,
+#endif
+#if defined(HAVE_NVME_EMU)
+    nvme_emu,
 #endif
   };
   static block_device_t detect_device_type(const std::string& path);
@@ -0,0 +1,626 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+
+#include "include/intarith.h"
+#include "include/stringify.h"
+#include "include/compat.h"
+#include "common/blkdev.h"
+#include "common/debug.h"
+#include "common/errno.h"
+#include "common/Thread.h"
+
+#include "NVMeEmuDevice.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bdev
+#undef dout_prefix
+#define dout_prefix *_dout << "bdev(" << this << " " << path << ") "
+
+using std::string;
+
+using ceph::bufferlist;
+using ceph::bufferptr;
+
+// same split as NVMEDevice
+static constexpr uint64_t split_size = 131072; // 128KB.
+
+enum class EmuOp {
+  READ,
+  WRITE,
+};
+
+struct EmuCommand {
+  EmuOp op;
+  IOContext *ctx;
+  uint64_t offset;
+  uint64_t len;
+  bufferlist bl;            ///< write payload
+  char *buf = nullptr;      ///< read destination
+  uint64_t buf_off = 0;     ///< where in [offset, offset+len) buf starts
+  uint64_t buf_len = 0;     ///< how much of it buf wants
+  EmuCommand *next = nullptr;
+  int rval = 0;
+
+  EmuCommand(EmuOp op, IOContext *ctx, uint64_t off, uint64_t len)
+    : op(op), ctx(ctx), offset(off), len(len) {}
+};
+
+/*
+ * One submission/completion queue pair.  The owning thread is the only
+ * producer on sq and the only consumer of cq; controller threads do the
+ * opposite.
+ */
+class NVMeEmuQueuePair {
+public:
+  ceph::mutex lock = ceph::make_mutex("NVMeEmuQueuePair::lock");
+  std::deque<EmuCommand*> sq;
+  std::vector<EmuCommand*> cq;
+  uint32_t inflight = 0;    ///< owner thread only
+  std::atomic_bool owner_exited = {false};
+
+  EmuCommand *take() {
+    std::lock_guard l(lock);
+    if (sq.empty()) {
+      return nullptr;
+    }
+    EmuCommand *c = sq.front();
+    sq.pop_front();
+    return c;
+  }
+  void complete(EmuCommand *c) {
+    std::lock_guard l(lock);
+    cq.push_back(c);
+  }
+};
+
+/*
+ * Marks the queue pairs of a submitting thread as unowned when it exits,
+ * so that the device can free them.  Queue pairs freed by the device
+ * first are simply gone by then.
+ */
+struct NVMeEmuQueuePairOwner {
+  std::vector<std::weak_ptr<NVMeEmuQueuePair>> qpairs;
+  ~NVMeEmuQueuePairOwner() {
+    for (auto& w : qpairs) {
+      if (auto qp = w.lock()) {
+	qp->owner_exited = true;
+      }
+    }
+  }
+};
+static thread_local NVMeEmuQueuePairOwner qpair_owner;
+
+static void ioc_append_cmd(IOContext *ioc, EmuCommand *c)
+{
+  EmuCommand *last = static_cast<EmuCommand*>(ioc->nvme_task_last);
+  if (last)
+    last->next = c;
+  if (!ioc->nvme_task_first)
+    ioc->nvme_task_first = c;
+  ioc->nvme_task_last = c;
+  ++ioc->num_pending;
+  ++ioc->total_nseg;
+}
+
+NVMeEmuDevice::NVMeEmuDevice(CephContext* cct, aio_callback_t cb, void *cbpriv)
+  : BlockDevice(cct, cb, cbpriv)
+{
+}
+
+NVMeEmuDevice::~NVMeEmuDevice()
+{
+  ceph_assert(controller_threads.empty());
+}
+
+int NVMeEmuDevice::open(const string& p)
+{
+  path = p;
+  dout(1) << __func__ << " path " << path << dendl;
+
+  int r;
+  fd = ::open(path.c_str(), O_RDWR | O_DIRECT | O_CLOEXEC);
+  direct = fd >= 0;
+  if (fd < 0 && errno == EINVAL) {
+    // e.g. tmpfs
+    dout(1) << __func__ << " O_DIRECT not supported, using buffered io"
+	    << dendl;
+    fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    r = -errno;
+    derr << __func__ << " open got: " << cpp_strerror(r) << dendl;
+    return r;
+  }
+
+  if (lock_exclusive) {
+    if (::flock(fd, LOCK_EX | LOCK_NB) < 0) {
+      r = -errno;
+      derr << __func__ << " failed to lock " << path << ": "
+	   << cpp_strerror(r) << dendl;
+      goto out_fail;
+    }
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) < 0) {
+    r = -errno;
+    derr << __func__ << " fstat got " << cpp_strerror(r) << dendl;
+    goto out_fail;
+  }
+  if (S_ISBLK(st.st_mode)) {
+    BlkDev blkdev(fd);
+    int64_t s;
+    r = blkdev.get_size(&s);
+    if (r < 0) {
+      goto out_fail;
+    }
+    size = s;
+  } else {
+    size = st.st_size;
+  }
+
+  block_size = cct->_conf->bdev_block_size;
+  // round size down to an even block
+  size &= ~(block_size - 1);
+  rotational = false;
+  support_discard = false;
+
+  queue_depth = cct->_conf.get_val<uint64_t>("bdev_nvme_emu_queue_depth");
+  io_sleep_us = cct->_conf.get_val<uint64_t>("bdev_nvme_emu_io_sleep");
+  {
+    auto n = cct->_conf.get_val<uint64_t>("bdev_nvme_emu_controller_threads");
+    ceph_assert(n > 0);
+    ceph_assert(queue_depth > 0);
+    for (unsigned i = 0; i < n; ++i) {
+      controller_threads.push_back(
+	make_named_thread("bstore_nvme_emu",
+			  &NVMeEmuDevice::_controller_entry, this, i));
+    }
+  }
+
+  dout(1) << __func__
+	  << " size " << size << " (0x" << std::hex << size << std::dec << ", "
+	  << byte_u_t(size) << ")"
+	  << " block_size " << block_size << " (" << byte_u_t(block_size)
+	  << ")"
+	  << " queue_depth " << queue_depth
+	  << " controller_threads " << controller_threads.size()
+	  << (direct ? " direct" : " buffered")
+	  << dendl;
+  return 0;
+
+ out_fail:
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  fd = -1;
+  return r;
+}
+
+void NVMeEmuDevice::close()
+{
+  dout(1) << __func__ << dendl;
+  {
+    std::lock_guard l(sq_lock);
+    stopping = true;
+    sq_cond.notify_all();
+  }
+  for (auto& t : controller_threads) {
+    t.join();
+  }
+  controller_threads.clear();
+  stopping = false;
+  {
+    std::unique_lock l(qpair_lock);
+    for (auto& [id, qp] : qpairs) {
+      ceph_assert(qp->sq.empty());
+      ceph_assert(qp->cq.empty());
+    }
+    qpairs.clear();
+  }
+  ceph_assert(fd >= 0);
+  VOID_TEMP_FAILURE_RETRY(::close(fd));
+  fd = -1;
+  path.clear();
+}
+
+int NVMeEmuDevice::collect_metadata(const string& prefix,
+				    std::map<string,string> *pm) const
+{
+  (*pm)[prefix + "rotational"] = "0";
+  (*pm)[prefix + "size"] = stringify(get_size());
+  (*pm)[prefix + "block_size"] = stringify(get_block_size());
+  (*pm)[prefix + "driver"] = "NVMeEmuDevice";
+  (*pm)[prefix + "type"] = "nvme_emu";
+  (*pm)[prefix + "access_mode"] = direct ? "emulated_direct" : "emulated";
+  (*pm)[prefix + "path"] = path;
+  return 0;
+}
+
+NVMeEmuQueuePair *NVMeEmuDevice::_get_qpair()
+{
+  auto id = std::this_thread::get_id();
+  {
+    std::shared_lock l(qpair_lock);
+    auto p = qpairs.find(id);
+    if (p != qpairs.end() && !p->second->owner_exited) {
+      return p->second.get();
+    }
+  }
+  std::unique_lock l(qpair_lock);
+  // an exited thread was done with its queue pair when it last returned
+  // from aio_submit(), and its id may have been reused by this one
+  for (auto p = qpairs.begin(); p != qpairs.end();) {
+    if (p->second->owner_exited) {
+      ceph_assert(p->second->sq.empty());
+      ceph_assert(p->second->cq.empty());
+      p = qpairs.erase(p);
+    } else {
+      ++p;
+    }
+  }
+  auto& qp = qpairs[id];
+  if (!qp) {
+    qp = std::make_shared<NVMeEmuQueuePair>();
+    std::erase_if(qpair_owner.qpairs, [](auto& w) { return w.expired(); });
+    qpair_owner.qpairs.push_back(qp);
+    dout(10) << __func__ << " new queue pair, " << qpairs.size()
+	     << " total" << dendl;
+  }
+  return qp.get();
+}
+
+void NVMeEmuDevice::_controller_entry(unsigned id)
+{
+  dout(10) << __func__ << " " << id << " start" << dendl;
+  // round robin arbitration over the submission queues; each thread
+  // starts at a different queue so they don't all fight over the first
+  size_t start = id;
+  while (true) {
+    {
+      std::unique_lock l(sq_lock);
+      sq_cond.wait(l, [this] { return stopping || sq_queued > 0; });
+      if (stopping) {
+	break;
+      }
+    }
+    EmuCommand *c = nullptr;
+    NVMeEmuQueuePair *qp = nullptr;
+    {
+      std::shared_lock l(qpair_lock);
+      size_t n = qpairs.size();
+      if (n) {
+	auto p = qpairs.begin();
+	std::advance(p, start % n);
+	for (size_t i = 0; i < n && !c; ++i) {
+	  qp = p->second.get();
+	  c = qp->take();
+	  if (++p == qpairs.end()) {
+	    p = qpairs.begin();
+	  }
+	}
+	++start;
+      }
+    }
+    if (!c) {
+      // another controller thread got there first
+      continue;
+    }
+    {
+      std::lock_guard l(sq_lock);
+      --sq_queued;
+    }
+    c->rval = execute((int)c->op, c->offset, c->len, c->bl,
+		      c->buf, c->buf_off, c->buf_len);
+    qp->complete(c);
+  }
+  dout(10) << __func__ << " " << id << " finish" << dendl;
+}
+
+int NVMeEmuDevice::execute(int op, uint64_t off, uint64_t len, bufferlist& bl,
+			   char *buf, uint64_t buf_off, uint64_t buf_len)
+{
+  if ((EmuOp)op == EmuOp::WRITE) {
+    std::vector<iovec> iov;
+    bl.prepare_iov(&iov);
+    size_t idx = 0;
+    uint64_t left = len;
+    while (left) {
+      ssize_t r = ::pwritev(fd, &iov[idx], iov.size() - idx, off);
+      if (r < 0) {
+	r = -errno;
+	derr << __func__ << " pwritev error: " << cpp_strerror(r) << dendl;
+	return r;
+      }
+      off += r;
+      left -= r;
+      while (idx < iov.size() && (size_t)r >= iov[idx].iov_len) {
+	r -= iov[idx++].iov_len;
+      }
+      if (r) {
+	iov[idx].iov_base = static_cast<char*>(iov[idx].iov_base) + r;
+	iov[idx].iov_len -= r;
+      }
+    }
+    io_since_flush.store(true);
+    return 0;
+  }
+
+  // read straight into the caller's buffer if we can, like a PRP list
+  // pointing at it; otherwise bounce
+  bufferptr bounce;
+  char *dst = buf;
+  if (buf_off || buf_len != len ||
+      (direct && ((uintptr_t)buf & ~CEPH_PAGE_MASK))) {
+    bounce = ceph::buffer::create_small_page_aligned(len);
+    dst = bounce.c_str();
+  }
+  uint64_t done = 0;
+  while (done < len) {
+    ssize_t r = ::pread(fd, dst + done, len - done, off + done);
+    if (r < 0) {
+      r = -errno;
+      derr << __func__ << " pread error: " << cpp_strerror(r) << dendl;
+      return r;
+    }
+    if (r == 0) {
+      derr << __func__ << " short read 0x" << std::hex << off << "~" << len
+	   << " got 0x" << done << std::dec << dendl;
+      return -EIO;
+    }
+    done += r;
+  }
+  if (dst != buf && buf_len) {
+    memcpy(buf, dst + buf_off, buf_len);
+  }
+  return 0;
+}
+
+static void complete_cmd(NVMeEmuDevice *dev, EmuCommand *c)
+{
+  IOContext *ioc = c->ctx;
+  if (c->rval < 0) {
+    if (ioc->allow_eio) {
+      ioc->set_return_value(-EIO);
+    } else {
+      ceph_abort_msg("unexpected nvme_emu io error");
+    }
+  }
+  --ioc->total_nseg;
+  delete c;
+  // check waiting count before doing callback (which may
+  // destroy this ioc).
+  if (ioc->priv) {
+    if (!--ioc->num_running) {
+      dev->aio_callback(dev->aio_callback_priv, ioc->priv);
+    }
+  } else {
+    ioc->try_aio_wake();
+  }
+}
+
+void NVMeEmuDevice::aio_submit(IOContext *ioc)
+{
+  dout(20) << __func__ << " ioc " << ioc << " pending "
+	   << ioc->num_pending.load() << " running "
+	   << ioc->num_running.load() << dendl;
+  int pending = ioc->num_pending.load();
+  EmuCommand *t = static_cast<EmuCommand*>(ioc->nvme_task_first);
+  if (!pending || !t) {
+    return;
+  }
+  ioc->num_running += pending;
+  ioc->num_pending -= pending;
+  ceph_assert(ioc->num_pending.load() == 0);  // we should be only thread doing this
+  ioc->nvme_task_first = ioc->nvme_task_last = nullptr;
+
+  // Poll our own queue pair until everything we queued has completed.
+  // Completion callbacks may submit more io from this thread; the nested
+  // call then drains the queue pair, which is fine since we only stop
+  // once both our command list and the queue are empty.  Don't touch ioc
+  // past this point, the last callback may have freed it.
+  NVMeEmuQueuePair *qp = _get_qpair();
+  std::vector<EmuCommand*> done;
+  while (t || qp->inflight) {
+    if (t) {
+      unsigned queued = 0;
+      {
+	std::lock_guard l(qp->lock);
+	for (; t && qp->inflight < queue_depth; t = t->next) {
+	  qp->sq.push_back(t);
+	  ++qp->inflight;
+	  ++queued;
+	}
+      }
+      if (queued) {
+	std::lock_guard l(sq_lock);
+	sq_queued += queued;
+	sq_cond.notify_all();
+      }
+    }
+    {
+      std::lock_guard l(qp->lock);
+      done.swap(qp->cq);
+    }
+    if (done.empty()) {
+      dout(40) << __func__ << " polling" << dendl;
+      usleep(io_sleep_us);
+      continue;
+    }
+    qp->inflight -= done.size();
+    for (auto c : done) {
+      complete_cmd(this, c);
+    }
+    done.clear();
+  }
+}
+
+void NVMeEmuDevice::_queue_write(uint64_t off, bufferlist& bl, IOContext *ioc)
+{
+  uint64_t remain_len = bl.length(), begin = 0;
+  while (remain_len > 0) {
+    uint64_t write_size = std::min(remain_len, split_size);
+    EmuCommand *c = new EmuCommand(EmuOp::WRITE, ioc, off + begin, write_size);
+    bl.splice(0, write_size, &c->bl);
+    ioc_append_cmd(ioc, c);
+    remain_len -= write_size;
+    begin += write_size;
+  }
+}
+
+void NVMeEmuDevice::_queue_read(uint64_t off, uint64_t len, char *buf,
+				uint64_t buf_off, uint64_t buf_len,
+				IOContext *ioc)
+{
+  // [off, off+len) is block aligned; buf wants buf_len bytes of it
+  // starting at buf_off.
+  for (uint64_t begin = 0; begin < len; begin += split_size) {
+    uint64_t read_size = std::min(len - begin, split_size);
+    EmuCommand *c = new EmuCommand(EmuOp::READ, ioc, off + begin, read_size);
+    uint64_t s = std::max(begin, buf_off);
+    uint64_t e = std::min(begin + read_size, buf_off + buf_len);
+    if (s < e) {
+      c->buf = buf + (s - buf_off);
+      c->buf_off = s - begin;
+      c->buf_len = e - s;
+    } else {
+      c->buf_len = 0;
+      c->buf_off = read_size;   // nothing wanted; just bounce
+    }
+    ioc_append_cmd(ioc, c);
+  }
+}
+
+int NVMeEmuDevice::aio_write(
+  uint64_t off,
+  bufferlist &bl,
+  IOContext *ioc,
+  bool buffered,
+  int write_hint)
+{
+  uint64_t len = bl.length();
+  dout(20) << __func__ << " 0x" << std::hex << off << "~" << len << std::dec
+	   << " ioc " << ioc << dendl;
+  ceph_assert(is_valid_io(off, len));
+  if (direct &&
+      bl.rebuild_aligned_size_and_memory(block_size, block_size, IOV_MAX)) {
+    dout(20) << __func__ << " rebuilding buffer to be aligned" << dendl;
+  }
+  _queue_write(off, bl, ioc);
+  return 0;
+}
+
+int NVMeEmuDevice::write(uint64_t off, bufferlist &bl, bool buffered,
+			 int write_hint)
+{
+  uint64_t len = bl.length();
+  dout(20) << __func__ << " 0x" << std::hex << off << "~" << len << std::dec
+	   << dendl;
+  ceph_assert(is_valid_io(off, len));
+  if (direct &&
+      bl.rebuild_aligned_size_and_memory(block_size, block_size, IOV_MAX)) {
+    dout(20) << __func__ << " rebuilding buffer to be aligned" << dendl;
+  }
+  IOContext ioc(cct, nullptr);
+  _queue_write(off, bl, &ioc);
+  aio_submit(&ioc);
+  ioc.aio_wait();
+  return ioc.get_return_value();
+}
+
+int NVMeEmuDevice::read(uint64_t off, uint64_t len, bufferlist *pbl,
+			IOContext *ioc,
+			bool buffered)
+{
+  dout(5) << __func__ << " 0x" << std::hex << off << "~" << len << std::dec
+	  << " ioc " << ioc << dendl;
+  ceph_assert(is_valid_io(off, len));
+
+  bufferptr p = ceph::buffer::create_small_page_aligned(len);
+  IOContext read_ioc(cct, nullptr, ioc->allow_eio);
+  _queue_read(off, len, p.c_str(), 0, len, &read_ioc);
+  aio_submit(&read_ioc);
+  read_ioc.aio_wait();
+  int r = read_ioc.get_return_value();
+  if (r < 0) {
+    return r;
+  }
+  pbl->clear();
+  pbl->push_back(std::move(p));
+  return 0;
+}
+
+int NVMeEmuDevice::aio_read(
+  uint64_t off,
+  uint64_t len,
+  bufferlist *pbl,
+  IOContext *ioc)
+{
+  dout(20) << __func__ << " 0x" << std::hex << off << "~" << len << std::dec
+	   << " ioc " << ioc << dendl;
+  ceph_assert(is_valid_io(off, len));
+  bufferptr p = ceph::buffer::create_small_page_aligned(len);
+  pbl->append(p);
+  _queue_read(off, len, p.c_str(), 0, len, ioc);
+  return 0;
+}
+
+int NVMeEmuDevice::read_random(uint64_t off, uint64_t len, char *buf,
+			       bool buffered)
+{
+  ceph_assert(len > 0);
+  ceph_assert(off < size);
+  ceph_assert(off + len <= size);
+
+  uint64_t aligned_off = p2align(off, block_size);
+  uint64_t aligned_len = p2roundup(off + len, block_size) - aligned_off;
+  dout(5) << __func__ << " 0x" << std::hex << off << "~" << len
+	  << " aligned 0x" << aligned_off << "~" << aligned_len << std::dec
+	  << dendl;
+  IOContext ioc(cct, nullptr);
+  _queue_read(aligned_off, aligned_len, buf, off - aligned_off, len, &ioc);
+  aio_submit(&ioc);
+  ioc.aio_wait();
+  return ioc.get_return_value();
+}
+
+int NVMeEmuDevice::flush()
+{
+  if (!io_since_flush.exchange(false)) {
+    return 0;
+  }
+  dout(10) << __func__ << " start" << dendl;
+  int r = ::fdatasync(fd);
+  if (r < 0) {
+    r = -errno;
+    derr << __func__ << " fdatasync got: " << cpp_strerror(r) << dendl;
+    ceph_abort();
+  }
+  return r;
+}
+
+int NVMeEmuDevice::invalidate_cache(uint64_t off, uint64_t len)
+{
+  dout(5) << __func__ << " 0x" << std::hex << off << "~" << len << std::dec
+	  << dendl;
+  return 0;
+}
@@ -0,0 +1,109 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_BLK_NVMEEMUDEVICE_H
+#define CEPH_BLK_NVMEEMUDEVICE_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "BlockDevice.h"
+
+class NVMeEmuQueuePair;
+
+/**
+ * File backed emulation of a userspace NVMe driver.
+ *
+ * Mirrors the submission model of NVMEDevice (blk/spdk): every thread
+ * that submits gets its own queue pair, aio_submit() pushes commands
+ * onto that thread's submission queue and then polls its completion
+ * queue, running the completion callbacks inline, until the ioc is done.
+ * A small pool of "controller" threads drains the submission queues
+ * with pread/pwrite against the backing file, and sleeps while they are
+ * all empty.
+ *
+ * This lets the SPDK code path's cost model (polling, per-thread queues,
+ * callbacks from the submitter) be tested and benchmarked against
+ * KernelDevice without real hardware.  Select it with
+ * bdev_type = nvme_emu.
+ */
+class NVMeEmuDevice : public BlockDevice {
+  std::string path;
+  int fd = -1;
+  bool direct = false;
+  std::atomic_bool io_since_flush = {false};
+
+  uint32_t queue_depth = 0;
+  uint64_t io_sleep_us = 0;
+
+  /// queue pairs by submitting thread; that of a thread that has exited
+  /// is freed when another one is set up, and all of them on close
+  ceph::shared_mutex qpair_lock =
+    ceph::make_shared_mutex("NVMeEmuDevice::qpair_lock");
+  std::map<std::thread::id, std::shared_ptr<NVMeEmuQueuePair>> qpairs;
+
+  /// commands waiting in any submission queue; the controller threads
+  /// wait on sq_cond while there are none.  Commands are counted after
+  /// they are queued, so this may briefly drop below zero.
+  ceph::mutex sq_lock = ceph::make_mutex("NVMeEmuDevice::sq_lock");
+  ceph::condition_variable sq_cond;
+  int64_t sq_queued = 0;
+
+  bool stopping = false;  ///< protected by sq_lock
+  std::vector<std::thread> controller_threads;
+
+  NVMeEmuQueuePair *_get_qpair();
+  void _controller_entry(unsigned id);
+  void _queue_write(uint64_t off, ceph::buffer::list& bl, IOContext *ioc);
+  void _queue_read(uint64_t off, uint64_t len, char *buf,
+		   uint64_t buf_off, uint64_t buf_len, IOContext *ioc);
+
+ public:
+  NVMeEmuDevice(CephContext* cct, aio_callback_t cb, void *cbpriv);
+  ~NVMeEmuDevice() override;
+
+  /// run one command against the backing file; called by the controller
+  int execute(int op, uint64_t off, uint64_t len, ceph::buffer::list& bl,
+	      char *buf, uint64_t buf_off, uint64_t buf_len);
+
+  void aio_submit(IOContext *ioc) override;
+
+  int read(uint64_t off, uint64_t len, ceph::buffer::list *pbl,
+	   IOContext *ioc,
+	   bool buffered) override;
+  int aio_read(
+    uint64_t off,
+    uint64_t len,
+    ceph::buffer::list *pbl,
+    IOContext *ioc) override;
+  int aio_write(uint64_t off, ceph::buffer::list& bl,
+		IOContext *ioc,
+		bool buffered,
+		int write_hint = WRITE_LIFE_NOT_SET) override;
+  int write(uint64_t off, ceph::buffer::list& bl, bool buffered,
+	    int write_hint = WRITE_LIFE_NOT_SET) override;
+  int flush() override;
+  int read_random(uint64_t off, uint64_t len, char *buf,
+		  bool buffered) override;
+
+  int invalidate_cache(uint64_t off, uint64_t len) override;
+  int open(const std::string& path) override;
+  void close() override;
+  int collect_metadata(const std::string& prefix,
+		       std::map<std::string,std::string> *pm) const override;
+};
+
+#endif
@@ -4,9 +4,12 @@
 #ifndef CEPH_OS_BLUESTORE_CHECKSUMMER
 #define CEPH_OS_BLUESTORE_CHECKSUMMER
 
+#include <algorithm>
+
 #include "include/buffer.h"
 #include "include/byteorder.h"
 #include "include/ceph_assert.h"
+#include "common/csum_multibuf.h"
 
 #include "xxHash/xxhash.h"
 
@@ -90,6 +93,17 @@ public:
       ) {
       return p.crc32c(len, init_value);
     }
+
+    static constexpr bool multi = true;
+    static void calc_multi(
+      init_value_t init_value,
+      size_t len,
+      size_t n,
+      const char *data,
+      uint32_t *out
+      ) {
+      ceph_crc32c_multibuf(init_value, (unsigned char const *)data, len, n, out);
+    }
   };
 
   struct crc32c_16 {
@@ -111,6 +125,20 @@ public:
       ) {
       return p.crc32c(len, init_value) & 0xffff;
     }
+
+    static constexpr bool multi = true;
+    static void calc_multi(
+      init_value_t init_value,
+      size_t len,
+      size_t n,
+      const char *data,
+      uint32_t *out
+      ) {
+      ceph_crc32c_multibuf(init_value, (unsigned char const *)data, len, n, out);
+      for (size_t i = 0; i < n; ++i) {
+	out[i] &= 0xffff;
+      }
+    }
   };
 
   struct crc32c_8 {
@@ -132,6 +160,20 @@ public:
       ) {
       return p.crc32c(len, init_value) & 0xff;
     }
+
+    static constexpr bool multi = true;
+    static void calc_multi(
+      init_value_t init_value,
+      size_t len,
+      size_t n,
+      const char *data,
+      uint32_t *out
+      ) {
+      ceph_crc32c_multibuf(init_value, (unsigned char const *)data, len, n, out);
+      for (size_t i = 0; i < n; ++i) {
+	out[i] &= 0xff;
+      }
+    }
   };
 
   struct xxhash32 {
@@ -161,6 +203,16 @@ public:
       }
       return XXH32_digest(state);
     }
+    static constexpr bool multi = true;
+    static void calc_multi(
+      init_value_t init_value,
+      size_t len,
+      size_t n,
+      const char *data,
+      uint32_t *out
+      ) {
+      ceph_xxhash32_multibuf(init_value, (unsigned char const *)data, len, n, out);
+    }
   };
 
   struct xxhash64 {
@@ -190,8 +242,45 @@ public:
       }
       return XXH64_digest(state);
     }
+    // no multi-buffer kernel; 64-bit lanes don't gain enough to bother
+    static constexpr bool multi = false;
   };
 
+  /// max blocks handed to a multi-buffer kernel at once
+  static constexpr size_t multi_batch = 64;
+
+  /**
+   * checksum as many whole blocks as are contiguous at p, up to
+   * min(blocks, multi_batch), with the Alg's multi-buffer kernel.
+   *
+   * @returns number of blocks done (and p advanced past); 0 if the
+   * next block straddles a segment boundary or Alg has no such kernel.
+   */
+  template<class Alg>
+  static size_t calc_contiguous(
+    typename Alg::init_value_t init_value,
+    size_t csum_block_size,
+    size_t blocks,
+    ceph::buffer::list::const_iterator& p,
+    uint32_t *out) {
+    if constexpr (!Alg::multi) {
+      return 0;
+    } else {
+      if (blocks < 2 || p.end()) {
+	return 0;
+      }
+      ceph::buffer::ptr cur = p.get_current_ptr();
+      size_t n = std::min(cur.length() / csum_block_size,
+			  std::min(blocks, multi_batch));
+      if (n < 2) {
+	return 0;
+      }
+      Alg::calc_multi(init_value, csum_block_size, n, cur.c_str(), out);
+      p += n * csum_block_size;
+      return n;
+    }
+  }
+
   template<class Alg>
   static int calculate(
     size_t csum_block_size,
@@ -225,9 +314,21 @@ public:
     typename Alg::value_t *pv =
       reinterpret_cast<typename Alg::value_t*>(csum_data->c_str());
     pv += offset / csum_block_size;
-    while (blocks--) {
+    uint32_t batch[multi_batch];
+    while (blocks) {
+      size_t n = calc_contiguous<Alg>(init_value, csum_block_size, blocks,
+				      p, batch);
+      if (n) {
+	for (size_t i = 0; i < n; ++i) {
+	  pv[i] = batch[i];
+	}
+	pv += n;
+	blocks -= n;
+	continue;
+      }
       *pv = Alg::calc(state, init_value, csum_block_size, p);
       ++pv;
+      --blocks;
     }
     Alg::fini(&state);
     return 0;
@@ -253,7 +354,25 @@ public:
       reinterpret_cast<const typename Alg::value_t*>(csum_data.c_str());
     pv += offset / csum_block_size;
     size_t pos = offset;
+    uint32_t batch[multi_batch];
     while (length > 0) {
+      size_t n = calc_contiguous<Alg>(-1, csum_block_size,
+				      length / csum_block_size, p, batch);
+      if (n) {
+	for (size_t i = 0; i < n; ++i) {
+	  if (pv[i] != batch[i]) {
+	    if (bad_csum) {
+	      *bad_csum = batch[i];
+	    }
+	    Alg::fini(&state);
+	    return pos + i * csum_block_size;
+	  }
+	}
+	pv += n;
+	pos += n * csum_block_size;
+	length -= n * csum_block_size;
+	continue;
+      }
       typename Alg::init_value_t v = Alg::calc(state, -1, csum_block_size, p);
       if (*pv != v) {
 	if (bad_csum) {
@@ -293,6 +293,7 @@ bool OpTracker::register_inflight_op(TrackedOp *i)
     sdata->ops_in_flight_sharded.push_back(*i);
     i->seq = current_seq;
   }
+  i->sampled = current_seq % sample_rate.load() == 0;
   return true;
 }
 
@@ -311,6 +312,11 @@ void OpTracker::unregister_inflight_op(TrackedOp* const i)
   }
 }
 
+bool OpTracker::want_history_op(const TrackedOp& i) const
+{
+  return i.sampled || history.is_slow_op(i.get_duration());
+}
+
 void OpTracker::record_history_op(TrackedOpRef&& i)
 {
   std::shared_lock l{lock};
@@ -478,7 +484,7 @@ void OpTracker::get_age_ms_histogram(pow2_hist_t *h)
 
 void TrackedOp::mark_event(std::string_view event, utime_t stamp)
 {
-  if (!state)
+  if (!state || !sampled)
     return;
 
   {
@@ -493,6 +499,17 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
   _event_marked();
 }
 
+void TrackedOp::mark_done()
+{
+  if (sampled) {
+    mark_event("done");
+  } else {
+    // the duration of the op is taken from it
+    std::lock_guard l(lock);
+    events.emplace_back(ceph_clock_now(), "done");
+  }
+}
+
 void TrackedOp::dump(utime_t now, Formatter *f) const
 {
   // Ignore if still in the constructor
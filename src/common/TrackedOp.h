@@ -95,6 +95,9 @@ public:
     history_slow_op_size = new_size;
     history_slow_op_threshold = new_threshold;
   }
+  bool is_slow_op(double duration) const {
+    return duration >= history_slow_op_threshold.load();
+  }
 };
 
 struct ShardedTrackingData;
@@ -107,6 +110,7 @@ class OpTracker {
   float complaint_time;
   int log_threshold;
   std::atomic<bool> tracking_enabled;
+  std::atomic<uint32_t> sample_rate = {1};
   ceph::shared_mutex lock = ceph::make_shared_mutex("OpTracker::lock");
 
 public:
@@ -129,11 +133,19 @@ public:
   void set_tracking(bool enable) {
     tracking_enabled = enable;
   }
+  /**
+   * record the events of one op in every rate, the others are only kept
+   * in flight to catch them being slow, and in the history if they were
+   */
+  void set_sample_rate(uint32_t rate) {
+    sample_rate = std::max(rate, 1u);
+  }
   bool dump_ops_in_flight(ceph::Formatter *f, bool print_only_blocked = false, std::set<std::string> filters = {""}, bool count_only = false);
   bool dump_historic_ops(ceph::Formatter *f, bool by_duration = false, std::set<std::string> filters = {""});
   bool dump_historic_slow_ops(ceph::Formatter *f, std::set<std::string> filters = {""});
   bool register_inflight_op(TrackedOp *i);
   void unregister_inflight_op(TrackedOp *i);
+  bool want_history_op(const TrackedOp& i) const;
   void record_history_op(TrackedOpRef&& i);
 
   void get_age_ms_histogram(pow2_hist_t *h);
@@ -249,6 +261,7 @@ protected:
   std::vector<Event> events;    ///< std::list of events and their times
   mutable ceph::mutex lock = ceph::make_mutex("TrackedOp::lock"); ///< to protect the events list
   uint64_t seq = 0;        ///< a unique value std::set by the OpTracker
+  bool sampled = true;     ///< if not, only initiated and done are recorded
 
   uint32_t warn_interval_multiplier = 1; //< limits output of a given op warning
 
@@ -266,9 +279,7 @@ protected:
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
     tracker(_tracker),
     initiated_at(initiated)
-  {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
-  }
+  {}
 
   /// output any type-specific data you want to get when dump() is called
   virtual void _dump(ceph::Formatter *f) const {}
@@ -303,10 +314,10 @@ public:
 	break;
 
       case STATE_LIVE:
-	mark_event("done");
+	mark_done();
 	tracker->unregister_inflight_op(this);
 	_unregistered();
-	if (!tracker->is_tracking()) {
+	if (!tracker->is_tracking() || !tracker->want_history_op(*this)) {
 	  delete this;
 	} else {
 	  state = TrackedOp::STATE_HISTORY;
@@ -360,6 +371,13 @@ public:
   }
 
   void mark_event(std::string_view event, utime_t stamp=ceph_clock_now());
+private:
+  void mark_done();
+public:
+
+  bool is_sampled() const {
+    return sampled;
+  }
 
   void mark_nowarn() {
     warn_interval_multiplier = 0;
@@ -374,6 +392,7 @@ public:
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
+      events.reserve(sampled ? OPTRACKER_PREALLOC_EVENTS : 2);
       events.emplace_back(initiated_at, "initiated");
       state = STATE_LIVE;
     }
@@ -0,0 +1,323 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <string.h>
+
+#include "common/csum_multibuf.h"
+#include "include/crc32c.h"
+#include "arch/probe.h"
+#include "arch/intel.h"
+
+#include "xxHash/xxhash.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+void ceph_crc32c_multibuf_baseline(uint32_t init,
+				   unsigned char const *data,
+				   size_t block_size, size_t n,
+				   uint32_t *out)
+{
+  for (size_t i = 0; i < n; ++i, data += block_size) {
+    out[i] = ceph_crc32c(init, data, block_size);
+  }
+}
+
+void ceph_xxhash32_multibuf_baseline(uint32_t seed,
+				     unsigned char const *data,
+				     size_t block_size, size_t n,
+				     uint32_t *out)
+{
+  for (size_t i = 0; i < n; ++i, data += block_size) {
+    out[i] = XXH32(data, block_size, seed);
+  }
+}
+
+#if defined(__x86_64__)
+
+namespace {
+
+static constexpr uint32_t XXH_PRIME32_1 = 0x9E3779B1U;
+static constexpr uint32_t XXH_PRIME32_2 = 0x85EBCA77U;
+static constexpr uint32_t XXH_PRIME32_3 = 0xC2B2AE3DU;
+static constexpr uint32_t XXH_PRIME32_4 = 0x27D4EB2FU;
+
+inline uint32_t rotl32(uint32_t x, int r)
+{
+  return (x << r) | (x >> (32 - r));
+}
+
+inline uint32_t read_le32(unsigned char const *p)
+{
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+/*
+ * Fold the four stripe accumulators of one block into the final XXH32
+ * value.  The simd kernels only take block sizes that are a multiple of
+ * the 16 byte stripe, so there is never a tail to mix in.
+ */
+inline uint32_t xxh32_finish(uint32_t v1, uint32_t v2, uint32_t v3,
+			     uint32_t v4, size_t len)
+{
+  uint32_t h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+  h += (uint32_t)len;
+  h ^= h >> 15;
+  h *= XXH_PRIME32_2;
+  h ^= h >> 13;
+  h *= XXH_PRIME32_3;
+  h ^= h >> 16;
+  return h;
+}
+
+inline bool xxh32_simd_ok(size_t block_size)
+{
+  // the avx-512 gather takes 32-bit signed byte offsets
+  return block_size >= 16 && block_size % 16 == 0 &&
+    block_size <= (1u << 26);
+}
+
+} // anonymous namespace
+
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42_one(uint32_t crc, unsigned char const *p,
+				 size_t len)
+{
+  uint64_t c = crc;
+  for (; len >= 8; len -= 8, p += 8) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    c = _mm_crc32_u64(c, v);
+  }
+  uint32_t c32 = (uint32_t)c;
+  for (; len > 0; --len, ++p) {
+    c32 = _mm_crc32_u8(c32, *p);
+  }
+  return c32;
+}
+
+/*
+ * The crc32 instruction has a latency of 3 cycles but a throughput of
+ * one per cycle, so a single stream leaves two thirds of the unit idle.
+ * Running four independent blocks side by side fills it.
+ */
+__attribute__((target("sse4.2")))
+void ceph_crc32c_multibuf_sse42(uint32_t init,
+				unsigned char const *data,
+				size_t block_size, size_t n,
+				uint32_t *out)
+{
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    unsigned char const *p0 = data + (i + 0) * block_size;
+    unsigned char const *p1 = data + (i + 1) * block_size;
+    unsigned char const *p2 = data + (i + 2) * block_size;
+    unsigned char const *p3 = data + (i + 3) * block_size;
+    uint64_t c0 = init, c1 = init, c2 = init, c3 = init;
+    size_t off = 0;
+    for (; off + 8 <= block_size; off += 8) {
+      uint64_t v0, v1, v2, v3;
+      memcpy(&v0, p0 + off, 8);
+      memcpy(&v1, p1 + off, 8);
+      memcpy(&v2, p2 + off, 8);
+      memcpy(&v3, p3 + off, 8);
+      c0 = _mm_crc32_u64(c0, v0);
+      c1 = _mm_crc32_u64(c1, v1);
+      c2 = _mm_crc32_u64(c2, v2);
+      c3 = _mm_crc32_u64(c3, v3);
+    }
+    size_t left = block_size - off;
+    out[i + 0] = crc32c_sse42_one((uint32_t)c0, p0 + off, left);
+    out[i + 1] = crc32c_sse42_one((uint32_t)c1, p1 + off, left);
+    out[i + 2] = crc32c_sse42_one((uint32_t)c2, p2 + off, left);
+    out[i + 3] = crc32c_sse42_one((uint32_t)c3, p3 + off, left);
+  }
+  for (; i < n; ++i) {
+    out[i] = crc32c_sse42_one(init, data + i * block_size, block_size);
+  }
+}
+
+template<int R>
+__attribute__((target("avx2")))
+static inline __m256i xxh32_rotl_avx2(__m256i x)
+{
+  return _mm256_or_si256(_mm256_slli_epi32(x, R), _mm256_srli_epi32(x, 32 - R));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i xxh32_round_avx2(__m256i acc, __m256i in)
+{
+  const __m256i p1 = _mm256_set1_epi32((int)XXH_PRIME32_1);
+  const __m256i p2 = _mm256_set1_epi32((int)XXH_PRIME32_2);
+  acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(in, p2));
+  acc = xxh32_rotl_avx2<13>(acc);
+  return _mm256_mullo_epi32(acc, p1);
+}
+
+/*
+ * Eight blocks per pass, one per 32-bit lane.  Each stripe is loaded as
+ * eight 128-bit rows and transposed so that register j holds the j-th
+ * word of every block, which is exactly what accumulator j consumes.
+ */
+__attribute__((target("avx2")))
+void ceph_xxhash32_multibuf_avx2(uint32_t seed,
+				 unsigned char const *data,
+				 size_t block_size, size_t n,
+				 uint32_t *out)
+{
+  if (!xxh32_simd_ok(block_size)) {
+    ceph_xxhash32_multibuf_baseline(seed, data, block_size, n, out);
+    return;
+  }
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    unsigned char const *base = data + i * block_size;
+    __m256i a0 = _mm256_set1_epi32((int)(seed + XXH_PRIME32_1 + XXH_PRIME32_2));
+    __m256i a1 = _mm256_set1_epi32((int)(seed + XXH_PRIME32_2));
+    __m256i a2 = _mm256_set1_epi32((int)seed);
+    __m256i a3 = _mm256_set1_epi32((int)(seed - XXH_PRIME32_1));
+    for (size_t off = 0; off < block_size; off += 16) {
+      __m256i r[4];
+      for (int b = 0; b < 4; ++b) {
+	__m128i lo = _mm_loadu_si128(
+	  (const __m128i*)(base + b * block_size + off));
+	__m128i hi = _mm_loadu_si128(
+	  (const __m128i*)(base + (b + 4) * block_size + off));
+	r[b] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+      }
+      __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+      __m256i t1 = _mm256_unpacklo_epi32(r[2], r[3]);
+      __m256i t2 = _mm256_unpackhi_epi32(r[0], r[1]);
+      __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+      a0 = xxh32_round_avx2(a0, _mm256_unpacklo_epi64(t0, t1));
+      a1 = xxh32_round_avx2(a1, _mm256_unpackhi_epi64(t0, t1));
+      a2 = xxh32_round_avx2(a2, _mm256_unpacklo_epi64(t2, t3));
+      a3 = xxh32_round_avx2(a3, _mm256_unpackhi_epi64(t2, t3));
+    }
+    alignas(32) uint32_t v[4][8];
+    _mm256_store_si256((__m256i*)v[0], a0);
+    _mm256_store_si256((__m256i*)v[1], a1);
+    _mm256_store_si256((__m256i*)v[2], a2);
+    _mm256_store_si256((__m256i*)v[3], a3);
+    for (int b = 0; b < 8; ++b) {
+      out[i + b] = xxh32_finish(v[0][b], v[1][b], v[2][b], v[3][b],
+				block_size);
+    }
+  }
+  if (i < n) {
+    ceph_xxhash32_multibuf_baseline(seed, data + i * block_size, block_size,
+				    n - i, out + i);
+  }
+}
+
+/*
+ * The unmasked _mm512_i32gather_epi32 and _mm512_rol_epi32 pass an
+ * undefined source to the masked builtins, which gcc reports as
+ * maybe-uninitialized; use the masked forms with every lane enabled.
+ */
+__attribute__((target("avx512f")))
+static inline __m512i xxh32_gather_avx512(__m512i idx, unsigned char const *p)
+{
+  return _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff, idx, p,
+				     1);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i xxh32_round_avx512(__m512i acc, __m512i in)
+{
+  const __m512i p1 = _mm512_set1_epi32((int)XXH_PRIME32_1);
+  const __m512i p2 = _mm512_set1_epi32((int)XXH_PRIME32_2);
+  acc = _mm512_add_epi32(acc, _mm512_mullo_epi32(in, p2));
+  acc = _mm512_mask_rol_epi32(acc, 0xffff, acc, 13);
+  return _mm512_mullo_epi32(acc, p1);
+}
+
+/*
+ * Sixteen blocks per pass.  With that many rows a register transpose
+ * costs more than it saves, so each accumulator is fed by a gather.
+ */
+__attribute__((target("avx512f")))
+void ceph_xxhash32_multibuf_avx512(uint32_t seed,
+				   unsigned char const *data,
+				   size_t block_size, size_t n,
+				   uint32_t *out)
+{
+  if (!xxh32_simd_ok(block_size)) {
+    ceph_xxhash32_multibuf_baseline(seed, data, block_size, n, out);
+    return;
+  }
+  const int bs = (int)block_size;
+  const __m512i idx = _mm512_mullo_epi32(
+    _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0),
+    _mm512_set1_epi32(bs));
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    unsigned char const *base = data + i * block_size;
+    __m512i a0 = _mm512_set1_epi32((int)(seed + XXH_PRIME32_1 + XXH_PRIME32_2));
+    __m512i a1 = _mm512_set1_epi32((int)(seed + XXH_PRIME32_2));
+    __m512i a2 = _mm512_set1_epi32((int)seed);
+    __m512i a3 = _mm512_set1_epi32((int)(seed - XXH_PRIME32_1));
+    for (size_t off = 0; off < block_size; off += 16) {
+      unsigned char const *p = base + off;
+      a0 = xxh32_round_avx512(a0, xxh32_gather_avx512(idx, p));
+      a1 = xxh32_round_avx512(a1, xxh32_gather_avx512(idx, p + 4));
+      a2 = xxh32_round_avx512(a2, xxh32_gather_avx512(idx, p + 8));
+      a3 = xxh32_round_avx512(a3, xxh32_gather_avx512(idx, p + 12));
+    }
+    alignas(64) uint32_t v[4][16];
+    _mm512_store_si512(v[0], a0);
+    _mm512_store_si512(v[1], a1);
+    _mm512_store_si512(v[2], a2);
+    _mm512_store_si512(v[3], a3);
+    for (int b = 0; b < 16; ++b) {
+      out[i + b] = xxh32_finish(v[0][b], v[1][b], v[2][b], v[3][b],
+				block_size);
+    }
+  }
+  if (i < n) {
+    // fewer than 16 left; the avx2 kernel still beats the scalar loop
+    ceph_xxhash32_multibuf_avx2(seed, data + i * block_size, block_size,
+				n - i, out + i);
+  }
+}
+
+#endif /* __x86_64__ */
+
+/*
+ * choose best implementation based on the CPU architecture.
+ */
+ceph_csum_multibuf_func_t ceph_choose_crc32c_multibuf(void)
+{
+  ceph_arch_probe();
+#if defined(__x86_64__)
+  if (ceph_arch_intel_sse42) {
+    return ceph_crc32c_multibuf_sse42;
+  }
+#endif
+  return ceph_crc32c_multibuf_baseline;
+}
+
+ceph_csum_multibuf_func_t ceph_choose_xxhash32_multibuf(void)
+{
+  ceph_arch_probe();
+#if defined(__x86_64__)
+  if (ceph_arch_intel_avx512f) {
+    return ceph_xxhash32_multibuf_avx512;
+  }
+  if (ceph_arch_intel_avx2) {
+    return ceph_xxhash32_multibuf_avx2;
+  }
+#endif
+  return ceph_xxhash32_multibuf_baseline;
+}
+
+/*
+ * static globals, see crc32c.cc
+ */
+ceph_csum_multibuf_func_t ceph_crc32c_multibuf_func =
+  ceph_choose_crc32c_multibuf();
+ceph_csum_multibuf_func_t ceph_xxhash32_multibuf_func =
+  ceph_choose_xxhash32_multibuf();
@@ -0,0 +1,85 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_COMMON_CSUM_MULTIBUF_H
+#define CEPH_COMMON_CSUM_MULTIBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Multi-buffer checksum kernels.
+ *
+ * Each kernel checksums @n consecutive blocks of @block_size bytes
+ * starting at @data, every block independently seeded with @init, and
+ * stores one result per block in @out.  Since the blocks don't depend on
+ * each other the kernels interleave several of them to keep the
+ * execution units (or SIMD lanes) busy, which a single dependent
+ * crc32c/xxhash chain can't do.
+ *
+ * Results are identical to calling ceph_crc32c() / XXH32() per block.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*ceph_csum_multibuf_func_t)(uint32_t init,
+					  unsigned char const *data,
+					  size_t block_size,
+					  size_t n,
+					  uint32_t *out);
+
+/* the implementations chosen for this CPU */
+extern ceph_csum_multibuf_func_t ceph_crc32c_multibuf_func;
+extern ceph_csum_multibuf_func_t ceph_xxhash32_multibuf_func;
+
+extern ceph_csum_multibuf_func_t ceph_choose_crc32c_multibuf(void);
+extern ceph_csum_multibuf_func_t ceph_choose_xxhash32_multibuf(void);
+
+/* individual kernels, for tests and benchmarks; the simd ones are only
+ * safe to call if the cpu supports them (see arch/intel.h) */
+extern void ceph_crc32c_multibuf_baseline(uint32_t init,
+					  unsigned char const *data,
+					  size_t block_size, size_t n,
+					  uint32_t *out);
+extern void ceph_xxhash32_multibuf_baseline(uint32_t seed,
+					    unsigned char const *data,
+					    size_t block_size, size_t n,
+					    uint32_t *out);
+#if defined(__x86_64__)
+extern void ceph_crc32c_multibuf_sse42(uint32_t init,
+				       unsigned char const *data,
+				       size_t block_size, size_t n,
+				       uint32_t *out);
+extern void ceph_xxhash32_multibuf_avx2(uint32_t seed,
+					unsigned char const *data,
+					size_t block_size, size_t n,
+					uint32_t *out);
+extern void ceph_xxhash32_multibuf_avx512(uint32_t seed,
+					  unsigned char const *data,
+					  size_t block_size, size_t n,
+					  uint32_t *out);
+#endif
+
+static inline void ceph_crc32c_multibuf(uint32_t init,
+					unsigned char const *data,
+					size_t block_size, size_t n,
+					uint32_t *out)
+{
+  ceph_crc32c_multibuf_func(init, data, block_size, n, out);
+}
+
+static inline void ceph_xxhash32_multibuf(uint32_t seed,
+					  unsigned char const *data,
+					  size_t block_size, size_t n,
+					  uint32_t *out)
+{
+  ceph_xxhash32_multibuf_func(seed, data, block_size, n, out);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
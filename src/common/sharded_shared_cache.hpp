@@ -0,0 +1,385 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_SHARDEDSHAREDCACHE_H
+#define CEPH_SHARDEDSHAREDCACHE_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+
+#include "common/ceph_mutex.h"
+#include "common/ceph_context.h"
+#include "common/dout.h"
+#include "include/unordered_map.h"
+
+/**
+ * SharedLRU, split into shards by the hash of the key
+ *
+ * As with SharedLRU, a value stays registered for as long as anybody
+ * holds a reference to it, so that a lookup always finds the live
+ * instance, and the cache pins the recently used values on top of
+ * that.  Unlike SharedLRU:
+ *
+ * - every shard has its own lock, and a hit only takes it shared: it
+ *   marks the value referenced instead of moving it to the front of a
+ *   list, and the pinned values are evicted in CLOCK order, giving the
+ *   referenced ones a second chance.
+ * - the capacity of each shard adapts to its hit rate between a floor
+ *   and a ceiling: it doubles when a window of lookups misses often
+ *   enough to evict, and halves when nearly every lookup hits.
+ */
+template <class K, class V, class H = std::hash<K>>
+class ShardedSharedLRU {
+public:
+  using VPtr = std::shared_ptr<V>;
+
+private:
+  using WeakVPtr = std::weak_ptr<V>;
+  /// lookups a shard sees between two adjustments of its capacity
+  static constexpr uint64_t ADAPT_WINDOW = 1024;
+
+  struct Entry;
+  using clock_list_t = std::list<std::pair<Entry*, VPtr>>;
+
+  struct Entry {
+    WeakVPtr weak;
+    V* ptr;
+    /// valid if pinned
+    typename clock_list_t::iterator pos;
+    bool pinned = false;
+    std::atomic<bool> referenced{false};
+    explicit Entry(const VPtr& val) : weak{val}, ptr{val.get()} {}
+  };
+
+  struct Shard {
+    ceph::shared_mutex lock =
+      ceph::make_shared_mutex("ShardedSharedLRU::Shard::lock");
+    std::condition_variable_any cond;
+    std::map<K, Entry> weak_refs;
+    ceph::unordered_map<K, Entry*, H> index;
+    /// the pinned values, the hand of the clock at the front
+    clock_list_t clock;
+    size_t capacity = 0;
+    size_t min_capacity = 0;
+    size_t max_capacity = 0;
+    std::atomic<uint64_t> hits{0};
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+  };
+
+  CephContext *cct;
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  Shard& get_shard(const K& key) {
+    return *shards[H{}(key) % shards.size()];
+  }
+
+  static size_t per_shard(size_t size, size_t num_shards) {
+    return std::max<size_t>(1, (size + num_shards - 1) / num_shards);
+  }
+
+  void trim(Shard& s, std::list<VPtr> *to_release) {
+    while (s.clock.size() > s.capacity) {
+      auto& [entry, val] = s.clock.front();
+      if (entry->referenced.exchange(false, std::memory_order_relaxed)) {
+	s.clock.splice(s.clock.end(), s.clock, s.clock.begin());
+      } else {
+	to_release->push_back(std::move(val));
+	entry->pinned = false;
+	s.clock.pop_front();
+	++s.evictions;
+      }
+    }
+  }
+
+  void pin(Shard& s, Entry& entry, const VPtr& val,
+	   std::list<VPtr> *to_release) {
+    if (!entry.pinned) {
+      entry.pos = s.clock.emplace(s.clock.end(), &entry, val);
+      entry.pinned = true;
+      entry.referenced.store(false, std::memory_order_relaxed);
+    }
+    trim(s, to_release);
+  }
+
+  /// a lookup missed the pinned values, see if the capacity should change
+  void miss(Shard& s, std::list<VPtr> *to_release) {
+    ++s.misses;
+    const uint64_t lookups = s.hits.load(std::memory_order_relaxed) + s.misses;
+    if (lookups >= ADAPT_WINDOW) {
+      if (s.evictions && s.misses * 8 > lookups) {
+	s.capacity = std::min(s.max_capacity, s.capacity * 2);
+      } else if (s.misses * 64 < lookups) {
+	s.capacity = std::max(s.min_capacity, s.capacity / 2);
+      }
+      s.hits.store(0, std::memory_order_relaxed);
+      s.misses = 0;
+      s.evictions = 0;
+    }
+    trim(s, to_release);
+  }
+
+  void unpin(Shard& s, Entry& entry, std::list<VPtr> *to_release) {
+    if (entry.pinned) {
+      to_release->push_back(std::move(entry.pos->second));
+      s.clock.erase(entry.pos);
+      entry.pinned = false;
+    }
+  }
+
+  /// the hit path: the shard's lock is only taken shared
+  VPtr lookup_pinned(Shard& s, const K& key) {
+    std::shared_lock l{s.lock};
+    auto i = s.index.find(key);
+    if (i == s.index.end() || !i->second->pinned) {
+      return VPtr{};
+    }
+    VPtr val = i->second->weak.lock();
+    ceph_assert(val);
+    i->second->referenced.store(true, std::memory_order_relaxed);
+    s.hits.fetch_add(1, std::memory_order_relaxed);
+    return val;
+  }
+
+  void remove(const K& key, V *valptr) {
+    auto& s = get_shard(key);
+    std::unique_lock l{s.lock};
+    if (auto i = s.weak_refs.find(key);
+	i != s.weak_refs.end() && i->second.ptr == valptr) {
+      s.index.erase(key);
+      s.weak_refs.erase(i);
+    }
+    s.cond.notify_all();
+  }
+
+  class Cleanup {
+  public:
+    ShardedSharedLRU<K, V, H> *cache;
+    K key;
+    Cleanup(ShardedSharedLRU<K, V, H> *cache, K key) : cache(cache), key(key) {}
+    void operator()(V *ptr) {
+      cache->remove(key, ptr);
+      delete ptr;
+    }
+  };
+
+  /// the slow path, find the live value of key and pin it, create one if
+  /// asked to
+  VPtr lookup_slow(Shard& s, const K& key, bool create) {
+    VPtr val;
+    std::list<VPtr> to_release;
+    {
+      std::unique_lock l{s.lock};
+      Entry* entry = nullptr;
+      s.cond.wait(l, [&s, &key, &val, &entry] {
+	if (auto i = s.index.find(key); i != s.index.end()) {
+	  entry = i->second;
+	  // wait for the cleanup of a value on its way out
+	  val = entry->weak.lock();
+	  return bool(val);
+	} else {
+	  entry = nullptr;
+	  return true;
+	}
+      });
+      miss(s, &to_release);
+      if (!val) {
+	if (!create) {
+	  return val;
+	}
+	val = VPtr{new V{}, Cleanup{this, key}};
+	auto [i, inserted] = s.weak_refs.emplace(std::piecewise_construct,
+						 std::forward_as_tuple(key),
+						 std::forward_as_tuple(val));
+	ceph_assert(inserted);
+	entry = &i->second;
+	s.index.emplace(key, entry);
+      }
+      pin(s, *entry, val, &to_release);
+    }
+    return val;
+  }
+
+public:
+  ShardedSharedLRU(CephContext *cct, size_t min_size, size_t max_size,
+		   unsigned num_shards)
+    : cct(cct) {
+    num_shards = std::max(1u, num_shards);
+    for (unsigned i = 0; i < num_shards; ++i) {
+      shards.push_back(std::make_unique<Shard>());
+    }
+    set_size(min_size, max_size);
+  }
+
+  ~ShardedSharedLRU() {
+    clear();
+    if (!empty()) {
+      lderr(cct) << "leaked refs:\n";
+      dump_weak_refs(*_dout);
+      *_dout << dendl;
+      if (cct->_conf.get_val<bool>("debug_asserts_on_shutdown")) {
+	ceph_assert(empty());
+      }
+    }
+  }
+
+  /// the number of pinned values
+  int get_count() {
+    int count = 0;
+    for (auto& s : shards) {
+      std::shared_lock l{s->lock};
+      count += s->clock.size();
+    }
+    return count;
+  }
+
+  /// the number of values the cache may pin at the moment
+  size_t get_capacity() {
+    size_t capacity = 0;
+    for (auto& s : shards) {
+      std::shared_lock l{s->lock};
+      capacity += s->capacity;
+    }
+    return capacity;
+  }
+
+  void dump_weak_refs(std::ostream& out) {
+    for (auto& s : shards) {
+      std::shared_lock l{s->lock};
+      for (const auto& [key, entry] : s->weak_refs) {
+	out << __func__ << " " << this << " weak_refs: "
+	    << key << " = " << entry.ptr
+	    << " with " << entry.weak.use_count() << " refs"
+	    << std::endl;
+      }
+    }
+  }
+
+  /**
+   * let every shard's capacity move between min_size and max_size
+   * divided by the number of shards, setting max_size to min_size
+   * pins the capacity.
+   */
+  void set_size(size_t min_size, size_t max_size) {
+    max_size = std::max(min_size, max_size);
+    for (auto& s : shards) {
+      std::list<VPtr> to_release;
+      std::unique_lock l{s->lock};
+      s->min_capacity = per_shard(min_size, shards.size());
+      s->max_capacity = per_shard(max_size, shards.size());
+      s->capacity = std::clamp(s->capacity, s->min_capacity, s->max_capacity);
+      trim(*s, &to_release);
+      l.unlock();
+    }
+  }
+
+  /// unpin all values
+  void clear() {
+    for (auto& s : shards) {
+      std::list<VPtr> to_release;
+      std::unique_lock l{s->lock};
+      for (auto& [entry, val] : s->clock) {
+	entry->pinned = false;
+	to_release.push_back(std::move(val));
+      }
+      s->clock.clear();
+      l.unlock();
+    }
+  }
+
+  /// unpin the values in [from, to], note that to is inclusive
+  void clear_range(const K& from, const K& to) {
+    for (auto& s : shards) {
+      std::list<VPtr> to_release;
+      std::unique_lock l{s->lock};
+      auto from_iter = s->weak_refs.lower_bound(from);
+      auto to_iter = s->weak_refs.upper_bound(to);
+      for (auto i = from_iter; i != to_iter; ++i) {
+	unpin(*s, i->second, &to_release);
+      }
+      l.unlock();
+    }
+  }
+
+  /// the live value with the smallest key greater than key
+  bool get_next(const K &key, std::pair<K, VPtr> *next) {
+    std::optional<std::pair<K, VPtr>> best;
+    for (auto& s : shards) {
+      std::pair<K, VPtr> r;
+      {
+	std::shared_lock l{s->lock};
+	auto i = s->weak_refs.upper_bound(key);
+	for (; i != s->weak_refs.end(); ++i) {
+	  if (best && !(i->first < best->first)) {
+	    break;
+	  }
+	  if (r.second = i->second.weak.lock(); r.second) {
+	    r.first = i->first;
+	    break;
+	  }
+	}
+      }
+      if (r.second) {
+	best = std::move(r);
+      }
+    }
+    if (!best) {
+      return false;
+    }
+    if (next) {
+      *next = std::move(*best);
+    }
+    return true;
+  }
+
+  VPtr lookup(const K& key) {
+    auto& s = get_shard(key);
+    if (auto val = lookup_pinned(s, key); val) {
+      return val;
+    }
+    return lookup_slow(s, key, false);
+  }
+
+  VPtr lookup_or_create(const K& key) {
+    auto& s = get_shard(key);
+    if (auto val = lookup_pinned(s, key); val) {
+      return val;
+    }
+    return lookup_slow(s, key, true);
+  }
+
+  /**
+   * empty()
+   *
+   * Returns true iff there are no live references left to anything that has been
+   * in the cache.
+   */
+  bool empty() {
+    for (auto& s : shards) {
+      std::shared_lock l{s->lock};
+      if (!s->weak_refs.empty()) {
+	return false;
+      }
+    }
+    return true;
+  }
+};
+
+#endif
@@ -15,10 +15,12 @@
 #ifndef CEPH_COMPRESSOR_H
 #define CEPH_COMPRESSOR_H
 
+#include <cerrno>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 #include "include/ceph_assert.h"    // boost clobbers this
 #include "include/common_fwd.h"
 #include "include/buffer.h"
@@ -96,6 +98,36 @@ public:
   // alignment with decode methods
   virtual int decompress(ceph::bufferlist::const_iterator &p, size_t compressed_len, ceph::bufferlist &out, std::optional<int32_t> compressor_message) = 0;
 
+  // pre-trained dictionaries
+  //
+  // A compressor that supports dictionaries compresses with the dictionary
+  // whose id is passed in via compressor_message, provided it has been
+  // loaded, and leaves the id there so that decompress() can find the same
+  // dictionary again.  If the dictionary is unknown compressor_message is
+  // reset and the data is compressed without one.
+  virtual bool supports_dictionary() const {
+    return false;
+  }
+  virtual int train_dictionary(const std::vector<ceph::bufferlist> &samples,
+			       size_t max_size,
+			       ceph::bufferlist *dict) {
+    return -EOPNOTSUPP;
+  }
+  virtual int load_dictionary(int32_t id, const ceph::bufferlist &dict) {
+    return -EOPNOTSUPP;
+  }
+  virtual bool has_dictionary(int32_t id) const {
+    return false;
+  }
+  virtual void unload_dictionary(int32_t id) {
+  }
+  // The dictionaries are loaded per instance, and create() hands out an
+  // instance shared by the whole process.  A user loading dictionaries of
+  // its own takes a new instance with none loaded instead.
+  virtual CompressorRef create_private() const {
+    return nullptr;
+  }
+
   static CompressorRef create(CephContext *cct, const std::string &type);
   static CompressorRef create(CephContext *cct, int alg);
 
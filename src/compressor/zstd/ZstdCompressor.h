@@ -17,7 +17,13 @@
 
 #define ZSTD_STATIC_LINKING_ONLY
 #include "zstd/lib/zstd.h"
+#include "zstd/lib/zdict.h"
 
+#include <map>
+#include <memory>
+#include <shared_mutex>
+
+#include "common/ceph_mutex.h"
 #include "include/buffer.h"
 #include "include/encoding.h"
 #include "compressor/Compressor.h"
@@ -29,6 +35,15 @@ class ZstdCompressor : public Compressor {
   int compress(const ceph::buffer::list &src, ceph::buffer::list &dst, std::optional<int32_t> &compressor_message) override {
     ZSTD_CStream *s = ZSTD_createCStream();
     ZSTD_initCStream_srcSize(s, cct->_conf->compressor_zstd_level, src.length());
+    std::shared_ptr<Dictionary> dict;
+    if (compressor_message) {
+      dict = get_dictionary(*compressor_message);
+      if (dict) {
+	ZSTD_CCtx_refCDict(s, dict->cdict);
+      } else {
+	compressor_message.reset();
+      }
+    }
     auto p = src.begin();
     size_t left = src.length();
 
@@ -48,6 +63,7 @@ class ZstdCompressor : public Compressor {
       ZSTD_EndDirective const zed = (left==0) ? ZSTD_e_end : ZSTD_e_continue;
       size_t r = ZSTD_compressStream2(s, &outbuf, &inbuf, zed);
       if (ZSTD_isError(r)) {
+	ZSTD_freeCStream(s);
 	return -EINVAL;
       }
     }
@@ -82,10 +98,21 @@ class ZstdCompressor : public Compressor {
     outbuf.dst = dstptr.c_str();
     outbuf.size = dstptr.length();
     outbuf.pos = 0;
+    std::shared_ptr<Dictionary> dict;
+    if (compressor_message) {
+      dict = get_dictionary(*compressor_message);
+      if (!dict) {
+	return -ENOENT;
+      }
+    }
     ZSTD_DStream *s = ZSTD_createDStream();
     ZSTD_initDStream(s);
+    if (dict) {
+      ZSTD_DCtx_refDDict(s, dict->ddict);
+    }
     while (compressed_len > 0) {
       if (p.end()) {
+	ZSTD_freeDStream(s);
 	return -1;
       }
       ZSTD_inBuffer_s inbuf;
@@ -100,8 +127,88 @@ class ZstdCompressor : public Compressor {
     dst.append(dstptr, 0, outbuf.pos);
     return 0;
   }
+
+  bool supports_dictionary() const override {
+    return true;
+  }
+
+  int train_dictionary(const std::vector<ceph::buffer::list> &samples,
+		       size_t max_size,
+		       ceph::buffer::list *dict) override {
+    // ZDICT wants all samples in one contiguous buffer
+    ceph::buffer::list all;
+    std::vector<size_t> sizes;
+    sizes.reserve(samples.size());
+    for (auto& sample : samples) {
+      if (sample.length() == 0) {
+	continue;
+      }
+      all.append(sample);
+      sizes.push_back(sample.length());
+    }
+    if (sizes.empty()) {
+      return -EINVAL;
+    }
+    ceph::buffer::ptr dictptr(max_size);
+    size_t r = ZDICT_trainFromBuffer(dictptr.c_str(), dictptr.length(),
+				     all.c_str(), sizes.data(), sizes.size());
+    if (ZDICT_isError(r)) {
+      return -EINVAL;
+    }
+    dict->append(dictptr, 0, r);
+    return 0;
+  }
+
+  int load_dictionary(int32_t id, const ceph::buffer::list &dict) override {
+    ceph::buffer::list bl = dict;
+    auto d = std::make_shared<Dictionary>();
+    d->cdict = ZSTD_createCDict(bl.c_str(), bl.length(),
+				cct->_conf->compressor_zstd_level);
+    d->ddict = ZSTD_createDDict(bl.c_str(), bl.length());
+    if (!d->cdict || !d->ddict) {
+      return -EINVAL;
+    }
+    std::unique_lock l(dict_lock);
+    dicts[id] = std::move(d);
+    return 0;
+  }
+
+  bool has_dictionary(int32_t id) const override {
+    return get_dictionary(id) != nullptr;
+  }
+
+  void unload_dictionary(int32_t id) override {
+    std::unique_lock l(dict_lock);
+    dicts.erase(id);
+  }
+
+  CompressorRef create_private() const override {
+    return std::make_shared<ZstdCompressor>(cct);
+  }
+
  private:
+  struct Dictionary {
+    ZSTD_CDict *cdict = nullptr;
+    ZSTD_DDict *ddict = nullptr;
+    ~Dictionary() {
+      ZSTD_freeCDict(cdict);
+      ZSTD_freeDDict(ddict);
+    }
+  };
+
+  std::shared_ptr<Dictionary> get_dictionary(int32_t id) const {
+    std::shared_lock l(dict_lock);
+    auto p = dicts.find(id);
+    if (p == dicts.end()) {
+      return nullptr;
+    }
+    return p->second;
+  }
+
   CephContext *const cct;
+  mutable ceph::shared_mutex dict_lock =
+    ceph::make_shared_mutex("ZstdCompressor::dict_lock");
+  std::map<int32_t, std::shared_ptr<Dictionary>> dicts;
 };
 
 #endif
@@ -202,6 +202,71 @@ int ErasureCode::encode(const set<int> &want_to_encode,
   return 0;
 }
 
+int ErasureCode::encode_stripes(const set<int> &want_to_encode,
+                                const bufferlist &in,
+                                unsigned stripe_width,
+                                map<int, bufferlist> *encoded)
+{
+  unsigned int k = get_data_chunk_count();
+  unsigned int m = get_chunk_count() - k;
+  if (stripe_width == 0 || in.length() % stripe_width)
+    return -EINVAL;
+  unsigned stripes = in.length() / stripe_width;
+  unsigned blocksize = get_chunk_size(stripe_width);
+
+  if (blocksize * k != stripe_width || blocksize % SIMD_ALIGN) {
+    // stripes that need padding, or chunks that can't all be aligned
+    // in place: let encode() prepare them one at a time
+    for (unsigned s = 0; s < stripes; s++) {
+      bufferlist stripe;
+      stripe.substr_of(in, s * stripe_width, stripe_width);
+      map<int, bufferlist> one;
+      int r = encode(want_to_encode, stripe, &one);
+      if (r)
+	return r;
+      for (auto &&[i, chunk] : one)
+	(*encoded)[i].claim_append(chunk);
+    }
+    return 0;
+  }
+
+  // with buffers a multiple of blocksize in size no chunk straddles
+  // two of them; this is a no-op for the usual aligned input
+  bufferlist data = in;
+  data.rebuild_aligned_size_and_memory(blocksize, SIMD_ALIGN);
+
+  vector<bufferptr> coding;
+  coding.reserve(m);
+  for (unsigned int i = 0; i < m; i++)
+    coding.push_back(buffer::create_aligned(stripes * blocksize, SIMD_ALIGN));
+
+  for (unsigned s = 0; s < stripes; s++) {
+    map<int, bufferlist> chunks;
+    for (unsigned int i = 0; i < k; i++) {
+      bufferlist &chunk = chunks[chunk_index(i)];
+      chunk.substr_of(data, s * stripe_width + i * blocksize, blocksize);
+      ceph_assert(chunk.is_contiguous());
+    }
+    for (unsigned int i = 0; i < m; i++) {
+      chunks[chunk_index(k + i)].push_back(
+	bufferptr(coding[i], s * blocksize, blocksize));
+    }
+    int r = encode_chunks(want_to_encode, &chunks);
+    if (r)
+      return r;
+    for (unsigned int i = 0; i < k; i++) {
+      int id = chunk_index(i);
+      if (want_to_encode.count(id))
+	(*encoded)[id].claim_append(chunks[id]);
+    }
+  }
+  for (unsigned int i = 0; i < m; i++) {
+    if (want_to_encode.count(chunk_index(k + i)))
+      (*encoded)[chunk_index(k + i)].push_back(std::move(coding[i]));
+  }
+  return 0;
+}
+
 int ErasureCode::_decode(const set<int> &want_to_read,
 			 const map<int, bufferlist> &chunks,
 			 map<int, bufferlist> *decoded)
@@ -328,6 +393,28 @@ int ErasureCode::to_string(const std::string &name,
   return 0;
 }
 
+int ErasureCode::encode_delta(const bufferlist &old_data,
+			      const bufferlist &new_data,
+			      bufferlist *delta)
+{
+  // addition and subtraction are both xor in GF(2^w)
+  if (old_data.length() != new_data.length())
+    return -EINVAL;
+  bufferptr d(buffer::create_aligned(old_data.length(), SIMD_ALIGN));
+  old_data.begin().copy(old_data.length(), d.c_str());
+  char *p = d.c_str();
+  for (auto &bp : new_data.buffers()) {
+    const char *q = bp.c_str();
+    for (unsigned i = 0; i < bp.length(); ++i) {
+      p[i] ^= q[i];
+    }
+    p += bp.length();
+  }
+  delta->clear();
+  delta->push_back(std::move(d));
+  return 0;
+}
+
 int ErasureCode::decode_concat(const map<int, bufferlist> &chunks,
 			       bufferlist *decoded)
 {
@@ -23,6 +23,7 @@
  */ 
 
 #include "ErasureCodeInterface.h"
+#include "ErasureCodePlanCache.h"
 
 namespace ceph {
 
@@ -79,6 +80,11 @@ namespace ceph {
                        const bufferlist &in,
                        std::map<int, bufferlist> *encoded) override;
 
+    int encode_stripes(const std::set<int> &want_to_encode,
+                       const bufferlist &in,
+                       unsigned stripe_width,
+                       std::map<int, bufferlist> *encoded) override;
+
     int decode(const std::set<int> &want_to_read,
                 const std::map<int, bufferlist> &chunks,
                 std::map<int, bufferlist> *decoded, int chunk_size) override;
@@ -113,6 +119,24 @@ namespace ceph {
     int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) override;
 
+    bool supports_parity_delta() const override {
+      return false;
+    }
+
+    int encode_delta(const bufferlist &old_data,
+		     const bufferlist &new_data,
+		     bufferlist *delta) override;
+
+    int apply_delta(const std::map<int, bufferlist> &deltas,
+		    std::map<int, bufferlist> *parity) override {
+      return -EOPNOTSUPP;
+    }
+
+    /// counters of the decode plans the plugin keeps, if it keeps any
+    virtual ErasureCodePlanCacheStats get_decode_plan_cache_stats() const {
+      return ErasureCodePlanCacheStats();
+    }
+
   protected:
     int parse(const ErasureCodeProfile &profile,
 	      std::ostream *ss);
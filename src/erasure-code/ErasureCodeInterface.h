@@ -366,6 +366,33 @@ namespace ceph {
                        const bufferlist &in,
                        std::map<int, bufferlist> *encoded) = 0;
 
+    /**
+     * Encode the **in.length() / stripe_width** stripes found back
+     * to back in **in** in a single call. On success **encoded**
+     * holds, for each chunk index of **want_to_encode**, chunk i of
+     * every stripe concatenated in order: the same content as calling
+     * encode() once per stripe and appending the results.
+     *
+     * Data chunks point into **in** when it is suitably aligned,
+     * otherwise **in** is copied once, as a whole. Each coding chunk
+     * is a single buffer, allocated aligned up front for all stripes
+     * and written in place, so no per stripe allocation or copy takes
+     * place.
+     *
+     * The **encoded** map is expected to be a pointer to an empty
+     * map and **in.length()** a multiple of **stripe_width**.
+     *
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] in stripes to be encoded
+     * @param [in] stripe_width length of a single stripe
+     * @param [out] encoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_stripes(const std::set<int> &want_to_encode,
+                               const bufferlist &in,
+                               unsigned stripe_width,
+                               std::map<int, bufferlist> *encoded) = 0;
+
 
     virtual int encode_chunks(const std::set<int> &want_to_encode,
                               std::map<int, bufferlist> *encoded) = 0;
@@ -459,6 +486,46 @@ namespace ceph {
      */
     virtual int decode_concat(const std::map<int, bufferlist> &chunks,
 			      bufferlist *decoded) = 0;
+
+    /**
+     * Return true if the parity chunks of a stripe can be brought up
+     * to date from the changes to some of its data chunks alone, with
+     * **encode_delta** and **apply_delta**. This holds for linear
+     * codes, where each parity chunk is a fixed linear combination of
+     * the data chunks, and allows a small overwrite to read and write
+     * just the modified data chunks and the parity chunks instead of
+     * the whole stripe.
+     *
+     * @return **true** if **apply_delta** is implemented
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute the change from **old_data** to **new_data**, two
+     * versions of the same data chunk, in the form expected by
+     * **apply_delta**.
+     *
+     * @param [in] old_data previous content of a data chunk
+     * @param [in] new_data new content of the chunk, same length
+     * @param [out] delta the change, same length
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_delta(const bufferlist &old_data,
+			     const bufferlist &new_data,
+			     bufferlist *delta) = 0;
+
+    /**
+     * Update **parity** for the changes in **deltas**. All buffers
+     * have the same length and come from the same stripe. The
+     * result is identical to encoding the stripe again with the
+     * new data chunks.
+     *
+     * @param [in] deltas map data chunk indexes to **encode_delta** output
+     * @param [in,out] parity map parity chunk indexes to their content
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferlist> &deltas,
+			    std::map<int, bufferlist> *parity) = 0;
   };
 
   typedef std::shared_ptr<ErasureCodeInterface> ErasureCodeInterfaceRef;
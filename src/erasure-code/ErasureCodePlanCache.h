@@ -0,0 +1,138 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#ifndef CEPH_ERASURE_CODE_PLAN_CACHE_H
+#define CEPH_ERASURE_CODE_PLAN_CACHE_H
+
+/*! @file ErasureCodePlanCache.h
+    @brief LRU cache of decode plans, keyed by erasure signature
+
+    What a plugin has to work out before it can decode (which layers
+    to run, in which order to visit the planes, ...) only depends on
+    which chunks are wanted and which are missing, never on the data.
+    During recovery the same few erasure patterns come back for every
+    object, so plugins keep the plans here instead of recomputing them
+    on each call, the way the isa plugin keeps its decoding tables.
+ */
+
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "common/ceph_mutex.h"
+
+namespace ceph {
+
+  struct ErasureCodePlanCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t plans = 0;
+
+    ErasureCodePlanCacheStats &operator+=(const ErasureCodePlanCacheStats &o) {
+      hits += o.hits;
+      misses += o.misses;
+      plans += o.plans;
+      return *this;
+    }
+  };
+
+  /// append tag and the chunks, e.g. "a+0+1+5", to a plan signature
+  inline void plan_signature_append(std::string *signature, char tag,
+				    const std::set<int> &chunks)
+  {
+    signature->push_back(tag);
+    for (auto c : chunks) {
+      signature->push_back('+');
+      signature->append(std::to_string(c));
+    }
+  }
+
+  template <typename Plan>
+  class ErasureCodePlanCache {
+  public:
+    typedef std::shared_ptr<const Plan> PlanRef;
+
+    static const size_t DEFAULT_SIZE = 1024;
+
+    explicit ErasureCodePlanCache(size_t max = DEFAULT_SIZE) : max(max) {}
+
+    /// the number of plans kept, 0 disables the cache
+    void set_max(size_t m) {
+      std::lock_guard l(lock);
+      max = m;
+      trim();
+    }
+
+    /**
+     * Return the plan for signature, calling make() to build it if
+     * it is not cached.  make() runs without the lock held, two
+     * threads missing on the same signature may both build it.
+     */
+    template <typename F>
+    PlanRef get_or_create(const std::string &signature, F &&make) {
+      {
+	std::lock_guard l(lock);
+	auto i = plans.find(signature);
+	if (i != plans.end()) {
+	  ++hits;
+	  lru.splice(lru.begin(), lru, i->second.first);
+	  return i->second.second;
+	}
+	++misses;
+      }
+      PlanRef plan = std::make_shared<const Plan>(make());
+      std::lock_guard l(lock);
+      if (max == 0 || plans.count(signature))
+	return plan;
+      lru.push_front(signature);
+      plans.emplace(signature, std::make_pair(lru.begin(), plan));
+      trim();
+      return plan;
+    }
+
+    ErasureCodePlanCacheStats get_stats() const {
+      std::lock_guard l(lock);
+      ErasureCodePlanCacheStats stats;
+      stats.hits = hits;
+      stats.misses = misses;
+      stats.plans = plans.size();
+      return stats;
+    }
+
+    void clear() {
+      std::lock_guard l(lock);
+      plans.clear();
+      lru.clear();
+    }
+
+  private:
+    void trim() {
+      while (plans.size() > max) {
+	plans.erase(lru.back());
+	lru.pop_back();
+      }
+    }
+
+    mutable ceph::mutex lock = ceph::make_mutex("ErasureCodePlanCache::lock");
+    size_t max;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    std::list<std::string> lru;
+    std::map<std::string,
+	     std::pair<std::list<std::string>::iterator, PlanRef>> plans;
+  };
+
+}
+
+#endif
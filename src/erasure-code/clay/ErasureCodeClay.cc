@@ -83,8 +83,13 @@ int ErasureCodeClay::init(ErasureCodeProfile &profile,
 		       pft.profile,
 		       &pft.erasure_code,
 		       ss);
-  return r;
+  if (r)
+    return r;
 
+  uint64_t plans = g_conf().get_val<uint64_t>("erasure_code_plan_cache_size");
+  repair_plans.set_max(plans);
+  layered_plans.set_max(plans);
+  return 0;
 }
 
 unsigned int ErasureCodeClay::get_chunk_size(unsigned int object_size) const
@@ -111,9 +116,8 @@ int ErasureCodeClay::decode(const set<int> &want_to_read,
 			    map<int, bufferlist> *decoded, int chunk_size)
 {
   set<int> avail;
-  for ([[maybe_unused]] auto& [node, bl] : chunks) {
-    avail.insert(node);
-    (void)bl;  // silence -Wunused-variable
+  for (auto& p : chunks) {
+    avail.insert(p.first);
   }
 
   if (is_repair(want_to_read, avail) && 
@@ -400,7 +404,6 @@ int ErasureCodeClay::repair(const set<int> &want_to_read,
   ceph_assert((want_to_read.size() == 1) && (chunks.size() == (unsigned)d));
 
   int repair_sub_chunk_no = get_repair_sub_chunk_count(want_to_read);
-  vector<pair<int, int>> repair_sub_chunks_ind;
 
   unsigned repair_blocksize = chunks.begin()->second.length();
   assert(repair_blocksize%repair_sub_chunk_no == 0);
@@ -410,9 +413,19 @@ int ErasureCodeClay::repair(const set<int> &want_to_read,
 
   ceph_assert(chunksize == (unsigned)chunk_size);
 
+  set<int> available_chunks;
+  for (auto& p : chunks) {
+    available_chunks.insert(p.first);
+  }
+  string signature;
+  plan_signature_append(&signature, 'w', want_to_read);
+  plan_signature_append(&signature, 'a', available_chunks);
+  auto plan = repair_plans.get_or_create(signature, [&] {
+    return make_repair_plan(*want_to_read.begin(), available_chunks);
+  });
+
   map<int, bufferlist> recovered_data;
   map<int, bufferlist> helper_data;
-  set<int> aloof_nodes;
 
   for (int i =  0; i < k + m; i++) {
     // included helper data only for d+nu nodes.
@@ -422,18 +435,11 @@ int ErasureCodeClay::repair(const set<int> &want_to_read,
       } else {
 	helper_data[i+nu] = found->second;
       }
-    } else {
-      if (i != *want_to_read.begin()) { // aloof node case.
-        int aloof_node_id = (i < k) ? i: i+nu;
-        aloof_nodes.insert(aloof_node_id);
-      } else {
-        bufferptr ptr(buffer::create_aligned(chunksize, SIMD_ALIGN));
-	ptr.zero();
-        int lost_node_id = (i < k) ? i : i+nu;
-        (*repaired)[i].push_back(ptr);
-        recovered_data[lost_node_id] = (*repaired)[i];
-        get_repair_subchunks(lost_node_id, repair_sub_chunks_ind);
-      }
+    } else if (i == *want_to_read.begin()) {
+      bufferptr ptr(buffer::create_aligned(chunksize, SIMD_ALIGN));
+      ptr.zero();
+      (*repaired)[i].push_back(ptr);
+      recovered_data[plan->lost_node] = (*repaired)[i];
     }
   }
 
@@ -444,12 +450,11 @@ int ErasureCodeClay::repair(const set<int> &want_to_read,
     helper_data[i].push_back(ptr);
   }
 
-  ceph_assert(helper_data.size()+aloof_nodes.size()+recovered_data.size() ==
+  ceph_assert(helper_data.size()+plan->aloof_nodes.size()+recovered_data.size() ==
 	      (unsigned) q*t);
 
-  int r = repair_one_lost_chunk(recovered_data, aloof_nodes,
-				helper_data, repair_blocksize,
-				repair_sub_chunks_ind);
+  int r = repair_one_lost_chunk(recovered_data, helper_data,
+				repair_blocksize, *plan);
 
   // clear buffers created for the purpose of shortening
   for (int i = k; i < k+nu; i++) {
@@ -459,45 +464,74 @@ int ErasureCodeClay::repair(const set<int> &want_to_read,
   return r;
 }
 
-int ErasureCodeClay::repair_one_lost_chunk(map<int, bufferlist> &recovered_data,
-					   set<int> &aloof_nodes,
-					   map<int, bufferlist> &helper_data,
-					   int repair_blocksize,
-					   vector<pair<int,int>> &repair_sub_chunks_ind)
+ErasureCodeClay::RepairPlan
+ErasureCodeClay::make_repair_plan(int lost_chunk,
+				  const set<int> &available_chunks)
 {
-  unsigned repair_subchunks = (unsigned)sub_chunk_no / q;
-  unsigned sub_chunksize = repair_blocksize / repair_subchunks;
+  RepairPlan plan;
+  plan.lost_node = (lost_chunk < k) ? lost_chunk : lost_chunk+nu;
+  for (int i = 0; i < k + m; i++) {
+    if (i != lost_chunk && available_chunks.count(i) == 0) { // aloof node case.
+      plan.aloof_nodes.insert((i < k) ? i : i+nu);
+    }
+  }
+  get_repair_subchunks(plan.lost_node, plan.sub_chunks_ind);
 
   int z_vec[t];
   map<int, set<int> > ordered_planes;
-  map<int, int> repair_plane_to_ind;
-  int count_retrieved_sub_chunks = 0;
   int plane_ind = 0;
 
-  bufferptr buf(buffer::create_aligned(sub_chunksize, SIMD_ALIGN));
-  bufferlist temp_buf;
-  temp_buf.push_back(buf);
-
-  for (auto [index,count] : repair_sub_chunks_ind) {
+  plan.plane_to_ind.assign(sub_chunk_no, -1);
+  for (auto [index,count] : plan.sub_chunks_ind) {
     for (int j = index; j < index + count; j++) {
       get_plane_vector(j, z_vec);
       int order = 0;
       // check across all erasures and aloof nodes
-      for ([[maybe_unused]] auto& [node, bl] : recovered_data) {
-        if (node % q == z_vec[node / q]) order++;
-        (void)bl;  // silence -Wunused-variable
-      }
-      for (auto node : aloof_nodes) {
+      if (plan.lost_node % q == z_vec[plan.lost_node / q]) order++;
+      for (auto node : plan.aloof_nodes) {
         if (node % q == z_vec[node / q]) order++;
       }
       ceph_assert(order > 0);
       ordered_planes[order].insert(j);
       // to keep track of a sub chunk within helper buffer recieved
-      repair_plane_to_ind[j] = plane_ind;
+      plan.plane_to_ind[j] = plane_ind;
       plane_ind++;
     }
   }
-  assert((unsigned)plane_ind == repair_subchunks);
+  ceph_assert(plane_ind == sub_chunk_no / q);
+
+  for (int order = 1; ordered_planes.count(order) > 0; order++) {
+    plan.ordered_planes.emplace_back(ordered_planes[order].begin(),
+				     ordered_planes[order].end());
+  }
+
+  for (int i = 0; i < q; i++) {
+    plan.erasures.insert(plan.lost_node - plan.lost_node % q + i);
+  }
+  for (auto node : plan.aloof_nodes) {
+    plan.erasures.insert(node);
+  }
+  return plan;
+}
+
+int ErasureCodeClay::repair_one_lost_chunk(map<int, bufferlist> &recovered_data,
+					   map<int, bufferlist> &helper_data,
+					   int repair_blocksize,
+					   const RepairPlan &plan)
+{
+  unsigned repair_subchunks = (unsigned)sub_chunk_no / q;
+  unsigned sub_chunksize = repair_blocksize / repair_subchunks;
+
+  int z_vec[t];
+  int count_retrieved_sub_chunks = 0;
+  const set<int> &aloof_nodes = plan.aloof_nodes;
+  const set<int> &erasures = plan.erasures;
+  const vector<int> &repair_plane_to_ind = plan.plane_to_ind;
+  const int lost_chunk = plan.lost_node;
+
+  bufferptr buf(buffer::create_aligned(sub_chunksize, SIMD_ALIGN));
+  bufferlist temp_buf;
+  temp_buf.push_back(buf);
 
   for (int i = 0; i < q*t; i++) {
     if (U_buf[i].length() == 0) {
@@ -507,28 +541,10 @@ int ErasureCodeClay::repair_one_lost_chunk(map<int, bufferlist> &recovered_data,
     }
   }
 
-  int lost_chunk;
-  int count = 0;
-  for ([[maybe_unused]] auto& [node, bl] : recovered_data) {
-    lost_chunk = node;
-    count++;
-    (void)bl;  // silence -Wunused-variable
-  }
-  ceph_assert(count == 1);
+  ceph_assert(recovered_data.size() == 1);
 
-  set<int> erasures;
-  for (int i = 0; i < q; i++) {
-    erasures.insert(lost_chunk - lost_chunk % q + i);
-  }
-  for (auto node : aloof_nodes) {
-    erasures.insert(node);
-  }
-
-  for (int order = 1; ;order++) {
-    if (ordered_planes.count(order) == 0) {
-      break;
-    }
-    for (auto z : ordered_planes[order]) {
+  for (const auto &planes : plan.ordered_planes) {
+    for (auto z : planes) {
       get_plane_vector(z, z_vec);
 
       for (int y = 0; y < t; y++) {
@@ -549,8 +565,8 @@ int ErasureCodeClay::repair_one_lost_chunk(map<int, bufferlist> &recovered_data,
 	      i3 = 2;
 	    }
 	    if (aloof_nodes.count(node_sw) > 0) {
-	      assert(repair_plane_to_ind.count(z) > 0);
-	      assert(repair_plane_to_ind.count(z_sw) > 0);
+	      assert(repair_plane_to_ind[z] >= 0);
+	      assert(repair_plane_to_ind[z_sw] >= 0);
 	      pft_erasures.insert(i2);
 	      known_subchunks[i0].substr_of(helper_data[node_xy], repair_plane_to_ind[z]*sub_chunksize, sub_chunksize);
 	      known_subchunks[i3].substr_of(U_buf[node_sw], z_sw*sub_chunksize, sub_chunksize);
@@ -564,10 +580,10 @@ int ErasureCodeClay::repair_one_lost_chunk(map<int, bufferlist> &recovered_data,
 	      pft.erasure_code->decode_chunks(pft_erasures, known_subchunks, &pftsubchunks);
 	    } else {
 	      ceph_assert(helper_data.count(node_sw) > 0);
-	      ceph_assert(repair_plane_to_ind.count(z) > 0);
+	      ceph_assert(repair_plane_to_ind[z] >= 0);
 	      if (z_vec[y] != x){
 		pft_erasures.insert(i2);
-		ceph_assert(repair_plane_to_ind.count(z_sw) > 0);
+		ceph_assert(repair_plane_to_ind[z_sw] >= 0);
 		known_subchunks[i0].substr_of(helper_data[node_xy], repair_plane_to_ind[z]*sub_chunksize, sub_chunksize);
 		known_subchunks[i1].substr_of(helper_data[node_sw], repair_plane_to_ind[z_sw]*sub_chunksize, sub_chunksize);
 		pftsubchunks[i0] = known_subchunks[i0];
@@ -642,17 +658,10 @@ int ErasureCodeClay::repair_one_lost_chunk(map<int, bufferlist> &recovered_data,
 }
 
 
-int ErasureCodeClay::decode_layered(set<int> &erased_chunks,
-                                    map<int, bufferlist> *chunks)
+ErasureCodeClay::LayeredPlan
+ErasureCodeClay::make_layered_plan(set<int> erased_chunks)
 {
   int num_erasures = erased_chunks.size();
-
-  int size = (*chunks)[0].length();
-  ceph_assert(size%sub_chunk_no == 0);
-  int sc_size = size / sub_chunk_no;
-
-  ceph_assert(num_erasures > 0);
-
   for (int i = k+nu; (num_erasures < m) && (i < q*t); i++) {
     if ([[maybe_unused]] auto [it, added] = erased_chunks.emplace(i); added) {
       num_erasures++;
@@ -661,8 +670,36 @@ int ErasureCodeClay::decode_layered(set<int> &erased_chunks,
   }
   ceph_assert(num_erasures == m);
 
+  LayeredPlan plan;
   int max_iscore = get_max_iscore(erased_chunks);
   int order[sub_chunk_no];
+  set_planes_sequential_decoding_order(order, erased_chunks);
+  plan.planes.resize(max_iscore + 1);
+  for (int z = 0; z < sub_chunk_no; z++) {
+    if (order[z] <= max_iscore) {
+      plan.planes[order[z]].push_back(z);
+    }
+  }
+  plan.erasures = std::move(erased_chunks);
+  return plan;
+}
+
+int ErasureCodeClay::decode_layered(const set<int> &erasures,
+                                    map<int, bufferlist> *chunks)
+{
+  int size = (*chunks)[0].length();
+  ceph_assert(size%sub_chunk_no == 0);
+  int sc_size = size / sub_chunk_no;
+
+  ceph_assert(erasures.size() > 0);
+
+  string signature;
+  plan_signature_append(&signature, 'e', erasures);
+  auto plan = layered_plans.get_or_create(signature, [&] {
+    return make_layered_plan(erasures);
+  });
+  const set<int> &erased_chunks = plan->erasures;
+
   int z_vec[t];
   for (int i = 0; i < q*t; i++) {
     if (U_buf[i].length() == 0) {
@@ -672,35 +709,29 @@ int ErasureCodeClay::decode_layered(set<int> &erased_chunks,
     }
   }
 
-  set_planes_sequential_decoding_order(order, erased_chunks);
-
-  for (int iscore = 0; iscore <= max_iscore; iscore++) {
-   for (int z = 0; z < sub_chunk_no; z++) {
-      if (order[z] == iscore) {
-        decode_erasures(erased_chunks, z, chunks, sc_size);
-      }
+  for (const auto &planes : plan->planes) {
+    for (auto z : planes) {
+      decode_erasures(erased_chunks, z, chunks, sc_size);
     }
 
-    for (int z = 0; z < sub_chunk_no; z++) {
-      if (order[z] == iscore) {
-	get_plane_vector(z, z_vec);
-        for (auto node_xy : erased_chunks) {
-          int x = node_xy % q;
-          int y = node_xy / q;
-	  int node_sw = y*q+z_vec[y];
-          if (z_vec[y] != x) {
-            if (erased_chunks.count(node_sw) == 0) {
-	      recover_type1_erasure(chunks, x, y, z, z_vec, sc_size);
-	    } else if (z_vec[y] < x){
-              ceph_assert(erased_chunks.count(node_sw) > 0);
-              ceph_assert(z_vec[y] != x);
-              get_coupled_from_uncoupled(chunks, x, y, z, z_vec, sc_size);
-	    }
-	  } else {
-	    char* C = (*chunks)[node_xy].c_str();
-            char* U = U_buf[node_xy].c_str();
-            memcpy(&C[z*sc_size], &U[z*sc_size], sc_size);
+    for (auto z : planes) {
+      get_plane_vector(z, z_vec);
+      for (auto node_xy : erased_chunks) {
+        int x = node_xy % q;
+        int y = node_xy / q;
+        int node_sw = y*q+z_vec[y];
+        if (z_vec[y] != x) {
+          if (erased_chunks.count(node_sw) == 0) {
+            recover_type1_erasure(chunks, x, y, z, z_vec, sc_size);
+          } else if (z_vec[y] < x){
+            ceph_assert(erased_chunks.count(node_sw) > 0);
+            ceph_assert(z_vec[y] != x);
+            get_coupled_from_uncoupled(chunks, x, y, z, z_vec, sc_size);
           }
+        } else {
+          char* C = (*chunks)[node_xy].c_str();
+          char* U = U_buf[node_xy].c_str();
+          memcpy(&C[z*sc_size], &U[z*sc_size], sc_size);
         }
       }
     } // plane
@@ -890,3 +921,10 @@ void ErasureCodeClay::get_plane_vector(int z, int* z_vec)
     z = (z - z_vec[t-1-i]) / q;
   }
 }
+
+ErasureCodePlanCacheStats ErasureCodeClay::get_decode_plan_cache_stats() const
+{
+  ErasureCodePlanCacheStats stats = repair_plans.get_stats();
+  stats += layered_plans.get_stats();
+  return stats;
+}
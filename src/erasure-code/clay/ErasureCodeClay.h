@@ -32,6 +32,28 @@ public:
 
   std::map<int, ceph::bufferlist> U_buf;
 
+  // how repair_one_lost_chunk() goes about a lost chunk, given the
+  // nodes that are neither lost nor helpers
+  struct RepairPlan {
+    int lost_node = 0;
+    std::set<int> aloof_nodes;
+    std::set<int> erasures;
+    std::vector<std::pair<int, int>> sub_chunks_ind;
+    // repair planes, grouped by order starting from 1
+    std::vector<std::vector<int>> ordered_planes;
+    // where a plane is in the helper buffers, -1 if it isn't read
+    std::vector<int> plane_to_ind;
+  };
+  // how decode_layered() goes about a set of erasures
+  struct LayeredPlan {
+    // erasures padded up to m
+    std::set<int> erasures;
+    // planes grouped by intersection score
+    std::vector<std::vector<int>> planes;
+  };
+  ceph::ErasureCodePlanCache<RepairPlan> repair_plans;
+  ceph::ErasureCodePlanCache<LayeredPlan> layered_plans;
+
   struct ScalarMDS {
     ceph::ErasureCodeInterfaceRef erasure_code;
     ceph::ErasureCodeProfile profile;
@@ -84,6 +106,8 @@ public:
 
   virtual int parse(ceph::ErasureCodeProfile &profile, std::ostream *ss);
 
+  ceph::ErasureCodePlanCacheStats get_decode_plan_cache_stats() const override;
+
 private:
   int minimum_to_repair(const std::set<int> &want_to_read,
                         const std::set<int> &available_chunks,
@@ -93,11 +117,15 @@ private:
              const std::map<int, ceph::bufferlist> &chunks,
              std::map<int, ceph::bufferlist> *recovered, int chunk_size);
 
-  int decode_layered(std::set<int>& erased_chunks, std::map<int, ceph::bufferlist>* chunks);
+  RepairPlan make_repair_plan(int lost_chunk, const std::set<int> &available_chunks);
+
+  LayeredPlan make_layered_plan(std::set<int> erased_chunks);
+
+  int decode_layered(const std::set<int>& erased_chunks, std::map<int, ceph::bufferlist>* chunks);
 
-  int repair_one_lost_chunk(std::map<int, ceph::bufferlist> &recovered_data, std::set<int> &aloof_nodes,
+  int repair_one_lost_chunk(std::map<int, ceph::bufferlist> &recovered_data,
                             std::map<int, ceph::bufferlist> &helper_data, int repair_blocksize,
-                            std::vector<std::pair<int,int>> &repair_sub_chunks_ind);
+                            const RepairPlan &plan);
 
   void get_repair_subchunks(const int &lost_node,
 			    std::vector<std::pair<int, int>> &repair_sub_chunks_ind);
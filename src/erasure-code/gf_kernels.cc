@@ -0,0 +1,344 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <string.h>
+#include <algorithm>
+#include <array>
+
+#include "erasure-code/gf_kernels.h"
+#include "arch/probe.h"
+#include "arch/intel.h"
+#include "arch/arm.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+uint8_t ceph_gf_mul(uint8_t a, uint8_t b)
+{
+  uint8_t p = 0;
+  while (b) {
+    if (b & 1)
+      p ^= a;
+    a = (uint8_t)((a << 1) ^ ((a & 0x80) ? 0x1d : 0));
+    b >>= 1;
+  }
+  return p;
+}
+
+namespace {
+
+inline void gf_split_tables(uint8_t c, uint8_t lo[16], uint8_t hi[16])
+{
+  for (int i = 0; i < 16; ++i) {
+    lo[i] = ceph_gf_mul(c, (uint8_t)i);
+    hi[i] = ceph_gf_mul(c, (uint8_t)(i << 4));
+  }
+}
+
+void gf_xor_region_baseline(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t s, d;
+    memcpy(&s, src + i, sizeof(s));
+    memcpy(&d, dst + i, sizeof(d));
+    d ^= s;
+    memcpy(dst + i, &d, sizeof(d));
+  }
+  for (; i < len; ++i) {
+    dst[i] ^= src[i];
+  }
+}
+
+/*
+ * Multiplying by 0 or 1 is just a memset, copy or xor, which the
+ * table kernels would only do slower.  Returns true if it handled c.
+ */
+inline bool gf_mul_region_trivial(uint8_t c, const uint8_t *src,
+				  uint8_t *dst, size_t len, int add,
+				  ceph_gf_xor_region_func_t xor_region)
+{
+  if (c == 0) {
+    if (!add)
+      memset(dst, 0, len);
+    return true;
+  }
+  if (c == 1) {
+    if (add)
+      xor_region(src, dst, len);
+    else if (src != dst)
+      memmove(dst, src, len);
+    return true;
+  }
+  return false;
+}
+
+void gf_mul_region_tables(const uint8_t lo[16], const uint8_t hi[16],
+			  const uint8_t *src, uint8_t *dst, size_t len,
+			  int add)
+{
+  if (add) {
+    for (size_t i = 0; i < len; ++i) {
+      dst[i] ^= lo[src[i] & 0xf] ^ hi[src[i] >> 4];
+    }
+  } else {
+    for (size_t i = 0; i < len; ++i) {
+      dst[i] = lo[src[i] & 0xf] ^ hi[src[i] >> 4];
+    }
+  }
+}
+
+void gf_mul_region_baseline(uint8_t c, const uint8_t *src, uint8_t *dst,
+			    size_t len, int add)
+{
+  if (gf_mul_region_trivial(c, src, dst, len, add, gf_xor_region_baseline))
+    return;
+  uint8_t lo[16], hi[16];
+  gf_split_tables(c, lo, hi);
+  gf_mul_region_tables(lo, hi, src, dst, len, add);
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse2")))
+void gf_xor_region_sse2(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    for (int j = 0; j < 64; j += 16) {
+      __m128i s = _mm_loadu_si128((const __m128i*)(src + i + j));
+      __m128i d = _mm_loadu_si128((const __m128i*)(dst + i + j));
+      _mm_storeu_si128((__m128i*)(dst + i + j), _mm_xor_si128(s, d));
+    }
+  }
+  gf_xor_region_baseline(src + i, dst + i, len - i);
+}
+
+__attribute__((target("ssse3")))
+void gf_mul_region_ssse3(uint8_t c, const uint8_t *src, uint8_t *dst,
+			 size_t len, int add)
+{
+  if (gf_mul_region_trivial(c, src, dst, len, add, gf_xor_region_sse2))
+    return;
+  uint8_t lo[16], hi[16];
+  gf_split_tables(c, lo, hi);
+  const __m128i tlo = _mm_loadu_si128((const __m128i*)lo);
+  const __m128i thi = _mm_loadu_si128((const __m128i*)hi);
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i l = _mm_and_si128(x, mask);
+    __m128i h = _mm_and_si128(_mm_srli_epi64(x, 4), mask);
+    __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, l),
+			      _mm_shuffle_epi8(thi, h));
+    if (add)
+      p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i*)(dst + i)));
+    _mm_storeu_si128((__m128i*)(dst + i), p);
+  }
+  gf_mul_region_tables(lo, hi, src + i, dst + i, len - i, add);
+}
+
+__attribute__((target("avx2")))
+void gf_xor_region_avx2(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 128 <= len; i += 128) {
+    for (int j = 0; j < 128; j += 32) {
+      __m256i s = _mm256_loadu_si256((const __m256i*)(src + i + j));
+      __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i + j));
+      _mm256_storeu_si256((__m256i*)(dst + i + j), _mm256_xor_si256(s, d));
+    }
+  }
+  gf_xor_region_sse2(src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx2")))
+void gf_mul_region_avx2(uint8_t c, const uint8_t *src, uint8_t *dst,
+			size_t len, int add)
+{
+  if (gf_mul_region_trivial(c, src, dst, len, add, gf_xor_region_avx2))
+    return;
+  uint8_t lo[16], hi[16];
+  gf_split_tables(c, lo, hi);
+  // vpshufb looks up within each 128 bit lane, so repeat the tables
+  const __m256i tlo = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i*)lo));
+  const __m256i thi = _mm256_broadcastsi128_si256(
+    _mm_loadu_si128((const __m128i*)hi));
+  const __m256i mask = _mm256_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i l = _mm256_and_si256(x, mask);
+    __m256i h = _mm256_and_si256(_mm256_srli_epi64(x, 4), mask);
+    __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, l),
+				 _mm256_shuffle_epi8(thi, h));
+    if (add)
+      p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i*)(dst + i)));
+    _mm256_storeu_si256((__m256i*)(dst + i), p);
+  }
+  gf_mul_region_tables(lo, hi, src + i, dst + i, len - i, add);
+}
+
+__attribute__((target("avx512f")))
+void gf_xor_region_avx512(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 256 <= len; i += 256) {
+    for (int j = 0; j < 256; j += 64) {
+      __m512i s = _mm512_loadu_si512(src + i + j);
+      __m512i d = _mm512_loadu_si512(dst + i + j);
+      _mm512_storeu_si512(dst + i + j, _mm512_xor_si512(s, d));
+    }
+  }
+  gf_xor_region_avx2(src + i, dst + i, len - i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+void gf_mul_region_avx512(uint8_t c, const uint8_t *src, uint8_t *dst,
+			  size_t len, int add)
+{
+  if (gf_mul_region_trivial(c, src, dst, len, add, gf_xor_region_avx512))
+    return;
+  // one copy of the tables per 128 bit lane
+  uint8_t lo[64], hi[64];
+  gf_split_tables(c, lo, hi);
+  for (int j = 16; j < 64; j += 16) {
+    memcpy(lo + j, lo, 16);
+    memcpy(hi + j, hi, 16);
+  }
+  const __m512i tlo = _mm512_loadu_si512(lo);
+  const __m512i thi = _mm512_loadu_si512(hi);
+  const __m512i mask = _mm512_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m512i x = _mm512_loadu_si512(src + i);
+    __m512i l = _mm512_and_si512(x, mask);
+    __m512i h = _mm512_and_si512(_mm512_srli_epi16(x, 4), mask);
+    __m512i p = _mm512_xor_si512(_mm512_shuffle_epi8(tlo, l),
+				 _mm512_shuffle_epi8(thi, h));
+    if (add)
+      p = _mm512_xor_si512(p, _mm512_loadu_si512(dst + i));
+    _mm512_storeu_si512(dst + i, p);
+  }
+  gf_mul_region_tables(lo, hi, src + i, dst + i, len - i, add);
+}
+
+#elif defined(__aarch64__)
+
+void gf_xor_region_neon(const uint8_t *src, uint8_t *dst, size_t len)
+{
+  size_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    for (int j = 0; j < 64; j += 16) {
+      vst1q_u8(dst + i + j,
+	       veorq_u8(vld1q_u8(src + i + j), vld1q_u8(dst + i + j)));
+    }
+  }
+  gf_xor_region_baseline(src + i, dst + i, len - i);
+}
+
+void gf_mul_region_neon(uint8_t c, const uint8_t *src, uint8_t *dst,
+			size_t len, int add)
+{
+  if (gf_mul_region_trivial(c, src, dst, len, add, gf_xor_region_neon))
+    return;
+  uint8_t lo[16], hi[16];
+  gf_split_tables(c, lo, hi);
+  const uint8x16_t tlo = vld1q_u8(lo);
+  const uint8x16_t thi = vld1q_u8(hi);
+  const uint8x16_t mask = vdupq_n_u8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    uint8x16_t x = vld1q_u8(src + i);
+    uint8x16_t p = veorq_u8(vqtbl1q_u8(tlo, vandq_u8(x, mask)),
+			    vqtbl1q_u8(thi, vshrq_n_u8(x, 4)));
+    if (add)
+      p = veorq_u8(p, vld1q_u8(dst + i));
+    vst1q_u8(dst + i, p);
+  }
+  gf_mul_region_tables(lo, hi, src + i, dst + i, len - i, add);
+}
+
+#endif
+
+const ceph_gf_kernel gf_kernel_baseline = {
+  "baseline", gf_xor_region_baseline, gf_mul_region_baseline
+};
+#if defined(__x86_64__)
+const ceph_gf_kernel gf_kernel_ssse3 = {
+  "ssse3", gf_xor_region_sse2, gf_mul_region_ssse3
+};
+const ceph_gf_kernel gf_kernel_avx2 = {
+  "avx2", gf_xor_region_avx2, gf_mul_region_avx2
+};
+const ceph_gf_kernel gf_kernel_avx512 = {
+  "avx512bw", gf_xor_region_avx512, gf_mul_region_avx512
+};
+#elif defined(__aarch64__)
+const ceph_gf_kernel gf_kernel_neon = {
+  "neon", gf_xor_region_neon, gf_mul_region_neon
+};
+#endif
+
+} // anonymous namespace
+
+const struct ceph_gf_kernel * const *ceph_gf_kernels(void)
+{
+  static const auto kernels = [] {
+    std::array<const ceph_gf_kernel*, 5> k = {};
+    size_t n = 0;
+    ceph_arch_probe();
+    k[n++] = &gf_kernel_baseline;
+#if defined(__x86_64__)
+    if (ceph_arch_intel_ssse3)
+      k[n++] = &gf_kernel_ssse3;
+    if (ceph_arch_intel_avx2)
+      k[n++] = &gf_kernel_avx2;
+    if (ceph_arch_intel_avx512bw)
+      k[n++] = &gf_kernel_avx512;
+#elif defined(__aarch64__)
+    if (ceph_arch_neon)
+      k[n++] = &gf_kernel_neon;
+#endif
+    return k;
+  }();
+  return kernels.data();
+}
+
+/*
+ * choose best implementation based on the CPU architecture.
+ */
+const struct ceph_gf_kernel *ceph_choose_gf_kernel(void)
+{
+  const ceph_gf_kernel * const *k = ceph_gf_kernels();
+  while (k[1])
+    ++k;
+  return *k;
+}
+
+void ceph_gf_kernel_dot_prod(const struct ceph_gf_kernel *impl,
+			     const uint8_t *coeffs, int n,
+			     const uint8_t * const *src, uint8_t *dst,
+			     size_t len)
+{
+  // small enough that dst and a source block sit in L1 together
+  static constexpr size_t block = 8192;
+  for (size_t off = 0; off < len; off += block) {
+    size_t l = std::min(block, len - off);
+    if (n == 0)
+      memset(dst + off, 0, l);
+    for (int i = 0; i < n; ++i) {
+      impl->mul_region(coeffs[i], src[i] + off, dst + off, l, i > 0);
+    }
+  }
+}
+
+/*
+ * static global, see crc32c.cc
+ */
+const struct ceph_gf_kernel *ceph_gf_kernel_impl = ceph_choose_gf_kernel();
@@ -0,0 +1,89 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#ifndef CEPH_ERASURE_CODE_GF_KERNELS_H
+#define CEPH_ERASURE_CODE_GF_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * GF(2^8) region kernels shared by the erasure code plugins.
+ *
+ * The field is the one jerasure (w=8) and isa-l use, generated by
+ * x^8 + x^4 + x^3 + x^2 + 1 (0x11d), so a region multiplied here is
+ * bit for bit what galois_w08_region_multiply() or ec_encode_data()
+ * would produce.  Multiplication by a constant is done with the usual
+ * split table trick: c * x = lo[x & 0xf] ^ hi[x >> 4], where both
+ * 16 entry tables fit a single byte shuffle register.
+ *
+ * There's a scalar baseline and ssse3 / avx2 / avx512bw / neon kernels,
+ * the best one the CPU supports is chosen at load time.  None of them
+ * need any particular alignment or length; the vector kernels finish
+ * the tail with the scalar loop.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* dst ^= src */
+typedef void (*ceph_gf_xor_region_func_t)(const uint8_t *src, uint8_t *dst,
+					  size_t len);
+/* dst = c * src, or dst ^= c * src if add */
+typedef void (*ceph_gf_mul_region_func_t)(uint8_t c, const uint8_t *src,
+					  uint8_t *dst, size_t len, int add);
+
+struct ceph_gf_kernel {
+  const char *name;
+  ceph_gf_xor_region_func_t xor_region;
+  ceph_gf_mul_region_func_t mul_region;
+};
+
+/* the implementation chosen for this CPU */
+extern const struct ceph_gf_kernel *ceph_gf_kernel_impl;
+
+extern const struct ceph_gf_kernel *ceph_choose_gf_kernel(void);
+
+/* every kernel this CPU can run, baseline first, NULL terminated; for
+ * tests and benchmarks */
+extern const struct ceph_gf_kernel * const *ceph_gf_kernels(void);
+
+/* scalar multiply in the field */
+extern uint8_t ceph_gf_mul(uint8_t a, uint8_t b);
+
+static inline void ceph_gf_xor_region(const uint8_t *src, uint8_t *dst,
+				      size_t len)
+{
+  ceph_gf_kernel_impl->xor_region(src, dst, len);
+}
+
+static inline void ceph_gf_mul_region(uint8_t c, const uint8_t *src,
+				      uint8_t *dst, size_t len, int add)
+{
+  ceph_gf_kernel_impl->mul_region(c, src, dst, len, add);
+}
+
+/*
+ * dst = sum of coeffs[i] * src[i] for i < n, i.e. one row of a
+ * systematic encoding matrix applied to the data chunks.  Works
+ * through the region a block at a time so dst stays in cache while
+ * the sources stream past it.
+ */
+extern void ceph_gf_kernel_dot_prod(const struct ceph_gf_kernel *kernel,
+				    const uint8_t *coeffs, int n,
+				    const uint8_t * const *src, uint8_t *dst,
+				    size_t len);
+
+static inline void ceph_gf_dot_prod(const uint8_t *coeffs, int n,
+				    const uint8_t * const *src, uint8_t *dst,
+				    size_t len)
+{
+  ceph_gf_kernel_dot_prod(ceph_gf_kernel_impl, coeffs, n, src, dst, len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -132,6 +132,48 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+int
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferlist> &deltas,
+                                   map<int, bufferlist> *parity)
+{
+  if (deltas.empty())
+    return 0;
+  unsigned blocksize = deltas.begin()->second.length();
+  if ((int) parity->size() != m)
+    return -EINVAL;
+  for (auto &[i, p] : *parity) {
+    if (i < k || i >= k + m || p.length() != blocksize)
+      return -EINVAL;
+  }
+  for (auto &[j, d] : deltas) {
+    if (j < 0 || j >= k || d.length() != blocksize)
+      return -EINVAL;
+  }
+
+  if (m == 1) {
+    // single parity stripe, see isa_encode
+    unsigned char *src[k + 1];
+    int n = 0;
+    unsigned char *coding = (unsigned char*) parity->begin()->second.c_str();
+    src[n++] = coding;
+    for (auto &[j, d] : deltas)
+      src[n++] = (unsigned char*) const_cast<bufferlist&>(d).c_str();
+    region_xor(src, coding, n, blocksize);
+    return 0;
+  }
+
+  unsigned char *coding[m];
+  for (auto &[i, p] : *parity)
+    coding[i - k] = (unsigned char*) p.c_str();
+  for (auto &[j, d] : deltas)
+    ec_encode_data_update(blocksize, k, m, j, encode_tbls,
+                          (unsigned char*) const_cast<bufferlist&>(d).c_str(),
+                          coding);
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
@@ -14,7 +14,8 @@
 #include "xor_op.h"
 #include <stdio.h>
 #include <string.h>
-#include "arch/intel.h"
+#include <algorithm>
+#include "erasure-code/gf_kernels.h"
 
 #include "include/ceph_assert.h"
 
@@ -69,115 +70,28 @@ region_xor(unsigned char** src,
     return;
   }
 
+  // the first source is the parity itself when it is updated in place
+  // (see ErasureCodeIsaDefault::apply_delta), don't copy it onto itself
+  bool in_place = (src[0] == parity);
+
   if (src_size == 1) {
     // just copy source to parity
-    memcpy(parity, src[0], size);
+    if (!in_place)
+      memcpy(parity, src[0], size);
     return;
   }
 
-  unsigned size_left = size;
-
   // ----------------------------------------------------------
-  // region or vector XOR operations require aligned addresses
+  // the shared gf kernels pick the widest xor the cpu has and
+  // don't care about alignment; go a block at a time so the
+  // parity stays in cache while the sources stream past it
   // ----------------------------------------------------------
-
-  bool src_aligned = true;
-  for (int i = 0; i < src_size; i++) {
-    src_aligned &= is_aligned(src[i], EC_ISA_VECTOR_OP_WORDSIZE);
-  }
-
-  if (src_aligned &&
-      is_aligned(parity, EC_ISA_VECTOR_OP_WORDSIZE)) {
-
-#ifdef __x86_64__
-    if (ceph_arch_intel_sse2) {
-      // -----------------------------
-      // use SSE2 region xor function
-      // -----------------------------
-      unsigned region_size =
-        (size / EC_ISA_VECTOR_SSE2_WORDSIZE) * EC_ISA_VECTOR_SSE2_WORDSIZE;
-
-      size_left -= region_size;
-      // 64-byte region xor
-      region_sse2_xor((char**) src, (char*) parity, src_size, region_size);
-    } else
-#endif
-    {
-      // --------------------------------------------
-      // use region xor based on vector xor operation
-      // --------------------------------------------
-      unsigned vector_words = size / EC_ISA_VECTOR_OP_WORDSIZE;
-      unsigned vector_size = vector_words * EC_ISA_VECTOR_OP_WORDSIZE;
-      memcpy(parity, src[0], vector_size);
-
-      size_left -= vector_size;
-      vector_op_t* p_vec = (vector_op_t*) parity;
-      for (int i = 1; i < src_size; i++) {
-        vector_op_t* s_vec = (vector_op_t*) src[i];
-        vector_op_t* e_vec = s_vec + vector_words;
-        vector_xor(s_vec, p_vec, e_vec);
-      }
-    }
-  }
-
-  if (size_left) {
-    // --------------------------------------------------
-    // xor the not aligned part with byte-wise region xor
-    // --------------------------------------------------
-    memcpy(parity + size - size_left, src[0] + size - size_left, size_left);
+  for (unsigned off = 0; off < size; off += EC_ISA_XOR_BLOCKSIZE) {
+    unsigned len = std::min(size - off, EC_ISA_XOR_BLOCKSIZE);
+    if (!in_place)
+      memcpy(parity + off, src[0] + off, len);
     for (int i = 1; i < src_size; i++) {
-      byte_xor(src[i] + size - size_left, parity + size - size_left, src[i] + size);
+      ceph_gf_xor_region(src[i] + off, parity + off, len);
     }
   }
 }
-
-// -----------------------------------------------------------------------------
-
-void
-// -----------------------------------------------------------------------------
-region_sse2_xor(char** src,
-                char* parity,
-                int src_size,
-                unsigned size)
-// -----------------------------------------------------------------------------
-{
-#ifdef __x86_64__
-  ceph_assert(!(size % EC_ISA_VECTOR_SSE2_WORDSIZE));
-  unsigned char* p;
-  int d, l;
-  unsigned i;
-  unsigned char* vbuf[256];
-
-  for (int v = 0; v < src_size; v++) {
-    vbuf[v] = (unsigned char*) src[v];
-  }
-
-  l = src_size;
-  p = (unsigned char*) parity;
-
-  for (i = 0; i < size; i += EC_ISA_VECTOR_SSE2_WORDSIZE) {
-    asm volatile("movdqa %0,%%xmm0" : : "m" (vbuf[0][i]));
-    asm volatile("movdqa %0,%%xmm1" : : "m" (vbuf[0][i + 16]));
-    asm volatile("movdqa %0,%%xmm2" : : "m" (vbuf[0][i + 32]));
-    asm volatile("movdqa %0,%%xmm3" : : "m" (vbuf[0][i + 48]));
-
-    for (d = 1; d < l; d++) {
-      asm volatile("movdqa %0,%%xmm4" : : "m" (vbuf[d][i]));
-      asm volatile("movdqa %0,%%xmm5" : : "m" (vbuf[d][i + 16]));
-      asm volatile("movdqa %0,%%xmm6" : : "m" (vbuf[d][i + 32]));
-      asm volatile("movdqa %0,%%xmm7" : : "m" (vbuf[d][i + 48]));
-      asm volatile("pxor %xmm4,%xmm0");
-      asm volatile("pxor %xmm5,%xmm1");
-      asm volatile("pxor %xmm6,%xmm2");
-      asm volatile("pxor %xmm7,%xmm3");
-    }
-    asm volatile("movntdq %%xmm0,%0" : "=m" (p[i]));
-    asm volatile("movntdq %%xmm1,%0" : "=m" (p[i + 16]));
-    asm volatile("movntdq %%xmm2,%0" : "=m" (p[i + 32]));
-    asm volatile("movntdq %%xmm3,%0" : "=m" (p[i + 48]));
-  }
-
-  asm volatile("sfence" : : : "memory");
-#endif // __x86_64__
-  return;
-}
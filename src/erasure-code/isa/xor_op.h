@@ -26,7 +26,7 @@
 // -------------------------------------------------------------------------
 
 #define EC_ISA_ADDRESS_ALIGNMENT 32u
-#define EC_ISA_VECTOR_SSE2_WORDSIZE 64u
+#define EC_ISA_XOR_BLOCKSIZE 8192u
 
 #if __GNUC__ > 4 || \
   ( (__GNUC__ == 4) && (__GNUC_MINOR__ >= 4) ) ||\
@@ -73,15 +73,5 @@ vector_xor(vector_op_t* cw, vector_op_t* dw, vector_op_t* ew);
 void
 region_xor(unsigned char** src, unsigned char* parity, int src_size, unsigned size);
 
-// -------------------------------------------------------------------------
-// compute region XOR like parity = src[0] ^ src[1] ... ^ src[src_size-]
-// using SSE2 64-byte operations
-// -------------------------------------------------------------------------
-void
-region_sse2_xor(char** src /* array of 64-byte aligned source pointer to xor */,
-                char* parity /* 64-byte aligned output pointer containing the parity */,
-                int src_size /* size of the source pointer array */,
-                unsigned size /* size of the region to xor */);
-
 
 #endif // EC_ISA_XOR_OP_H
@@ -17,6 +17,7 @@
 
 #include "common/debug.h"
 #include "ErasureCodeJerasure.h"
+#include "erasure-code/gf_kernels.h"
 
 
 extern "C" {
@@ -137,6 +138,64 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+int ErasureCodeJerasure::apply_matrix_delta(const int *matrix,
+					    const map<int, bufferlist> &deltas,
+					    map<int, bufferlist> *parity)
+{
+  // parity_i = sum_j matrix[i][j] * data_j, so the change to parity_i
+  // is matrix[i][j] * delta_j for every modified data chunk j
+  if (deltas.empty())
+    return 0;
+  unsigned blocksize = deltas.begin()->second.length();
+  for (auto &[i, p] : *parity) {
+    if (i < k || i >= k + m || p.length() != blocksize)
+      return -EINVAL;
+    char *coding = p.c_str();
+    for (auto &[j, d] : deltas) {
+      if (j < 0 || j >= k || d.length() != blocksize)
+	return -EINVAL;
+      char *delta = const_cast<bufferlist&>(d).c_str();
+      int multby = matrix[(i - k) * k + j];
+      if (multby == 1) {
+	ceph_gf_xor_region((const uint8_t*)delta, (uint8_t*)coding, blocksize);
+	continue;
+      }
+      switch (w) {
+      case 8:
+	ceph_gf_mul_region(multby, (const uint8_t*)delta, (uint8_t*)coding,
+			   blocksize, 1);
+	break;
+      case 16:
+	galois_w16_region_multiply(delta, multby, blocksize, coding, 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(delta, multby, blocksize, coding, 1);
+	break;
+      default:
+	return -EINVAL;
+      }
+    }
+  }
+  return 0;
+}
+
+void ErasureCodeJerasure::matrix_encode_w8(const int *matrix,
+					   char **data,
+					   char **coding,
+					   int blocksize)
+{
+  // same field as gf-complete's default for w=8, so the parity is
+  // identical to what jerasure_matrix_encode() would compute
+  ceph_assert(w == 8);
+  std::vector<uint8_t> coeffs(k);
+  for (int i = 0; i < m; i++) {
+    for (int j = 0; j < k; j++)
+      coeffs[j] = matrix[i * k + j];
+    ceph_gf_dot_prod(coeffs.data(), k, (const uint8_t * const *)data,
+		     (uint8_t*)coding[i], blocksize);
+  }
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
@@ -159,7 +218,10 @@ void ErasureCodeJerasureReedSolomonVandermonde::jerasure_encode(char **data,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  jerasure_matrix_encode(k, m, w, matrix, data, coding, blocksize);
+  if (w == 8)
+    matrix_encode_w8(matrix, data, coding, blocksize);
+  else
+    jerasure_matrix_encode(k, m, w, matrix, data, coding, blocksize);
 }
 
 int ErasureCodeJerasureReedSolomonVandermonde::jerasure_decode(int *erasures,
@@ -210,7 +272,10 @@ void ErasureCodeJerasureReedSolomonRAID6::jerasure_encode(char **data,
                                                                 char **coding,
                                                                 int blocksize)
 {
-  reed_sol_r6_encode(k, w, data, coding, blocksize);
+  if (w == 8)
+    matrix_encode_w8(matrix, data, coding, blocksize);
+  else
+    reed_sol_r6_encode(k, w, data, coding, blocksize);
 }
 
 int ErasureCodeJerasureReedSolomonRAID6::jerasure_decode(int *erasures,
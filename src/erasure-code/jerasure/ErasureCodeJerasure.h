@@ -77,6 +77,14 @@ public:
   static bool is_prime(int value);
 protected:
   virtual int parse(ceph::ErasureCodeProfile &profile, std::ostream *ss);
+  int apply_matrix_delta(const int *matrix,
+			 const std::map<int, ceph::buffer::list> &deltas,
+			 std::map<int, ceph::buffer::list> *parity);
+  /// jerasure_matrix_encode() for w=8, with the simd gf_kernels
+  void matrix_encode_w8(const int *matrix,
+			char **data,
+			char **coding,
+			int blocksize);
 };
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
 public:
@@ -104,6 +112,13 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  bool supports_parity_delta() const override {
+    return chunk_mapping.empty();
+  }
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+		  std::map<int, ceph::buffer::list> *parity) override {
+    return apply_matrix_delta(matrix, deltas, parity);
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -134,6 +149,13 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+  bool supports_parity_delta() const override {
+    return chunk_mapping.empty();
+  }
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+		  std::map<int, ceph::buffer::list> *parity) override {
+    return apply_matrix_delta(matrix, deltas, parity);
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -542,6 +542,10 @@ int ErasureCodeLrc::init(ErasureCodeProfile &profile,
     profile.erase("layers");
   }
   ErasureCode::init(profile, ss);
+
+  uint64_t plans = g_conf().get_val<uint64_t>("erasure_code_plan_cache_size");
+  minimum_plans.set_max(plans);
+  decode_plans.set_max(plans);
   return 0;
 }
 
@@ -565,6 +569,24 @@ void p(const set<int> &s) { cerr << s; } // for gdb
 int ErasureCodeLrc::_minimum_to_decode(const set<int> &want_to_read,
 				       const set<int> &available_chunks,
 				       set<int> *minimum)
+{
+  string signature;
+  plan_signature_append(&signature, 'w', want_to_read);
+  plan_signature_append(&signature, 'a', available_chunks);
+  auto plan = minimum_plans.get_or_create(signature, [&] {
+    MinimumPlan plan;
+    plan.r = make_minimum_to_decode(want_to_read, available_chunks,
+				    &plan.minimum);
+    return plan;
+  });
+  if (plan->r == 0)
+    *minimum = plan->minimum;
+  return plan->r;
+}
+
+int ErasureCodeLrc::make_minimum_to_decode(const set<int> &want_to_read,
+					   const set<int> &available_chunks,
+					   set<int> *minimum)
 {
   dout(20) << __func__ << " want_to_read " << want_to_read
 	   << " available_chunks " << available_chunks << dendl;
@@ -773,87 +795,114 @@ int ErasureCodeLrc::encode_chunks(const set<int> &want_to_encode,
   return 0;
 }
 
-int ErasureCodeLrc::decode_chunks(const set<int> &want_to_read,
-				  const map<int, bufferlist> &chunks,
-				  map<int, bufferlist> *decoded)
+ErasureCodeLrc::DecodePlan
+ErasureCodeLrc::make_decode_plan(const set<int> &want_to_read,
+				 set<int> erasures) const
 {
-  set<int> available_chunks;
-  set<int> erasures;
-  for (unsigned int i = 0; i < get_chunk_count(); ++i) {
-    if (chunks.count(i) != 0)
-      available_chunks.insert(i);
-    else
-      erasures.insert(i);
-  }
-
-  set<int> want_to_read_erasures;
-
-  for (vector<Layer>::reverse_iterator layer = layers.rbegin();
-       layer != layers.rend();
-       ++layer) {
+  DecodePlan plan;
+  for (unsigned int l = layers.size(); l-- > 0; ) {
+    const Layer &layer = layers[l];
     set<int> layer_erasures;
-    set_intersection(layer->chunks_as_set.begin(), layer->chunks_as_set.end(),
+    set_intersection(layer.chunks_as_set.begin(), layer.chunks_as_set.end(),
 		     erasures.begin(), erasures.end(),
 		     inserter(layer_erasures, layer_erasures.end()));
 
     if (layer_erasures.size() >
-	layer->erasure_code->get_coding_chunk_count()) {
+	layer.erasure_code->get_coding_chunk_count()) {
       // skip because there are too many erasures for this layer to recover
     } else if(layer_erasures.size() == 0) {
       // skip because all chunks are already available
     } else {
-      set<int> layer_want_to_read;
-      map<int, bufferlist> layer_chunks;
-      map<int, bufferlist> layer_decoded;
+      DecodeStep step;
+      step.layer = l;
       int j = 0;
-      for (vector<int>::const_iterator c = layer->chunks.begin();
-	   c != layer->chunks.end();
-	   ++c) {
-	//
-	// Pick chunks from *decoded* instead of *chunks* to re-use
-	// chunks recovered by previous layers. In other words
-	// *chunks* does not change but *decoded* gradually improves
-	// as more layers recover from erasures.
-	//
-	if (erasures.count(*c) == 0)
-	  layer_chunks[j] = (*decoded)[*c];
-	if (want_to_read.count(*c) != 0)
-	  layer_want_to_read.insert(j);
-	layer_decoded[j] = (*decoded)[*c];
+      for (auto c : layer.chunks) {
+	if (erasures.count(c) == 0)
+	  step.available.insert(j);
+	if (want_to_read.count(c) != 0)
+	  step.want_to_read.insert(j);
 	++j;
       }
-      int err = layer->erasure_code->decode_chunks(layer_want_to_read,
-						   layer_chunks,
-						   &layer_decoded);
-      if (err) {
-	derr << __func__ << " layer " << layer->chunks_map
-	     << " failed with " << err << " trying to decode "
-	     << layer_want_to_read << " with " << available_chunks << dendl;
-	return err;
-      }
-      j = 0;
-      for (vector<int>::const_iterator c = layer->chunks.begin();
-	   c != layer->chunks.end();
-	   ++c) {
-	(*decoded)[*c] = layer_decoded[j];
-	++j;
-	erasures.erase(*c);
-      }
-      want_to_read_erasures.clear();
+      plan.steps.push_back(std::move(step));
+      for (auto c : layer.chunks)
+	erasures.erase(c);
+      plan.unrecovered.clear();
       set_intersection(erasures.begin(), erasures.end(),
 		       want_to_read.begin(), want_to_read.end(),
-		       inserter(want_to_read_erasures, want_to_read_erasures.end()));
-      if (want_to_read_erasures.size() == 0)
+		       inserter(plan.unrecovered, plan.unrecovered.end()));
+      if (plan.unrecovered.size() == 0)
 	break;
     }
   }
+  return plan;
+}
 
-  if (want_to_read_erasures.size() > 0) {
+int ErasureCodeLrc::decode_chunks(const set<int> &want_to_read,
+				  const map<int, bufferlist> &chunks,
+				  map<int, bufferlist> *decoded)
+{
+  set<int> available_chunks;
+  set<int> erasures;
+  for (unsigned int i = 0; i < get_chunk_count(); ++i) {
+    if (chunks.count(i) != 0)
+      available_chunks.insert(i);
+    else
+      erasures.insert(i);
+  }
+
+  string signature;
+  plan_signature_append(&signature, 'w', want_to_read);
+  plan_signature_append(&signature, 'e', erasures);
+  auto plan = decode_plans.get_or_create(signature, [&] {
+    return make_decode_plan(want_to_read, erasures);
+  });
+
+  for (const auto &step : plan->steps) {
+    const Layer &layer = layers[step.layer];
+    map<int, bufferlist> layer_chunks;
+    map<int, bufferlist> layer_decoded;
+    int j = 0;
+    for (auto c : layer.chunks) {
+      //
+      // Pick chunks from *decoded* instead of *chunks* to re-use
+      // chunks recovered by previous layers. In other words
+      // *chunks* does not change but *decoded* gradually improves
+      // as more layers recover from erasures.
+      //
+      if (step.available.count(j) != 0)
+	layer_chunks[j] = (*decoded)[c];
+      layer_decoded[j] = (*decoded)[c];
+      ++j;
+    }
+    int err = layer.erasure_code->decode_chunks(step.want_to_read,
+						layer_chunks,
+						&layer_decoded);
+    if (err) {
+      derr << __func__ << " layer " << layer.chunks_map
+	   << " failed with " << err << " trying to decode "
+	   << step.want_to_read << " with " << available_chunks << dendl;
+      return err;
+    }
+    j = 0;
+    for (auto c : layer.chunks) {
+      (*decoded)[c] = layer_decoded[j];
+      ++j;
+    }
+  }
+
+  if (plan->unrecovered.size() > 0) {
     derr << __func__ << " want to read " << want_to_read
 	 << " with available_chunks = " << available_chunks
-	 << " end up being unable to read " << want_to_read_erasures << dendl;
+	 << " end up being unable to read " << plan->unrecovered << dendl;
     return -EIO;
   } else {
     return 0;
   }
 }
+
+ErasureCodePlanCacheStats ErasureCodeLrc::get_decode_plan_cache_stats() const
+{
+  ErasureCodePlanCacheStats stats = minimum_plans.get_stats();
+  stats += decode_plans.get_stats();
+  return stats;
+}
@@ -75,6 +75,25 @@ public:
   };
   std::vector<Step> rule_steps;
 
+  // what _minimum_to_decode found for a given want / available pair
+  struct MinimumPlan {
+    int r = 0;
+    std::set<int> minimum;
+  };
+  // one layer decode_chunks runs, chunks are numbered within the layer
+  struct DecodeStep {
+    unsigned int layer = 0;
+    std::set<int> want_to_read;
+    std::set<int> available;
+  };
+  struct DecodePlan {
+    std::vector<DecodeStep> steps;
+    // wanted chunks none of the layers can recover
+    std::set<int> unrecovered;
+  };
+  ceph::ErasureCodePlanCache<MinimumPlan> minimum_plans;
+  ceph::ErasureCodePlanCache<DecodePlan> decode_plans;
+
   explicit ErasureCodeLrc(const std::string &dir)
     : directory(dir),
       chunk_count(0), data_chunk_count(0), rule_root("default")
@@ -91,6 +110,15 @@ public:
 			 const std::set<int> &available,
 			 std::set<int> *minimum) override;
 
+  int make_minimum_to_decode(const std::set<int> &want_to_read,
+			     const std::set<int> &available,
+			     std::set<int> *minimum);
+
+  DecodePlan make_decode_plan(const std::set<int> &want_to_read,
+			      std::set<int> erasures) const;
+
+  ceph::ErasureCodePlanCacheStats get_decode_plan_cache_stats() const override;
+
   int create_rule(const std::string &name,
 			     CrushWrapper &crush,
 			     std::ostream *ss) const override;
@@ -127,7 +127,7 @@ DEFINE_CEPH_FEATURE(28, 2, SERVER_MIMIC)
 DEFINE_CEPH_FEATURE(29, 1, MDSENC)           // 4.7
 DEFINE_CEPH_FEATURE(30, 1, OSDHASHPSPOOL)    // 3.9
 DEFINE_CEPH_FEATURE_RETIRED(31, 1, MON_SINGLE_PAXOS, NAUTILUS, PACIFIC)
-// available for R
+DEFINE_CEPH_FEATURE(31, 3, OSD_DIVERGENT_REGIONS) // SERVER_R to overlap
 DEFINE_CEPH_FEATURE_RETIRED(32, 1, OSD_SNAPMAPPER, JEWEL, LUMINOUS)
 DEFINE_CEPH_FEATURE(32, 3, STRETCH_MODE)
 DEFINE_CEPH_FEATURE_RETIRED(33, 1, MON_SCRUB, JEWEL, LUMINOUS)
@@ -250,6 +250,7 @@ DEFINE_CEPH_FEATURE_DEPRECATED(63, 1, RESERVED_BROKEN, LUMINOUS) // client-facin
 	 CEPH_FEATURE_OSD_FIXED_COLLECTION_LIST | \
 	 CEPH_FEATUREMASK_SERVER_QUINCY | \
 	 CEPH_FEATURE_RANGE_BLOCKLIST | \
+	 CEPH_FEATUREMASK_OSD_DIVERGENT_REGIONS | \
 	 0ULL)
 
 #define CEPH_FEATURES_SUPPORTED_DEFAULT  CEPH_FEATURES_ALL
@@ -114,6 +114,9 @@
 /* SPDK conditional compilation */
 #cmakedefine HAVE_SPDK
 
+/* emulated NVMe device (OSD) conditional compilation */
+#cmakedefine HAVE_NVME_EMU
+
 /* DPDK conditional compilation */
 #cmakedefine HAVE_DPDK
 
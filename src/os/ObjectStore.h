@@ -50,6 +50,10 @@ namespace ceph {
 class Logger;
 class ContextQueue;
 
+namespace PriorityCache {
+  struct PriCache;
+}
+
 static inline void encode(const std::map<std::string,ceph::buffer::ptr> *attrset, ceph::buffer::list &bl) {
   using ceph::encode;
   encode(*attrset, bl);
@@ -274,6 +278,17 @@ public:
 
   virtual void set_cache_shards(unsigned num) { }
 
+  /**
+   * Let a cache owned by the caller share the store's memory budget.
+   *
+   * Stores that autotune their caches against osd_memory_target hand c
+   * a slice of it along with their own; others ignore it and c keeps
+   * to its configured size.
+   */
+  virtual void add_priority_cache(
+    const std::string& name,
+    std::shared_ptr<PriorityCache::PriCache> c) { }
+
   /**
    * Returns 0 if the hobject is valid, -error otherwise
    *
@@ -130,6 +130,8 @@ const string PREFIX_DEFERRED = "L";    // id -> deferred_transaction_t
 const string PREFIX_ALLOC = "B";       // u64 offset -> u64 length (freelist)
 const string PREFIX_ALLOC_BITMAP = "b";// (see BitmapFreelistManager)
 const string PREFIX_SHARED_BLOB = "X"; // u64 SB id -> shared_blob_t
+const string PREFIX_COMPRESSION_DICT = "D"; // u32 id -> bluestore_compression_dict_t
+const string PREFIX_COMPRESSION_DICT_REF = "d"; // u32 id -> int64 blob refs
 
 #ifdef HAVE_LIBZBD
 const string PREFIX_ZONED_FM_META = "Z";  // (see ZonedFreelistManager)
@@ -684,8 +686,10 @@ ostream& operator<<(ostream& out, const BlueStore::Buffer& b)
   out << "buffer(" << &b << " space " << b.space << " 0x" << std::hex
       << b.offset << "~" << b.length << std::dec
       << " " << BlueStore::Buffer::get_state_name(b.state);
-  if (b.flags)
-    out << " " << BlueStore::Buffer::get_flag_name(b.flags);
+  for (unsigned f = 1; f <= b.flags; f <<= 1) {
+    if (b.flags & f)
+      out << " " << BlueStore::Buffer::get_flag_name(f);
+  }
   return out << ")";
 }
 
@@ -1782,6 +1786,9 @@ void BlueStore::BufferSpace::read(
       bool val = false;
       if (flags & BYPASS_CLEAN_CACHE)
         val = b->is_writing();
+      else if ((flags & BYPASS_UNVERIFIED) &&
+	       (b->flags & Buffer::FLAG_UNVERIFIED))
+        val = b->is_writing();
       else
         val = b->is_writing() || b->is_clean();
       if (val) {
@@ -2555,6 +2562,9 @@ void BlueStore::ExtentMap::dup(BlueStore* b, TransContext* txc,
       if (blob_duped) {
         txc->statfs_delta.compressed() +=
           cb->get_blob().get_compressed_payload_length();
+        if (cb->get_blob().has_compression_dict()) {
+          b->_get_compression_dict_ref(txc, cb->get_blob().compression_dict);
+        }
       }
     }
     dout(20) << __func__ << "  dst " << *ne << dendl;
@@ -4215,6 +4225,15 @@ void *BlueStore::MempoolThread::entry()
 
   bool interval_stats_trim = false;
   while (!stop) {
+    // Caches registered via add_priority_cache (after mount) join the
+    // autotuner on the next pass
+    if (pcm != nullptr && !pending_caches.empty()) {
+      for (auto& [name, c] : pending_caches) {
+        dout(10) << __func__ << " adding " << name << " to pricache" << dendl;
+        pcm->insert(name, c, false);
+      }
+      pending_caches.clear();
+    }
     // Update pcm cache settings if related configuration was changed
     uint32_t cur_config_change = store->config_changed.load();
     if (cur_config_change != prev_config_change) {
@@ -4594,6 +4613,7 @@ BlueStore::BlueStore(CephContext *cct,
   : ObjectStore(cct, path),
     throttle(cct),
     finisher(cct, "commit_finisher", "cfin"),
+    compression_dict_finisher(cct, "compression_dict_finisher", "bstore_cdict"),
     kv_sync_thread(this),
     kv_finalize_thread(this),
 #ifdef HAVE_LIBZBD
@@ -4640,6 +4660,11 @@ const char **BlueStore::get_tracked_conf_keys() const
     "bluestore_compression_max_blob_size_ssd",
     "bluestore_compression_max_blob_size_hdd",
     "bluestore_compression_required_ratio",
+    "bluestore_compression_frame_size",
+    "bluestore_compression_dict_train_bytes",
+    "bluestore_compression_dict_max_sample_size",
+    "bluestore_compression_dict_size",
+    "bluestore_compression_dict_retrain_bytes",
     "bluestore_max_alloc_size",
     "bluestore_prefer_deferred_size",
     "bluestore_prefer_deferred_size_hdd",
@@ -4693,7 +4718,12 @@ void BlueStore::handle_conf_change(const ConfigProxy& conf,
   if (changed.count("bluestore_compression_mode") ||
       changed.count("bluestore_compression_algorithm") ||
       changed.count("bluestore_compression_min_blob_size") ||
-      changed.count("bluestore_compression_max_blob_size")) {
+      changed.count("bluestore_compression_max_blob_size") ||
+      changed.count("bluestore_compression_frame_size") ||
+      changed.count("bluestore_compression_dict_train_bytes") ||
+      changed.count("bluestore_compression_dict_max_sample_size") ||
+      changed.count("bluestore_compression_dict_size") ||
+      changed.count("bluestore_compression_dict_retrain_bytes")) {
     if (bdev) {
       _set_compression();
     }
@@ -4784,6 +4814,17 @@ void BlueStore::_set_compression()
     }
   }
 
+  comp_frame_size =
+    cct->_conf.get_val<Option::size_t>("bluestore_compression_frame_size");
+  comp_dict_train_bytes =
+    cct->_conf.get_val<Option::size_t>("bluestore_compression_dict_train_bytes");
+  comp_dict_max_sample_size =
+    cct->_conf.get_val<Option::size_t>("bluestore_compression_dict_max_sample_size");
+  comp_dict_size =
+    cct->_conf.get_val<Option::size_t>("bluestore_compression_dict_size");
+  comp_dict_retrain_bytes =
+    cct->_conf.get_val<Option::size_t>("bluestore_compression_dict_retrain_bytes");
+
   auto& alg_name = cct->_conf->bluestore_compression_algorithm;
   if (!alg_name.empty()) {
     compressor = Compressor::create(cct, alg_name);
@@ -4798,6 +4839,8 @@ void BlueStore::_set_compression()
 	   << " alg " << (compressor ? compressor->get_type_name() : "(none)")
 	   << " min_blob " << comp_min_blob_size
 	   << " max_blob " << comp_max_blob_size
+	   << " frame " << comp_frame_size
+	   << " dict_train " << comp_dict_train_bytes
 	   << dendl;
 }
 
@@ -5065,6 +5108,14 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_csum_lat, "csum_lat",
 		 "Average checksum latency",
 		 "csml", PerfCountersBuilder::PRIO_USEFUL);
+  b.add_u64_counter(l_bluestore_csum_verified_bytes, "csum_verified_bytes",
+		    "Sum for bytes read from disk and checked against csum",
+		    NULL, PerfCountersBuilder::PRIO_DEBUGONLY,
+		    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_csum_skipped_bytes, "csum_skipped_bytes",
+		    "Sum for csum protected bytes served from verified cache",
+		    NULL, PerfCountersBuilder::PRIO_DEBUGONLY,
+		    unit_t(UNIT_BYTES));
   b.add_u64_counter(l_bluestore_read_eio, "read_eio",
                     "Read EIO errors propagated to high level callers");
   b.add_u64_counter(l_bluestore_reads_with_retries, "reads_with_retries",
@@ -5181,10 +5232,19 @@ void BlueStore::_init_logger()
   b.add_time_avg(l_bluestore_decompress_lat, "decompress_lat",
 	    "Average decompress latency",
 	    "dcpl", PerfCountersBuilder::PRIO_USEFUL);
+  b.add_u64_counter(l_bluestore_decompress_skipped_frames,
+	    "decompress_skipped_frames",
+	    "Sum for compressed frames not decompressed by partial reads");
   b.add_u64_counter(l_bluestore_compress_success_count, "compress_success_count",
 	    "Sum for beneficial compress ops");
   b.add_u64_counter(l_bluestore_compress_rejected_count, "compress_rejected_count",
 	    "Sum for compress ops rejected due to low net gain of space");
+  b.add_u64_counter(l_bluestore_compress_dict_count, "compress_dict_count",
+	    "Sum for blobs compressed with a trained dictionary");
+  b.add_u64_counter(l_bluestore_compress_dict_trained, "compress_dict_trained",
+	    "Sum for compression dictionaries trained");
+  b.add_u64_counter(l_bluestore_compress_dict_pruned, "compress_dict_pruned",
+	    "Sum for compression dictionaries removed once no blob used them");
   //****************************************
 
   // onode cache stats
@@ -6440,6 +6500,7 @@ out_fm:
 
 void BlueStore::_close_db_and_around()
 {
+  _close_compression_dicts();
   if (db) {
     _close_db();
   }
@@ -6621,6 +6682,7 @@ int BlueStore::_prepare_db_environment(bool create, bool read_only,
 
   FreelistManager::setup_merge_operators(db, freelist_type);
   db->set_merge_operator(PREFIX_STAT, merge_op);
+  db->set_merge_operator(PREFIX_COMPRESSION_DICT_REF, merge_op);
   db->set_cache_size(cache_kv_ratio * cache_size);
   return 0;
 }
@@ -10814,6 +10876,11 @@ void BlueStore::_read_cache(
              << " need 0x" << b_off << "~" << b_len
              << " cache has 0x" << cache_interval
              << std::dec << dendl;
+    if (bptr->get_blob().has_csum() && !cache_interval.empty()) {
+      // either written by us (the csum was computed from it) or read back
+      // and verified; no need to check it again.
+      logger->inc(l_bluestore_csum_skipped_bytes, cache_interval.size());
+    }
 
     auto pc = cache_res.begin();
     uint64_t chunk_size = bptr->get_blob().get_chunk_size(block_size);
@@ -10962,6 +11029,13 @@ int BlueStore::_generate_read_result_bl(
     regions2read_t& r2r = b2r_it->second;
     dout(20) << __func__ << "  blob " << *bptr << " need "
              << r2r << dendl;
+    // with bluestore_ignore_data_csum a mismatch doesn't fail the read;
+    // remember that so the buffer isn't trusted once checking is back on.
+    unsigned cache_flags = 0;
+    if (bptr->get_blob().has_csum() &&
+        cct->_conf->bluestore_ignore_data_csum) {
+      cache_flags = Buffer::FLAG_UNVERIFIED;
+    }
     if (bptr->get_blob().is_compressed()) {
       ceph_assert(p != compressed_blob_bls.end());
       bufferlist& compressed_bl = *p++;
@@ -10970,18 +11044,28 @@ int BlueStore::_generate_read_result_bl(
         *csum_error = true;
         return -EIO;
       }
+      uint32_t b_start = std::numeric_limits<uint32_t>::max();
+      uint32_t b_end = 0;
+      for (auto& req : r2r) {
+        for (auto& r : req.regs) {
+          b_start = std::min<uint32_t>(b_start, r.blob_xoffset);
+          b_end = std::max<uint32_t>(b_end, r.blob_xoffset + r.length);
+        }
+      }
       bufferlist raw_bl;
-      auto r = _decompress(compressed_bl, &raw_bl);
+      uint32_t raw_off = 0;
+      auto r = _decompress(compressed_bl, b_start, b_end - b_start, &raw_bl,
+                           &raw_off);
       if (r < 0)
         return r;
       if (buffered) {
-        bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(), 0,
-                                       raw_bl);
+        bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(),
+                                       raw_off, raw_bl, cache_flags);
       }
       for (auto& req : r2r) {
         for (auto& r : req.regs) {
           ready_regions[r.logical_offset].substr_of(
-            raw_bl, r.blob_xoffset, r.length);
+            raw_bl, r.blob_xoffset - raw_off, r.length);
         }
       }
     } else {
@@ -10993,7 +11077,7 @@ int BlueStore::_generate_read_result_bl(
         }
         if (buffered) {
           bptr->shared_blob->bc.did_read(bptr->shared_blob->get_cache(),
-                                         req.r_off, req.bl);
+                                         req.r_off, req.bl, cache_flags);
         }
 
         // prune and keep result
@@ -11089,6 +11173,9 @@ int BlueStore::_do_read(
     dout(20) << __func__ << " will bypass cache and do direct read" << dendl;
     read_cache_policy = BufferSpace::BYPASS_CLEAN_CACHE;
   }
+  if (!cct->_conf->bluestore_ignore_data_csum) {
+    read_cache_policy |= BufferSpace::BYPASS_UNVERIFIED;
+  }
 
   // build blob-wise list to of stuff read (that isn't cached)
   ready_regions_t ready_regions;
@@ -11170,6 +11257,9 @@ int BlueStore::_verify_csum(OnodeRef& o,
     r = -1;
     bad_csum = 0xDEADBEEF;
   }
+  if (r == 0 && blob->has_csum()) {
+    logger->inc(l_bluestore_csum_verified_bytes, bl.length());
+  }
   if (r < 0) {
     if (r == -1) {
       PExtentVector pex;
@@ -11207,6 +11297,18 @@ int BlueStore::_verify_csum(OnodeRef& o,
 }
 
 int BlueStore::_decompress(bufferlist& source, bufferlist* result)
+{
+  uint32_t result_offset;
+  return _decompress(source, 0, std::numeric_limits<uint32_t>::max(), result,
+		     &result_offset);
+}
+
+int BlueStore::_decompress(
+  bufferlist& source,
+  uint32_t offset,
+  uint32_t length,
+  bufferlist* result,
+  uint32_t* result_offset)
 {
   int r = 0;
   auto start = mono_clock::now();
@@ -11215,7 +11317,11 @@ int BlueStore::_decompress(bufferlist& source, bufferlist* result)
   decode(chdr, i);
   int alg = int(chdr.type);
   CompressorRef cp = compressor;
-  if (!cp || (int)cp->get_type() != alg) {
+  if (chdr.compressor_message && dict_compressor &&
+      (int)dict_compressor->get_type() == alg) {
+    // may have been compressed with a trained dictionary
+    cp = dict_compressor;
+  } else if (!cp || (int)cp->get_type() != alg) {
     cp = Compressor::create(cct, alg);
   }
 
@@ -11227,12 +11333,43 @@ int BlueStore::_decompress(bufferlist& source, bufferlist* result)
     derr << __func__ << " can't load decompressor " << alg_name << dendl;
     _set_compression_alert(false, alg_name);
     r = -EIO;
-  } else {
+  } else if (!chdr.frame_size) {
+    *result_offset = 0;
     r = cp->decompress(i, chdr.length, *result, chdr.compressor_message);
     if (r < 0) {
       derr << __func__ << " decompression failed with exit code " << r << dendl;
       r = -EIO;
     }
+  } else {
+    // only decompress the frames covering offset~length
+    uint64_t first = offset / chdr.frame_size;
+    uint64_t last = (uint64_t(offset) + std::max(length, 1u) - 1) /
+      chdr.frame_size;
+    *result_offset = first * chdr.frame_size;
+    uint64_t f = 0;
+    for (; f < chdr.frame_lengths.size() && f <= last; ++f) {
+      uint32_t flen = chdr.frame_lengths[f];
+      if (f < first) {
+	i += flen;
+	continue;
+      }
+      bufferlist frame;
+      i.copy(flen, frame);
+      r = cp->decompress(frame, *result, chdr.compressor_message);
+      if (r < 0) {
+	derr << __func__ << " decompression of frame " << f
+	     << " failed with exit code " << r << dendl;
+	r = -EIO;
+	break;
+      }
+    }
+    if (r == 0 && f < first) {
+      derr << __func__ << " frame " << first << " beyond last frame " << f
+	   << dendl;
+      r = -EIO;
+    }
+    logger->inc(l_bluestore_decompress_skipped_frames,
+		chdr.frame_lengths.size() - (f - std::min(f, first)));
   }
   log_latency(__func__,
     l_bluestore_decompress_lat,
@@ -11241,6 +11378,362 @@ int BlueStore::_decompress(bufferlist& source, bufferlist* result)
   return r;
 }
 
+int BlueStore::_compress(
+  CompressorRef& cp,
+  const bufferlist& source,
+  bufferlist* result,
+  bluestore_compression_header_t* chdr)
+{
+  uint64_t frame_size = comp_frame_size;
+  if (!frame_size || source.length() <= frame_size) {
+    return cp->compress(source, *result, chdr->compressor_message);
+  }
+  // compress frames independently so that reads can decompress just the
+  // part they need
+  auto compressor_message = chdr->compressor_message;
+  chdr->frame_size = frame_size;
+  chdr->frame_lengths.clear();
+  for (uint64_t off = 0; off < source.length(); off += frame_size) {
+    bufferlist frame, t;
+    frame.substr_of(source, off,
+		    std::min<uint64_t>(frame_size, source.length() - off));
+    chdr->compressor_message = compressor_message;
+    int r = cp->compress(frame, t, chdr->compressor_message);
+    if (r < 0) {
+      return r;
+    }
+    chdr->frame_lengths.push_back(t.length());
+    result->claim_append(t);
+  }
+  return 0;
+}
+
+int BlueStore::_open_compression_dicts()
+{
+  std::lock_guard l(compression_dict_lock);
+  compression_dicts.clear();
+  compression_dict_refs.clear();
+  compression_dict_last = -1;
+  compression_dict_active = false;
+  // Compressor::create() hands out one instance per process, load the
+  // dictionaries of this store into an instance of its own
+  dict_compressor.reset();
+  if (auto zstd = Compressor::create(cct, Compressor::COMP_ALG_ZSTD);
+      zstd && zstd->supports_dictionary()) {
+    dict_compressor = zstd->create_private();
+  }
+
+  KeyValueDB::Iterator it = db->get_iterator(PREFIX_COMPRESSION_DICT,
+					     KeyValueDB::ITERATOR_NOCACHE);
+  for (it->lower_bound(string()); it->valid(); it->next()) {
+    string key = it->key();
+    if (key.size() != sizeof(uint32_t)) {
+      derr << __func__ << " bad dictionary key "
+	   << pretty_binary_string(key) << dendl;
+      return -EIO;
+    }
+    uint32_t id;
+    _key_decode_u32(key.c_str(), &id);
+    bluestore_compression_dict_t d;
+    bufferlist bl = it->value();
+    auto p = bl.cbegin();
+    try {
+      decode(d, p);
+    } catch (ceph::buffer::error& e) {
+      derr << __func__ << " unable to decode dictionary " << id << dendl;
+      return -EIO;
+    }
+    compression_dict_last = std::max<int32_t>(compression_dict_last, id);
+    compression_dict_refs[id].pool = d.pool;
+    if (!dict_compressor || dict_compressor->get_type() != d.type) {
+      const char* alg_name = Compressor::get_comp_alg_name(d.type);
+      derr << __func__ << " can't load dictionary " << id
+	   << " for " << alg_name << dendl;
+      _set_compression_alert(false, alg_name);
+      continue;
+    }
+    int r = dict_compressor->load_dictionary(id, d.data);
+    if (r < 0) {
+      derr << __func__ << " failed to load dictionary " << id
+	   << ": " << cpp_strerror(r) << dendl;
+      return -EIO;
+    }
+    dout(10) << __func__ << " dictionary " << id << " pool " << d.pool
+	     << " len 0x" << std::hex << d.data.length() << std::dec << dendl;
+    auto& st = compression_dicts[d.pool];
+    st.active = std::max<int32_t>(st.active, id);
+    compression_dict_active = true;
+  }
+
+  it = db->get_iterator(PREFIX_COMPRESSION_DICT_REF,
+			KeyValueDB::ITERATOR_NOCACHE);
+  for (it->lower_bound(string()); it->valid(); it->next()) {
+    string key = it->key();
+    if (key.size() != sizeof(uint32_t)) {
+      derr << __func__ << " bad dictionary refs key "
+	   << pretty_binary_string(key) << dendl;
+      return -EIO;
+    }
+    uint32_t id;
+    _key_decode_u32(key.c_str(), &id);
+    int64_t refs;
+    bufferlist bl = it->value();
+    auto p = bl.cbegin();
+    try {
+      decode(refs, p);
+    } catch (ceph::buffer::error& e) {
+      derr << __func__ << " unable to decode refs of dictionary " << id
+	   << dendl;
+      return -EIO;
+    }
+    auto q = compression_dict_refs.find(id);
+    if (q == compression_dict_refs.end()) {
+      derr << __func__ << " refs for missing dictionary " << id << dendl;
+      continue;
+    }
+    dout(10) << __func__ << " dictionary " << id << " refs " << refs << dendl;
+    q->second.refs = refs;
+  }
+  return 0;
+}
+
+void BlueStore::_close_compression_dicts()
+{
+  std::lock_guard l(compression_dict_lock);
+  compression_dicts.clear();
+  compression_dict_refs.clear();
+  compression_dict_last = -1;
+  compression_dict_active = false;
+  // unloads every dictionary
+  dict_compressor.reset();
+}
+
+void BlueStore::_choose_compression_dict(
+  CollectionRef& c,
+  const bufferlist& bl,
+  CompressorRef* cp,
+  std::optional<int32_t>* compressor_message)
+{
+  int64_t pool = c->cid.pool();
+  if (!dict_compressor ||
+      !c->cid.is_pg() ||
+      (*cp)->get_type() != dict_compressor->get_type() ||
+      bl.length() > comp_dict_max_sample_size) {
+    return;
+  }
+  uint64_t train_bytes = comp_dict_train_bytes;
+  uint64_t retrain_bytes = comp_dict_retrain_bytes;
+  if (!train_bytes && !compression_dict_active) {
+    // no dictionary to compress with nor one to train
+    return;
+  }
+
+  std::vector<bufferlist> samples;
+  {
+    std::lock_guard l(compression_dict_lock);
+    auto p = compression_dicts.find(pool);
+    if (p == compression_dicts.end()) {
+      if (!train_bytes) {
+	return;
+      }
+      p = compression_dicts.emplace(pool, compression_dict_state_t()).first;
+    }
+    auto& st = p->second;
+    if (st.active >= 0) {
+      *cp = dict_compressor;
+      *compressor_message = st.active;
+      st.compressed_bytes += bl.length();
+      // pin the dictionary until the caller either drops this ref or
+      // hands it over to the blob
+      ++compression_dict_refs[st.active].refs;
+    }
+    if (train_bytes && !st.training &&
+	(st.active < 0 ||
+	 (retrain_bytes && st.compressed_bytes >= retrain_bytes))) {
+      // take a private copy so that we don't pin the (possibly much
+      // larger) buffers the sample came from
+      bufferptr sample(bl.length());
+      bl.cbegin().copy(bl.length(), sample.c_str());
+      st.samples.emplace_back();
+      st.samples.back().append(std::move(sample));
+      st.sample_bytes += bl.length();
+      if (st.sample_bytes >= train_bytes) {
+	st.training = true;
+	st.sample_bytes = 0;
+	samples.swap(st.samples);
+      }
+    }
+  }
+  if (!samples.empty()) {
+    dout(10) << __func__ << " pool " << pool << " training dictionary from "
+	     << samples.size() << " samples" << dendl;
+    compression_dict_finisher.queue(new LambdaContext(
+      [this, pool, samples = std::move(samples)](int r) mutable {
+	_train_compression_dict(pool, std::move(samples));
+      }));
+  }
+}
+
+void BlueStore::_train_compression_dict(
+  int64_t pool,
+  std::vector<bufferlist> samples)
+{
+  auto start = mono_clock::now();
+  bluestore_compression_dict_t d;
+  d.pool = pool;
+  d.type = dict_compressor->get_type();
+  int r = dict_compressor->train_dictionary(
+    samples,
+    comp_dict_size,
+    &d.data);
+  int32_t id = -1;
+  if (r == 0) {
+    std::lock_guard l(compression_dict_lock);
+    id = ++compression_dict_last;
+  }
+  if (r == 0) {
+    // the dictionary must be durable before any blob refers to it
+    bufferlist bl;
+    encode(d, bl);
+    string key;
+    _key_encode_u32(id, &key);
+    KeyValueDB::Transaction t = db->get_transaction();
+    t->set(PREFIX_COMPRESSION_DICT, key, bl);
+    if (compat_ondisk_format < min_compat_ondisk_format_dict) {
+      // older code can't decode blobs that refer to a dictionary
+      bufferlist cbl;
+      encode(min_compat_ondisk_format_dict, cbl);
+      t->set(PREFIX_SUPER, "min_compat_ondisk_format", cbl);
+    }
+    r = db->submit_transaction_sync(t);
+  }
+  if (r == 0) {
+    compat_ondisk_format =
+      std::max(compat_ondisk_format, min_compat_ondisk_format_dict);
+    r = dict_compressor->load_dictionary(id, d.data);
+  }
+
+  std::lock_guard l(compression_dict_lock);
+  auto& st = compression_dicts[pool];
+  st.training = false;
+  if (r < 0) {
+    derr << __func__ << " pool " << pool << " failed to train dictionary: "
+	 << cpp_strerror(r) << dendl;
+    return;
+  }
+  dout(5) << __func__ << " pool " << pool << " dictionary " << id
+	  << " (previous " << st.active << ") len 0x" << std::hex
+	  << d.data.length() << std::dec << " trained in "
+	  << ceph::to_seconds<double>(mono_clock::now() - start) << "s"
+	  << dendl;
+  compression_dict_refs[id].pool = pool;
+  int32_t previous = st.active;
+  st.active = id;
+  st.compressed_bytes = 0;
+  compression_dict_active = true;
+  if (previous >= 0 && _compression_dict_unused(previous)) {
+    compression_dict_finisher.queue(new LambdaContext(
+      [this, previous](int r) {
+	_prune_compression_dict(previous);
+      }));
+  }
+  logger->inc(l_bluestore_compress_dict_trained);
+}
+
+void BlueStore::_get_compression_dict_ref(TransContext* txc, uint32_t id)
+{
+  {
+    std::lock_guard l(compression_dict_lock);
+    auto p = compression_dict_refs.find(id);
+    ceph_assert(p != compression_dict_refs.end());
+    ++p->second.refs;
+  }
+  ++txc->compression_dict_got[id];
+}
+
+void BlueStore::_put_compression_dict_ref(uint32_t id, int64_t n)
+{
+  std::lock_guard l(compression_dict_lock);
+  auto p = compression_dict_refs.find(id);
+  ceph_assert(p != compression_dict_refs.end());
+  p->second.refs -= n;
+  dout(20) << __func__ << " dictionary " << id << " refs "
+	   << p->second.refs << dendl;
+  if (_compression_dict_unused(id)) {
+    compression_dict_finisher.queue(new LambdaContext(
+      [this, id](int r) {
+	_prune_compression_dict(id);
+      }));
+  }
+}
+
+bool BlueStore::_compression_dict_unused(uint32_t id) const
+{
+  ceph_assert(ceph_mutex_is_locked(compression_dict_lock));
+  auto p = compression_dict_refs.find(id);
+  if (p == compression_dict_refs.end() || p->second.refs > 0) {
+    return false;
+  }
+  auto q = compression_dicts.find(p->second.pool);
+  return q == compression_dicts.end() || q->second.active != (int32_t)id;
+}
+
+void BlueStore::_queue_prune_compression_dicts()
+{
+  std::lock_guard l(compression_dict_lock);
+  for (auto& [id, ref] : compression_dict_refs) {
+    if (_compression_dict_unused(id)) {
+      compression_dict_finisher.queue(new LambdaContext(
+	[this, id=id](int r) {
+	  _prune_compression_dict(id);
+	}));
+    }
+  }
+}
+
+void BlueStore::_prune_compression_dict(uint32_t id)
+{
+  {
+    std::lock_guard l(compression_dict_lock);
+    // refs may have been taken, or the dictionary pruned, meanwhile
+    if (!_compression_dict_unused(id)) {
+      return;
+    }
+    // not active, so no new blob can refer to it again
+    compression_dict_refs.erase(id);
+  }
+  string key;
+  _key_encode_u32(id, &key);
+  KeyValueDB::Transaction t = db->get_transaction();
+  t->rmkey(PREFIX_COMPRESSION_DICT, key);
+  t->rmkey(PREFIX_COMPRESSION_DICT_REF, key);
+  int r = db->submit_transaction_sync(t);
+  ceph_assert(r == 0);
+  if (dict_compressor) {
+    dict_compressor->unload_dictionary(id);
+  }
+  dout(5) << __func__ << " dictionary " << id << dendl;
+  logger->inc(l_bluestore_compress_dict_pruned);
+}
+
+void BlueStore::_txc_update_compression_dict_refs(TransContext *txc)
+{
+  std::map<uint32_t, int64_t> delta = txc->compression_dict_got;
+  for (auto& [id, n] : txc->compression_dict_put) {
+    delta[id] -= n;
+  }
+  for (auto& [id, n] : delta) {
+    if (n == 0) {
+      continue;
+    }
+    string key;
+    _key_encode_u32(id, &key);
+    bufferlist bl;
+    encode(n, bl);
+    txc->t->merge(PREFIX_COMPRESSION_DICT_REF, key, bl);
+  }
+}
+
 // this stores fiemap into interval_set, other variations
 // use it internally
 int BlueStore::_fiemap(
@@ -11433,6 +11926,9 @@ int BlueStore::_do_readv(
     dout(20) << __func__ << " defaulting to buffered read" << dendl;
     buffered = true;
   }
+  if (!cct->_conf->bluestore_ignore_data_csum) {
+    read_cache_policy |= BufferSpace::BYPASS_UNVERIFIED;
+  }
   // this method must be idempotent since we may call it several times
   // before we finally read the expected result.
   bl.clear();
@@ -12193,8 +12689,11 @@ void BlueStore::_prepare_ondisk_format_super(KeyValueDB::Transaction& t)
     t->set(PREFIX_SUPER, "ondisk_format", bl);
   }
   {
+    // don't lower what the compression dictionaries raised
+    compat_ondisk_format =
+      std::max(compat_ondisk_format, min_compat_ondisk_format);
     bufferlist bl;
-    encode(min_compat_ondisk_format, bl);
+    encode(compat_ondisk_format, bl);
     t->set(PREFIX_SUPER, "min_compat_ondisk_format", bl);
   }
 }
@@ -12249,7 +12748,7 @@ int BlueStore::_open_super_meta()
     dout(5) << __func__ << "::NCB::freelist_type=" << freelist_type << dendl;
   }
   // ondisk format
-  int32_t compat_ondisk_format = 0;
+  compat_ondisk_format = 0;
   {
     bufferlist bl;
     int r = db->get(PREFIX_SUPER, "ondisk_format", &bl);
@@ -12350,6 +12849,11 @@ int BlueStore::_open_super_meta()
   _set_compression();
   _set_blob_size();
 
+  int r = _open_compression_dicts();
+  if (r < 0) {
+    return r;
+  }
+
   _validate_bdev();
   return 0;
 }
@@ -12403,6 +12907,13 @@ int BlueStore::_upgrade_super()
       ceph_assert(r == 0);
       ondisk_format = 4;
     }
+    if (ondisk_format == 4) {
+      // changes:
+      // - blobs may refer to a trained compression dictionary
+      //   (FLAG_COMPRESSION_DICT).  min_compat_ondisk_format is raised to 5
+      //   once the first dictionary is stored.
+      ondisk_format = 5;
+    }
     // This to be the last operation
     _prepare_ondisk_format_super(t);
     int r = db->submit_transaction_sync(t);
@@ -12788,6 +13299,7 @@ void BlueStore::_txc_finalize_kv(TransContext *txc, KeyValueDB::Transaction t)
 #endif
 
   _txc_update_store_statfs(txc);
+  _txc_update_compression_dict_refs(txc);
 }
 
 void BlueStore::_txc_apply_kv(TransContext *txc, bool sync_submit_transaction)
@@ -12841,6 +13353,10 @@ void BlueStore::_txc_committed_kv(TransContext *txc)
 {
   dout(20) << __func__ << " txc " << txc << dendl;
   throttle.complete_kv(*txc);
+  // only now that no blob refers to them on disk
+  for (auto& [id, n] : txc->compression_dict_put) {
+    _put_compression_dict_ref(id, n);
+  }
   {
     std::lock_guard l(txc->osr->qlock);
     txc->set_state(TransContext::STATE_KV_DONE);
@@ -13130,6 +13646,8 @@ void BlueStore::_kv_start()
   dout(10) << __func__ << dendl;
 
   finisher.start();
+  compression_dict_finisher.start();
+  _queue_prune_compression_dicts();
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
 }
@@ -13167,6 +13685,8 @@ void BlueStore::_kv_stop()
   dout(10) << __func__ << " stopping finishers" << dendl;
   finisher.wait_for_empty();
   finisher.stop();
+  compression_dict_finisher.wait_for_empty();
+  compression_dict_finisher.stop();
   dout(10) << __func__ << " stopped" << dendl;
 }
 
@@ -15399,8 +15919,11 @@ int BlueStore::_do_alloc_write(
 
       // FIXME: memory alignment here is bad
       bufferlist t;
-      std::optional<int32_t> compressor_message;
-      int r = c->compress(wi.bl, t, compressor_message);
+      bluestore_compression_header_t chdr;
+      CompressorRef cp = c;
+      _choose_compression_dict(coll, wi.bl, &cp, &chdr.compressor_message);
+      std::optional<int32_t> dict = chdr.compressor_message;
+      int r = _compress(cp, wi.bl, &t, &chdr);
       uint64_t want_len_raw = wi.blob_length * crr;
       uint64_t want_len = p2roundup(want_len_raw, min_alloc_size);
       bool rejected = false;
@@ -15409,10 +15932,8 @@ int BlueStore::_do_alloc_write(
       // that doesn't take header overhead  into account
       uint64_t result_len = p2roundup(compressed_len, min_alloc_size);
       if (r == 0 && result_len <= want_len && result_len < wi.blob_length) {
-	bluestore_compression_header_t chdr;
 	chdr.type = c->get_type();
 	chdr.length = t.length();
-	chdr.compressor_message = compressor_message;
 	encode(chdr, wi.compressed_bl);
 	wi.compressed_bl.claim_append(t);
 
@@ -15433,6 +15954,12 @@ int BlueStore::_do_alloc_write(
 	  txc->statfs_delta.compressed_original() += wi.blob_length;
 	  txc->statfs_delta.compressed_allocated() += result_len;
 	  logger->inc(l_bluestore_compress_success_count);
+	  if (dict && chdr.compressor_message == dict) {
+	    // the ref taken when choosing the dictionary is the blob's now
+	    wi.compression_dict = *dict;
+	    ++txc->compression_dict_got[*dict];
+	    logger->inc(l_bluestore_compress_dict_count);
+	  }
 	  need += result_len;
 	} else {
 	  rejected = true;
@@ -15461,6 +15988,9 @@ int BlueStore::_do_alloc_write(
 	logger->inc(l_bluestore_compress_rejected_count);
 	need += wi.blob_length;
       }
+      if (dict && !wi.compression_dict) {
+	_put_compression_dict_ref(*dict, 1);
+      }
       log_latency("compress@_do_alloc_write",
 	l_bluestore_compress_lat,
         mono_clock::now() - start,
@@ -15468,43 +15998,22 @@ int BlueStore::_do_alloc_write(
     } else {
       need += wi.blob_length;
     }
-  }
-  PExtentVector prealloc;
-  prealloc.reserve(2 * wctx->writes.size());;
-  int64_t prealloc_left = 0;
-  prealloc_left = alloc->allocate(
-    need, min_alloc_size, need,
-    0, &prealloc);
-  if (prealloc_left < 0 || prealloc_left < (int64_t)need) {
-    derr << __func__ << " failed to allocate 0x" << std::hex << need
-         << " allocated 0x " << (prealloc_left < 0 ? 0 : prealloc_left)
-         << " min_alloc_size 0x" << min_alloc_size
-         << " available 0x " << alloc->get_free()
-         << std::dec << dendl;
-    if (prealloc.size()) {
-      alloc->release(prealloc);
-    }
-    return -ENOSPC;
-  }
-  _collect_allocation_stats(need, min_alloc_size, prealloc);
 
-  dout(20) << __func__ << " prealloc " << prealloc << dendl;
-  auto prealloc_pos = prealloc.begin();
-  ceph_assert(prealloc_pos != prealloc.end());
-  uint64_t prealloc_pos_length = prealloc_pos->length;
-
-  for (auto& wi : wctx->writes) {
+    // Set the blob up and checksum it right away rather than after the
+    // allocation below, so that a compressed blob is checksummed while
+    // the compressor output is still in cache.  None of this depends on
+    // where the blob ends up.
     bluestore_blob_t& dblob = wi.b->dirty_blob();
-    uint64_t b_off = wi.b_off;
     bufferlist *l = &wi.bl;
-    uint64_t final_length = wi.blob_length;
     uint64_t csum_length = wi.blob_length;
     if (wi.compressed) {
-      final_length = wi.compressed_bl.length();
-      csum_length = final_length;
+      csum_length = wi.compressed_bl.length();
       unsigned csum_order = ctz(csum_length);
       l = &wi.compressed_bl;
       dblob.set_compressed(wi.blob_length, wi.compressed_len);
+      if (wi.compression_dict) {
+	dblob.set_compression_dict(*wi.compression_dict);
+      }
       if (csum != Checksummer::CSUM_NONE) {
         dout(20) << __func__
 		 << " initialize csum setting for compressed blob " << *wi.b
@@ -15533,13 +16042,15 @@ int BlueStore::_do_alloc_write(
       uint32_t suggested_boff =
        (wi.logical_offset - (wi.b_off0 - wi.b_off)) % max_bsize;
       if ((suggested_boff % (1 << csum_order)) == 0 &&
-           suggested_boff + final_length <= max_bsize &&
-           suggested_boff > b_off) {
+           suggested_boff + wi.blob_length <= max_bsize &&
+           suggested_boff > wi.b_off) {
         dout(20) << __func__ << " forcing blob_offset to 0x"
                  << std::hex << suggested_boff << std::dec << dendl;
-        ceph_assert(suggested_boff >= b_off);
-        csum_length += suggested_boff - b_off;
-        b_off = suggested_boff;
+        ceph_assert(suggested_boff >= wi.b_off);
+        csum_length += suggested_boff - wi.b_off;
+        // the data moves with the blob offset
+        wi.b_off0 += suggested_boff - wi.b_off;
+        wi.b_off = suggested_boff;
       }
       if (csum != Checksummer::CSUM_NONE) {
         dout(20) << __func__
@@ -15551,6 +16062,40 @@ int BlueStore::_do_alloc_write(
         dblob.init_csum(csum, csum_order, csum_length);
       }
     }
+    if (dblob.has_csum()) {
+      dblob.calc_csum(wi.b_off, *l);
+    }
+  }
+  PExtentVector prealloc;
+  prealloc.reserve(2 * wctx->writes.size());;
+  int64_t prealloc_left = 0;
+  prealloc_left = alloc->allocate(
+    need, min_alloc_size, need,
+    0, &prealloc);
+  if (prealloc_left < 0 || prealloc_left < (int64_t)need) {
+    derr << __func__ << " failed to allocate 0x" << std::hex << need
+         << " allocated 0x " << (prealloc_left < 0 ? 0 : prealloc_left)
+         << " min_alloc_size 0x" << min_alloc_size
+         << " available 0x " << alloc->get_free()
+         << std::dec << dendl;
+    if (prealloc.size()) {
+      alloc->release(prealloc);
+    }
+    return -ENOSPC;
+  }
+  _collect_allocation_stats(need, min_alloc_size, prealloc);
+
+  dout(20) << __func__ << " prealloc " << prealloc << dendl;
+  auto prealloc_pos = prealloc.begin();
+  ceph_assert(prealloc_pos != prealloc.end());
+  uint64_t prealloc_pos_length = prealloc_pos->length;
+
+  for (auto& wi : wctx->writes) {
+    bluestore_blob_t& dblob = wi.b->dirty_blob();
+    uint64_t b_off = wi.b_off;
+    bufferlist *l = wi.compressed ? &wi.compressed_bl : &wi.bl;
+    uint64_t final_length =
+      wi.compressed ? wi.compressed_bl.length() : wi.blob_length;
 
     PExtentVector extents;
     int64_t left = final_length;
@@ -15584,9 +16129,6 @@ int BlueStore::_do_alloc_write(
     dblob.allocated(p2align(b_off, min_alloc_size), final_length, extents);
 
     dout(20) << __func__ << " blob " << *wi.b << dendl;
-    if (dblob.has_csum()) {
-      dblob.calc_csum(b_off, *l);
-    }
 
     if (wi.mark_unused) {
       ceph_assert(!dblob.is_compressed());
@@ -15601,7 +16143,7 @@ int BlueStore::_do_alloc_write(
     }
 
     Extent *le = o->extent_map.set_lextent(coll, wi.logical_offset,
-                                           b_off + (wi.b_off0 - wi.b_off),
+                                           wi.b_off0,
                                            wi.length0,
                                            wi.b,
                                            nullptr);
@@ -15678,6 +16220,9 @@ void BlueStore::_wctx_finish(
     if (blob.is_compressed()) {
       if (lo.blob_empty) {
 	txc->statfs_delta.compressed() -= blob.get_compressed_payload_length();
+	if (blob.has_compression_dict()) {
+	  ++txc->compression_dict_put[blob.compression_dict];
+	}
       }
       txc->statfs_delta.compressed_original() -= lo.e.length;
     }
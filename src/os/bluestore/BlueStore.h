@@ -109,6 +109,8 @@ enum {
   l_bluestore_read_onode_meta_lat,
   l_bluestore_read_wait_aio_lat,
   l_bluestore_csum_lat,
+  l_bluestore_csum_verified_bytes,
+  l_bluestore_csum_skipped_bytes,
   l_bluestore_read_eio,
   l_bluestore_reads_with_retries,
   l_bluestore_read_lat,
@@ -156,8 +158,12 @@ enum {
   l_bluestore_compressed_original,
   l_bluestore_compress_lat,
   l_bluestore_decompress_lat,
+  l_bluestore_decompress_skipped_frames,
   l_bluestore_compress_success_count,
   l_bluestore_compress_rejected_count,
+  l_bluestore_compress_dict_count,
+  l_bluestore_compress_dict_trained,
+  l_bluestore_compress_dict_pruned,
   //****************************************
 
   // onode cache stats
@@ -272,12 +278,13 @@ public:
       }
     }
     enum {
-      FLAG_NOCACHE = 1,  ///< trim when done WRITING (do not become CLEAN)
-      // NOTE: fix operator<< when you define a second flag
+      FLAG_NOCACHE = 1,     ///< trim when done WRITING (do not become CLEAN)
+      FLAG_UNVERIFIED = 2,  ///< read from disk without checking the csum
     };
     static const char *get_flag_name(int s) {
       switch (s) {
       case FLAG_NOCACHE: return "nocache";
+      case FLAG_UNVERIFIED: return "unverified";
       default: return "???";
       }
     }
@@ -348,6 +355,7 @@ public:
   struct BufferSpace {
     enum {
       BYPASS_CLEAN_CACHE = 0x1,  // bypass clean cache
+      BYPASS_UNVERIFIED = 0x2,   // bypass clean buffers that weren't verified
     };
 
     typedef boost::intrusive::list<
@@ -445,9 +453,10 @@ public:
       cache->_trim();
     }
     void _finish_write(BufferCacheShard* cache, uint64_t seq);
-    void did_read(BufferCacheShard* cache, uint32_t offset, ceph::buffer::list& bl) {
+    void did_read(BufferCacheShard* cache, uint32_t offset, ceph::buffer::list& bl,
+		  unsigned flags = 0) {
       std::lock_guard l(cache->lock);
-      Buffer *b = new Buffer(this, Buffer::STATE_CLEAN, 0, offset, bl);
+      Buffer *b = new Buffer(this, Buffer::STATE_CLEAN, 0, offset, bl, flags);
       b->cache_private = _discard(cache, offset, bl.length());
       _add_buffer(cache, b, 1, nullptr);
       cache->_trim();
@@ -1725,6 +1734,8 @@ public:
 
     interval_set<uint64_t> allocated, released;
     volatile_statfs statfs_delta;	   ///< overall store statistics delta
+    std::map<uint32_t, int64_t> compression_dict_got; ///< new blob refs by dict
+    std::map<uint32_t, int64_t> compression_dict_put; ///< dropped blob refs by dict
     uint64_t osd_pool_id = META_POOL_ID;    ///< osd pool id we're operating on
 
     IOContext ioc;
@@ -2184,6 +2195,7 @@ private:
   std::atomic_int deferred_queue_size = {0};         ///< num txc's queued across all osrs
   std::atomic_int deferred_aggressive = {0}; ///< aggressive wakeup of kv thread
   Finisher  finisher;
+  Finisher  compression_dict_finisher; ///< trains compression dictionaries
   utime_t  deferred_last_submitted = utime_t();
 
   KVSyncThread kv_sync_thread;
@@ -2267,6 +2279,35 @@ private:
   CompressorRef compressor;
   std::atomic<uint64_t> comp_min_blob_size = {0};
   std::atomic<uint64_t> comp_max_blob_size = {0};
+  std::atomic<uint64_t> comp_frame_size = {0};
+  std::atomic<uint64_t> comp_dict_train_bytes = {0};
+  std::atomic<uint64_t> comp_dict_max_sample_size = {0};
+  std::atomic<uint64_t> comp_dict_size = {0};
+  std::atomic<uint64_t> comp_dict_retrain_bytes = {0};
+
+  /// per-pool state of trained compression dictionaries
+  struct compression_dict_state_t {
+    int32_t active = -1;              ///< dictionary id in use, -1 if none
+    uint64_t compressed_bytes = 0;    ///< bytes compressed with active
+    std::vector<ceph::buffer::list> samples; ///< pending training input
+    uint64_t sample_bytes = 0;
+    bool training = false;
+  };
+  ceph::mutex compression_dict_lock =
+    ceph::make_mutex("BlueStore::compression_dict_lock");
+  CompressorRef dict_compressor;   ///< private, holds every loaded dictionary
+  int32_t compression_dict_last = -1;
+  /// some pool has an active dictionary, read without the lock
+  std::atomic<bool> compression_dict_active = {false};
+  std::map<int64_t, compression_dict_state_t> compression_dicts;
+  /// blobs referring to a dictionary.  refs taken by blobs being written
+  /// count right away, refs dropped only once that is committed, so that a
+  /// dictionary at 0 which is no longer active can be pruned
+  struct compression_dict_ref_t {
+    int64_t pool = 0;
+    int64_t refs = 0;
+  };
+  std::map<uint32_t, compression_dict_ref_t> compression_dict_refs;
 
   std::atomic<uint64_t> max_blob_size = {0};  ///< maximum blob size
 
@@ -2312,6 +2353,8 @@ private:
     std::shared_ptr<PriorityCache::PriCache> binned_kv_cache = nullptr;
     std::shared_ptr<PriorityCache::PriCache> binned_kv_onode_cache = nullptr;
     std::shared_ptr<PriorityCache::Manager> pcm = nullptr;
+    /// caches of the store's user, waiting to be added to pcm
+    std::map<std::string, std::shared_ptr<PriorityCache::PriCache>> pending_caches;
 
     struct MempoolCache : public PriorityCache::PriCache {
       BlueStore *store;
@@ -2521,6 +2564,11 @@ private:
       ceph_assert(stop == false);
       create("bstore_mempool");
     }
+    void add_cache(const std::string& name,
+                   std::shared_ptr<PriorityCache::PriCache> c) {
+      std::lock_guard l{lock};
+      pending_caches[name] = c;
+    }
     void shutdown() {
       lock.lock();
       stop = true;
@@ -2767,12 +2815,15 @@ private:
 
   // -- ondisk version ---
 public:
-  const int32_t latest_ondisk_format = 4;        ///< our version
+  const int32_t latest_ondisk_format = 5;        ///< our version
   const int32_t min_readable_ondisk_format = 1;  ///< what we can read
   const int32_t min_compat_ondisk_format = 3;    ///< who can read us
+  /// who can read us once a compression dictionary has been stored
+  const int32_t min_compat_ondisk_format_dict = 5;
 
 private:
   int32_t ondisk_format = 0;  ///< value detected on mount
+  int32_t compat_ondisk_format = 0;  ///< value detected on mount
   bool    m_fast_shutdown = false;
   int _upgrade_super();  ///< upgrade (called during open_super)
   uint64_t _get_ondisk_reserved() const;
@@ -2856,6 +2907,11 @@ public:
   }
 
   void set_cache_shards(unsigned num) override;
+  void add_priority_cache(
+    const std::string& name,
+    std::shared_ptr<PriorityCache::PriCache> c) override {
+    mempool_thread.add_cache(name, c);
+  }
   void dump_cache_stats(ceph::Formatter *f) override {
     int onode_count = 0, buffers_bytes = 0;
     for (auto i: onode_cache_shards) {
@@ -3319,6 +3375,32 @@ private:
     const ceph::buffer::list& bl,
     uint64_t logical_offset) const;
   int _decompress(ceph::buffer::list& source, ceph::buffer::list* result);
+  int _decompress(ceph::buffer::list& source,
+		  uint32_t offset,
+		  uint32_t length,
+		  ceph::buffer::list* result,
+		  uint32_t* result_offset);
+
+  // compression dictionaries
+  int _open_compression_dicts();
+  void _close_compression_dicts();
+  void _choose_compression_dict(
+    CollectionRef& c,
+    const ceph::buffer::list& bl,
+    CompressorRef* cp,
+    std::optional<int32_t>* compressor_message);
+  void _train_compression_dict(int64_t pool,
+			       std::vector<ceph::buffer::list> samples);
+  void _get_compression_dict_ref(TransContext* txc, uint32_t id);
+  void _put_compression_dict_ref(uint32_t id, int64_t n);
+  bool _compression_dict_unused(uint32_t id) const;
+  void _queue_prune_compression_dicts();
+  void _prune_compression_dict(uint32_t id);
+  void _txc_update_compression_dict_refs(TransContext *txc);
+  int _compress(CompressorRef& cp,
+		const ceph::buffer::list& source,
+		ceph::buffer::list* result,
+		bluestore_compression_header_t* chdr);
 
 
   // --------------------------------------------------------
@@ -3348,6 +3430,7 @@ private:
       bool compressed = false;
       ceph::buffer::list compressed_bl;
       size_t compressed_len = 0;
+      std::optional<uint32_t> compression_dict; ///< trained dictionary used
 
       write_item(
 	uint64_t logical_offs,
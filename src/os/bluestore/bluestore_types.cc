@@ -654,6 +654,11 @@ string bluestore_blob_t::get_flags_string(unsigned flags)
       s += '+';
     s += "shared";
   }
+  if (flags & FLAG_COMPRESSION_DICT) {
+    if (s.length())
+      s += '+';
+    s += "compression_dict";
+  }
 
   return s;
 }
@@ -673,6 +678,9 @@ void bluestore_blob_t::dump(Formatter *f) const
   f->dump_unsigned("logical_length", logical_length);
   f->dump_unsigned("compressed_length", compressed_length);
   f->dump_unsigned("flags", flags);
+  if (has_compression_dict()) {
+    f->dump_unsigned("compression_dict", compression_dict);
+  }
   f->dump_unsigned("csum_type", csum_type);
   f->dump_unsigned("csum_chunk_order", csum_chunk_order);
   f->open_array_section("csum_data");
@@ -709,6 +717,9 @@ ostream& operator<<(ostream& out, const bluestore_blob_t& o)
 	<< " -> 0x"
 	<< o.get_compressed_payload_length()
 	<< std::dec;
+    if (o.has_compression_dict()) {
+      out << " dict " << o.compression_dict;
+    }
   }
   if (o.flags) {
     out << " " << o.get_flags_string();
@@ -1172,6 +1183,14 @@ void bluestore_compression_header_t::dump(Formatter *f) const
   if (compressor_message) {
     f->dump_int("compressor_message", *compressor_message);
   }
+  if (frame_size) {
+    f->dump_unsigned("frame_size", frame_size);
+    f->open_array_section("frame_lengths");
+    for (auto l : frame_lengths) {
+      f->dump_unsigned("length", l);
+    }
+    f->close_section();
+  }
 }
 
 void bluestore_compression_header_t::generate_test_instances(
@@ -1180,6 +1199,27 @@ void bluestore_compression_header_t::generate_test_instances(
   o.push_back(new bluestore_compression_header_t);
   o.push_back(new bluestore_compression_header_t(1));
   o.back()->length = 1234;
+  o.push_back(new bluestore_compression_header_t(3));
+  o.back()->length = 300;
+  o.back()->frame_size = 16384;
+  o.back()->frame_lengths = {100, 120, 80};
+}
+
+void bluestore_compression_dict_t::dump(Formatter *f) const
+{
+  f->dump_int("pool", pool);
+  f->dump_unsigned("type", type);
+  f->dump_unsigned("length", data.length());
+}
+
+void bluestore_compression_dict_t::generate_test_instances(
+  list<bluestore_compression_dict_t*>& o)
+{
+  o.push_back(new bluestore_compression_dict_t);
+  o.push_back(new bluestore_compression_dict_t);
+  o.back()->pool = 3;
+  o.back()->type = Compressor::COMP_ALG_ZSTD;
+  o.back()->data.append("dictionary");
 }
 
 // adds more salt to build a hash func input
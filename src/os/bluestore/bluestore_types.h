@@ -444,6 +444,7 @@ public:
     FLAG_CSUM = 4,            ///< blob has checksums
     FLAG_HAS_UNUSED = 8,      ///< blob has unused std::map
     FLAG_SHARED = 16,         ///< blob is shared; see external SharedBlob
+    FLAG_COMPRESSION_DICT = 32, ///< compressed with a trained dictionary
   };
   static std::string get_flags_string(unsigned flags);
 
@@ -454,6 +455,7 @@ public:
 
   uint8_t csum_type = Checksummer::CSUM_NONE;      ///< CSUM_*
   uint8_t csum_chunk_order = 0;       ///< csum block size is 1<<block_order bytes
+  uint32_t compression_dict = 0;      ///< dictionary id if FLAG_COMPRESSION_DICT
 
   ceph::buffer::ptr csum_data;                ///< opaque std::vector of csum data
 
@@ -473,6 +475,7 @@ public:
     denc_varint(flags, p);
     denc_varint_lowz(logical_length, p);
     denc_varint_lowz(compressed_length, p);
+    denc_varint(compression_dict, p);
     denc(csum_type, p);
     denc(csum_chunk_order, p);
     denc_varint(csum_data.length(), p);
@@ -487,6 +490,9 @@ public:
     if (is_compressed()) {
       denc_varint_lowz(logical_length, p);
       denc_varint_lowz(compressed_length, p);
+      if (has_compression_dict()) {
+	denc_varint(compression_dict, p);
+      }
     }
     if (has_csum()) {
       denc(csum_type, p);
@@ -507,6 +513,9 @@ public:
     if (is_compressed()) {
       denc_varint_lowz(logical_length, p);
       denc_varint_lowz(compressed_length, p);
+      if (has_compression_dict()) {
+	denc_varint(compression_dict, p);
+      }
     } else {
       logical_length = get_ondisk_length();
     }
@@ -554,6 +563,10 @@ public:
     logical_length = clen_orig;
     compressed_length = clen;
   }
+  void set_compression_dict(uint32_t id) {
+    set_flag(FLAG_COMPRESSION_DICT);
+    compression_dict = id;
+  }
   bool is_mutable() const {
     return !is_compressed() && !is_shared();
   }
@@ -569,6 +582,9 @@ public:
   bool is_shared() const {
     return has_flag(FLAG_SHARED);
   }
+  bool has_compression_dict() const {
+    return has_flag(FLAG_COMPRESSION_DICT);
+  }
 
   /// return chunk (i.e. min readable block) size for the blob
   uint64_t get_chunk_size(uint64_t dev_block_size) const {
@@ -1107,18 +1123,27 @@ struct bluestore_compression_header_t {
   uint8_t type = Compressor::COMP_ALG_NONE;
   uint32_t length = 0;
   std::optional<int32_t> compressor_message;
+  /// if set, the payload is a sequence of independently compressed frames
+  /// of frame_size raw bytes each (the last one may be shorter)
+  uint32_t frame_size = 0;
+  std::vector<uint32_t> frame_lengths; ///< compressed length of each frame
 
   bluestore_compression_header_t() {}
   bluestore_compression_header_t(uint8_t _type)
     : type(_type) {}
 
   DENC(bluestore_compression_header_t, v, p) {
-    DENC_START(2, 1, p);
+    // framed payloads can't be decompressed by older code
+    DENC_START(3, v.frame_size ? 3 : 1, p);
     denc(v.type, p);
     denc(v.length, p);
     if (struct_v >= 2) {
       denc(v.compressor_message, p);
     }
+    if (struct_v >= 3) {
+      denc(v.frame_size, p);
+      denc(v.frame_lengths, p);
+    }
     DENC_FINISH(p);
   }
   void dump(ceph::Formatter *f) const;
@@ -1126,6 +1151,25 @@ struct bluestore_compression_header_t {
 };
 WRITE_CLASS_DENC(bluestore_compression_header_t)
 
+/// trained compression dictionary, referenced by id from
+/// bluestore_compression_header_t::compressor_message
+struct bluestore_compression_dict_t {
+  int64_t pool = 0;          ///< pool the dictionary was trained for
+  uint8_t type = Compressor::COMP_ALG_NONE; ///< compressor that owns it
+  ceph::buffer::list data;   ///< raw dictionary content
+
+  DENC(bluestore_compression_dict_t, v, p) {
+    DENC_START(1, 1, p);
+    denc(v.pool, p);
+    denc(v.type, p);
+    denc(v.data, p);
+    DENC_FINISH(p);
+  }
+  void dump(ceph::Formatter *f) const;
+  static void generate_test_instances(std::list<bluestore_compression_dict_t*>& o);
+};
+WRITE_CLASS_DENC(bluestore_compression_dict_t)
+
 template <template <typename> typename V, class COUNTER_TYPE = int32_t>
 class ref_counter_2hash_tracker_t {
   size_t num_non_zero = 0;
@@ -51,6 +51,7 @@ using ceph::bufferlist;
 using ceph::bufferptr;
 using ceph::ErasureCodeInterfaceRef;
 using ceph::Formatter;
+using ceph::osd::scheduler::OpStoreCost;
 
 static ostream& _prefix(std::ostream *_dout, ECBackend *pgb) {
   return pgb->get_parent()->gen_dbg_prefix(*_dout);
@@ -61,15 +62,8 @@ struct ECRecoveryHandle : public PGBackend::RecoveryHandle {
 };
 
 ostream &operator<<(ostream &lhs, const ECBackend::pipeline_state_t &rhs) {
-  switch (rhs.pipeline_state) {
-  case ECBackend::pipeline_state_t::CACHE_VALID:
-    return lhs << "CACHE_VALID";
-  case ECBackend::pipeline_state_t::CACHE_INVALID:
-    return lhs << "CACHE_INVALID";
-  default:
-    ceph_abort_msg("invalid pipeline state");
-  }
-  return lhs; // unreachable
+  return lhs << "pipeline_state(in_flight=" << rhs.in_flight
+	     << " cache_invalid=" << rhs.cache_invalid << ")";
 }
 
 static ostream &operator<<(ostream &lhs, const map<pg_shard_t, bufferlist> &rhs)
@@ -379,6 +373,8 @@ void ECBackend::handle_recovery_push(
   }
   if (op.after_progress.data_complete) {
     if ((get_parent()->pgb_is_primary())) {
+      get_parent()->get_ec_stripe_cache()->invalidate(
+	get_parent()->get_info().pgid.pgid, op.soid);
       ceph_assert(recovery_ops.count(op.soid));
       ceph_assert(recovery_ops[op.soid].obc);
       if (get_parent()->pg_is_repair() || is_repair)
@@ -669,6 +665,7 @@ void ECBackend::continue_recovery_op(
 	pop.soid = op.hoid;
 	pop.version = op.v;
 	pop.data = op.returned_data[mi->shard];
+	get_parent()->get_logger()->inc(l_osd_rbytes, pop.data.length());
 	dout(10) << __func__ << ": before_progress=" << op.recovery_progress
 		 << ", after_progress=" << after_progress
 		 << ", pop.data.length()=" << pop.data.length()
@@ -1468,6 +1465,8 @@ void ECBackend::on_change()
   completed_to = eversion_t();
   committed_to = eversion_t();
   pipeline_state.clear();
+  get_parent()->get_ec_stripe_cache()->clear_pg(
+    get_parent()->get_info().pgid.pgid);
   waiting_reads.clear();
   waiting_state.clear();
   waiting_commit.clear();
@@ -1558,7 +1557,11 @@ void ECBackend::submit_transaction(
 }
 
 void ECBackend::call_write_ordered(std::function<void(void)> &&cb) {
-  if (!waiting_state.empty()) {
+  // writes start committing in tid order, so hang it off the newest one
+  // that hasn't yet
+  if (!waiting_state.empty() &&
+      (waiting_reads.empty() ||
+       waiting_state.back().tid > waiting_reads.back().tid)) {
     waiting_state.back().on_write.emplace_back(std::move(cb));
   } else if (!waiting_reads.empty()) {
     waiting_reads.back().on_write.emplace_back(std::move(cb));
@@ -1907,31 +1910,59 @@ void ECBackend::start_rmw(Op *op, PGTransactionUPtr &&t)
   check_ops();
 }
 
-bool ECBackend::try_state_to_reads()
+ECBackend::Op *ECBackend::pipeline_state_t::next_ready(
+  op_list &waiting_state) const
 {
-  if (waiting_state.empty())
-    return false;
+  // objects of older writes still stuck in waiting_state
+  set<hobject_t> held;
+  for (auto &&i: waiting_state) {
+    bool ordered = true;
+    for (auto &&h: i.plan.hash_infos) {
+      if (held.count(h.first)) {
+	ordered = false;
+	break;
+      }
+    }
+    if (ordered && !(i.requires_rmw() && !caching_enabled(i)))
+      return &i;
+    for (auto &&h: i.plan.hash_infos) {
+      held.insert(h.first);
+    }
+  }
+  return nullptr;
+}
 
-  Op *op = &(waiting_state.front());
-  if (op->requires_rmw() && pipeline_state.cache_invalid()) {
-    ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
-    dout(20) << __func__ << ": blocking " << *op
-	     << " because it requires an rmw and the cache is invalid "
-	     << pipeline_state
-	     << dendl;
+bool ECBackend::try_state_to_reads()
+{
+  Op *op = pipeline_state.next_ready(waiting_state);
+  if (!op) {
+    if (!waiting_state.empty()) {
+      ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
+      dout(20) << __func__ << ": blocking " << waiting_state.front()
+	       << " because it requires an rmw and the cache is invalid "
+	       << pipeline_state
+	       << dendl;
+    }
     return false;
   }
 
-  if (!pipeline_state.caching_enabled()) {
+  if (try_parity_delta(*op)) {
+    dout(20) << __func__ << ": parity delta update for "
+	     << op->plan.parity_deltas.begin()->first << dendl;
+    op->using_cache = false;
+  } else if (!pipeline_state.caching_enabled(*op)) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
-    dout(20) << __func__ << ": invalidating cache after this op"
-	     << dendl;
-    pipeline_state.invalidate();
+    dout(20) << __func__ << ": invalidating cache for this op's objects"
+	     << " after this op" << dendl;
   }
+  pipeline_state.start(*op);
 
-  waiting_state.pop_front();
-  waiting_reads.push_back(*op);
+  waiting_state.erase(waiting_state.iterator_to(*op));
+  auto pos = waiting_reads.end();
+  while (pos != waiting_reads.begin() && std::prev(pos)->tid > op->tid)
+    --pos;
+  waiting_reads.insert(pos, *op);
 
   if (op->using_cache) {
     cache.open_write_pin(op->pin);
@@ -1960,27 +1991,184 @@ bool ECBackend::try_state_to_reads()
 	op->pending_read[hpair.first] = std::move(pending_read);
       }
     }
-  } else {
+  } else if (op->plan.parity_deltas.empty()) {
     op->remote_read = op->plan.to_read;
   }
 
+  if (op->plan.parity_deltas.empty() &&
+      get_parent()->get_pool().allows_ecoverwrites()) {
+    auto stripe_cache = get_parent()->get_ec_stripe_cache();
+    for (auto i = op->remote_read.begin(); i != op->remote_read.end(); ) {
+      extent_map hit = stripe_cache->get(
+	get_parent()->get_info().pgid.pgid, i->first, i->second);
+      if (!hit.empty()) {
+	i->second.subtract(hit.get_interval_set());
+	op->stripe_cache_hits[i->first] = std::move(hit);
+      }
+      if (i->second.empty()) {
+	i = op->remote_read.erase(i);
+      } else {
+	++i;
+      }
+    }
+  }
+
   dout(10) << __func__ << ": " << *op << dendl;
 
-  if (!op->remote_read.empty()) {
-    ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
-    objects_read_async_no_cache(
-      op->remote_read,
-      [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
-	for (auto &&i: results) {
-	  op->remote_read_result.emplace(i.first, i.second.second);
-	}
-	check_ops();
-      });
+  if (!op->plan.parity_deltas.empty()) {
+    start_parity_delta_read(op);
+  } else if (!op->remote_read.empty()) {
+    start_remote_read(op);
   }
 
   return true;
 }
 
+void ECBackend::start_remote_read(Op *op)
+{
+  ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
+  objects_read_async_no_cache(
+    op->remote_read,
+    [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+      for (auto &&i: results) {
+	op->remote_read_result.emplace(i.first, i.second.second);
+      }
+      check_ops();
+    });
+}
+
+bool ECBackend::try_parity_delta(Op &op)
+{
+  if (!op.requires_rmw() ||
+      !cct->_conf->osd_ec_parity_delta_writes ||
+      !ec_impl->supports_parity_delta() ||
+      !get_parent()->get_pool().allows_ecoverwrites() ||
+      !get_parent()->get_backfill_shards().empty() ||
+      !pipeline_state.is_idle(op))
+    return false;
+  if (!ECTransaction::plan_parity_delta(
+	sinfo, ec_impl, op.plan, get_parent()->get_dpp()))
+    return false;
+
+  // the shards we skip have to be up to date as well as those we read
+  const hobject_t &hoid = op.plan.parity_deltas.begin()->first;
+  for (auto &&i: get_parent()->get_acting_recovery_backfill_shards()) {
+    if (get_parent()->get_shard_missing(i).is_missing(hoid)) {
+      op.plan.parity_deltas.clear();
+      return false;
+    }
+  }
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, set<pg_shard_t>(), have, shards, false);
+  for (int i: op.plan.parity_deltas.begin()->second.shards) {
+    if (!have.count(i)) {
+      op.plan.parity_deltas.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+struct FinishParityDeltaRead :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ECBackend::Op *op;
+  hobject_t hoid;
+  FinishParityDeltaRead(ECBackend *ec, ECBackend::Op *op, const hobject_t &hoid)
+    : ec(ec), op(op), hoid(hoid) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ec->handle_parity_delta_read(op, hoid, in.second);
+  }
+};
+
+void ECBackend::start_parity_delta_read(Op *op)
+{
+  ceph_assert(op->plan.parity_deltas.size() == 1);
+  auto &[hoid, delta] = *op->plan.parity_deltas.begin();
+
+  set<int> have;
+  map<shard_id_t, pg_shard_t> shards;
+  get_all_avail_shards(hoid, set<pg_shard_t>(), have, shards, false);
+  map<pg_shard_t, vector<pair<int, int>>> need;
+  for (int i: delta.shards) {
+    auto iter = shards.find(shard_id_t(i));
+    ceph_assert(iter != shards.end());
+    need[iter->second].push_back(
+      make_pair(0, ec_impl->get_sub_chunk_count()));
+  }
+  list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+  for (auto &&extent: delta.stripes) {
+    to_read.push_back(boost::make_tuple(extent.first, extent.second, 0));
+  }
+
+  map<hobject_t, set<int>> want_to_read;
+  want_to_read[hoid] = delta.shards;
+  map<hobject_t, read_request_t> for_read_op;
+  for_read_op.insert(
+    make_pair(
+      hoid,
+      read_request_t(
+	to_read,
+	need,
+	false,
+	new FinishParityDeltaRead(this, op, hoid))));
+  op->shard_read_in_progress = true;
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    want_to_read,
+    for_read_op,
+    op->client_op,
+    false, false);
+}
+
+void ECBackend::handle_parity_delta_read(
+  Op *op,
+  const hobject_t &hoid,
+  read_result_t &res)
+{
+  ceph_assert(op->shard_read_in_progress);
+  op->shard_read_in_progress = false;
+  auto &delta = op->plan.parity_deltas[hoid];
+
+  /* A shard that failed may have been decoded from the others, which
+   * doesn't help us; fall back to the stripe rmw in that case. */
+  map<int, extent_map> chunks;
+  bool complete = res.r == 0;
+  for (auto &&i: res.returned) {
+    if (!complete)
+      break;
+    pair<uint64_t, uint64_t> chunk_off_len =
+      sinfo.aligned_offset_len_to_chunk(make_pair(i.get<0>(), i.get<1>()));
+    for (auto &&j: i.get<2>()) {
+      if (delta.shards.count(j.first.shard) &&
+	  j.second.length() == chunk_off_len.second) {
+	chunks[j.first.shard].insert(
+	  chunk_off_len.first, chunk_off_len.second, j.second);
+      }
+    }
+    for (int shard: delta.shards) {
+      if (!chunks.count(shard) ||
+	  !chunks[shard].get_interval_set().contains(
+	    chunk_off_len.first, chunk_off_len.second)) {
+	complete = false;
+	break;
+      }
+    }
+  }
+  if (!complete) {
+    dout(10) << __func__ << ": " << hoid << " shard read failed (r="
+	     << res.r << ", errors=" << res.errors
+	     << "), falling back to full stripe rmw" << dendl;
+    op->plan.parity_deltas.clear();
+    op->remote_read = op->plan.to_read;
+    start_remote_read(op);
+    return;
+  }
+  op->shard_read_result[hoid] = std::move(chunks);
+  check_ops();
+}
+
 bool ECBackend::try_reads_to_commit()
 {
   if (waiting_reads.empty())
@@ -1988,6 +2176,12 @@ bool ECBackend::try_reads_to_commit()
   Op *op = &(waiting_reads.front());
   if (op->read_in_progress())
     return false;
+  if (!waiting_state.empty() &&
+      waiting_state.front().tid < op->tid) {
+    dout(20) << __func__ << ": " << *op << " waiting for older "
+	     << waiting_state.front() << " to start" << dendl;
+    return false;
+  }
   waiting_reads.pop_front();
   waiting_commit.push_back(*op);
 
@@ -2010,6 +2204,25 @@ bool ECBackend::try_reads_to_commit()
   } else {
     ceph_assert(op->pending_read.empty());
   }
+  for (auto &&hpair: op->stripe_cache_hits) {
+    op->remote_read_result[hpair.first].insert(hpair.second);
+  }
+  op->stripe_cache_hits.clear();
+
+  // objects whose data changes in ways written doesn't capture
+  set<hobject_t> stripe_cache_invalid;
+  if (op->plan.t) {
+    for (auto &&[oid, pgop]: op->plan.t->op_map) {
+      hobject_t source;
+      if (pgop.has_source(&source)) {
+	stripe_cache_invalid.insert(source);
+	stripe_cache_invalid.insert(oid);
+      } else if (pgop.is_delete() || pgop.deletes_first() || pgop.truncate ||
+		 op->plan.parity_deltas.count(oid)) {
+	stripe_cache_invalid.insert(oid);
+      }
+    }
+  }
 
   map<shard_id_t, ObjectStore::Transaction> trans;
   for (set<pg_shard_t>::const_iterator i =
@@ -2029,6 +2242,7 @@ bool ECBackend::try_reads_to_commit()
       get_parent()->get_info().pgid.pgid,
       sinfo,
       op->remote_read_result,
+      op->shard_read_result,
       op->log_entries,
       &written,
       &trans,
@@ -2053,11 +2267,17 @@ bool ECBackend::try_reads_to_commit()
   }
 
   map<hobject_t,extent_set> written_set;
+  map<hobject_t,extent_set> will_write = op->plan.will_write;
   for (auto &&i: written) {
+    if (op->plan.parity_deltas.count(i.first)) {
+      // only the modified chunks, not whole stripes, were written
+      will_write.erase(i.first);
+      continue;
+    }
     written_set[i.first] = i.second.get_interval_set();
   }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
-  ceph_assert(written_set == op->plan.will_write);
+  ceph_assert(written_set == will_write);
 
   if (op->using_cache) {
     for (auto &&hpair: written) {
@@ -2065,8 +2285,20 @@ bool ECBackend::try_reads_to_commit()
       cache.present_rmw_update(hpair.first, op->pin, hpair.second);
     }
   }
+  if (get_parent()->get_pool().allows_ecoverwrites()) {
+    auto stripe_cache = get_parent()->get_ec_stripe_cache();
+    const pg_t &pgid = get_parent()->get_info().pgid.pgid;
+    for (auto &&oid: stripe_cache_invalid) {
+      stripe_cache->invalidate(pgid, oid);
+    }
+    for (auto &&hpair: written) {
+      if (!stripe_cache_invalid.count(hpair.first))
+	stripe_cache->put(pgid, hpair.first, hpair.second);
+    }
+  }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->shard_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -2182,12 +2414,13 @@ bool ECBackend::try_finish_rmw()
   if (op->using_cache) {
     cache.release_write_pin(op->pin);
   }
+  pipeline_state.finish(*op);
   tid_to_op_map.erase(op->tid);
 
   if (waiting_reads.empty() &&
       waiting_commit.empty()) {
-    pipeline_state.clear();
-    dout(20) << __func__ << ": clearing pipeline_state "
+    ceph_assert(pipeline_state.is_empty());
+    dout(20) << __func__ << ": pipeline drained "
 	     << pipeline_state
 	     << dendl;
   }
@@ -2229,6 +2462,8 @@ void ECBackend::objects_read_async(
        i != to_read.end();
        ++i) {
     pair<uint64_t, uint64_t> tmp =
+      cct->_conf->osd_ec_partial_reads ?
+      make_pair(i->first.get<0>(), i->first.get<1>()) :
       sinfo.offset_len_to_stripe_bounds(
 	make_pair(i->first.get<0>(), i->first.get<1>()));
 
@@ -2363,11 +2598,24 @@ struct CallClientContexts :
 	   ++j) {
 	to_decode[j->first.shard] = std::move(j->second);
       }
-      int r = ECUtil::decode(
-	ec->sinfo,
-	ec->ec_impl,
-	to_decode,
-	&bl);
+      int r;
+      if (adjusted == make_pair(read.get<0>(), read.get<1>())) {
+	r = ECUtil::decode(
+	  ec->sinfo,
+	  ec->ec_impl,
+	  to_decode,
+	  &bl);
+      } else {
+	// to_decode may only have some of the data chunks
+	r = ECUtil::decode(
+	  ec->sinfo,
+	  ec->ec_impl,
+	  to_decode,
+	  read.get<0>() - adjusted.first,
+	  read.get<1>(),
+	  &bl);
+	adjusted.first = read.get<0>();
+      }
       if (r < 0) {
         res.r = r;
         goto out;
@@ -2403,11 +2651,28 @@ void ECBackend::objects_read_and_reconstruct(
   }
 
   map<hobject_t, set<int>> obj_want_to_read;
-  set<int> want_to_read;
-  get_want_to_read_shards(&want_to_read);
+  set<int> all_data_shards;
+  get_want_to_read_shards(&all_data_shards);
     
   map<hobject_t, read_request_t> for_read_op;
   for (auto &&to_read: reads) {
+    // the shards always read whole stripes
+    list<boost::tuple<uint64_t, uint64_t, uint32_t> > aligned;
+    for (auto &&i: to_read.second) {
+      pair<uint64_t, uint64_t> bounds =
+	sinfo.offset_len_to_stripe_bounds(make_pair(i.get<0>(), i.get<1>()));
+      aligned.emplace_back(bounds.first, bounds.second, i.get<2>());
+    }
+
+    set<int> want_to_read;
+    if (cct->_conf->osd_ec_partial_reads) {
+      get_want_to_read_shards(to_read.second, &want_to_read);
+    } else {
+      want_to_read = all_data_shards;
+    }
+    dout(20) << __func__ << ": " << to_read.first
+	     << " want shards " << want_to_read << dendl;
+
     map<pg_shard_t, vector<pair<int, int>>> shards;
     int r = get_min_avail_to_read_shards(
       to_read.first,
@@ -2426,7 +2691,7 @@ void ECBackend::objects_read_and_reconstruct(
       make_pair(
 	to_read.first,
 	read_request_t(
-	  to_read.second,
+	  aligned,
 	  shards,
 	  false,
 	  c)));
@@ -2545,13 +2810,16 @@ int ECBackend::be_deep_scrub(
     stride += sinfo.get_chunk_size() - (stride % sinfo.get_chunk_size());
 
   bufferlist bl;
-  r = store->read(
-    ch,
-    ghobject_t(
-      poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-    pos.data_pos,
-    stride, bl,
-    fadvise_flags);
+  {
+    OpStoreCost::ReadTimer timer;
+    r = store->read(
+      ch,
+      ghobject_t(
+	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+      pos.data_pos,
+      stride, bl,
+      fadvise_flags);
+  }
   if (r < 0) {
     dout(20) << __func__ << "  " << poid << " got "
 	     << r << " on read, read_error" << dendl;
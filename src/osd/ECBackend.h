@@ -135,6 +135,11 @@ public:
    * still only perform a client read from shards in the acting std::set.  This
    * ensures that we won't ever have to restart a client initiated read in
    * check_recovery_sources.
+   *
+   * The extents in reads needn't be stripe aligned.  Whole stripes are
+   * read from the shards, but with osd_ec_partial_reads only from the
+   * data shards the extents fall in (or enough others to decode those),
+   * and the results hold exactly the requested extents.
    */
   void objects_read_and_reconstruct(
     const std::map<hobject_t, std::list<boost::tuple<uint64_t, uint64_t, uint32_t> >
@@ -215,6 +220,21 @@ private:
       want_to_read->insert(chunk);
     }
   }
+  /// only the data shards backing the given (unaligned) extents
+  void get_want_to_read_shards(
+    const std::list<boost::tuple<uint64_t, uint64_t, uint32_t> > &to_read,
+    std::set<int> *want_to_read) const {
+    std::set<int> chunks;
+    for (auto &&i: to_read) {
+      sinfo.offset_len_to_chunks(
+	std::make_pair(i.get<0>(), i.get<1>()), &chunks);
+    }
+    const std::vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+    for (int i : chunks) {
+      int chunk = (int)chunk_mapping.size() > i ? chunk_mapping[i] : i;
+      want_to_read->insert(chunk);
+    }
+  }
 
   /**
    * Recovery
@@ -481,8 +501,14 @@ public:
     std::map<hobject_t,extent_set> pending_read; // subset already being read
     std::map<hobject_t,extent_set> remote_read;  // subset we must read
     std::map<hobject_t,extent_map> remote_read_result;
+    /// part of remote_read found in the OSD's ECStripeCache instead
+    std::map<hobject_t,extent_map> stripe_cache_hits;
+    /// old shard contents for plan.parity_deltas, by chunk offset
+    std::map<hobject_t,std::map<int,extent_map>> shard_read_result;
+    bool shard_read_in_progress = false;
     bool read_in_progress() const {
-      return !remote_read.empty() && remote_read_result.empty();
+      return shard_read_in_progress ||
+	(!remote_read.empty() && remote_read_result.empty());
     }
 
     /// In progress write state.
@@ -515,54 +541,95 @@ public:
 
   /**
    * We model the possible rmw states as a std::set of waitlists.
-   * All writes at this time complete in order, so a write blocked
-   * at waiting_state blocks all writes behind it as well (same for
-   * other states).
    *
-   * Future work: We can break this up into a per-object pipeline
-   * (almost).  First, provide an ordering token to submit_transaction
-   * and require that all operations within a single transaction take
-   * place on a subset of hobject_t space partitioned by that token
-   * (the hashid seem about right to me -- even works for temp objects
-   * if you recall that a temp object created for object head foo will
-   * only ever be referenced by other transactions on foo and aren't
-   * reused).  Next, factor this part into a class and maintain one per
-   * ordering token.  Next, fixup PrimaryLogPG's repop queue to be
-   * partitioned by ordering token.  Finally, refactor the op pipeline
-   * so that the log entries passed into submit_transaction aren't
-   * versioned.  We can't assign versions to them until we actually
-   * submit the operation.  That's probably going to be the hard part.
+   * Writes must *start* committing (i.e. send their ECSubWrites) in tid
+   * order, since the log entries they carry have to reach each shard in
+   * version order.  Everything before that is pipelined per object: a
+   * write blocked in waiting_state only holds back later writes touching
+   * one of the same objects, so writes to other objects can move on and
+   * get their partial stripe reads going.  waiting_reads is kept in tid
+   * order and its front may only start committing once no older write is
+   * left in waiting_state.
+   *
+   * Future work: to commit out of order as well we'd need to stop
+   * versioning the log entries passed into submit_transaction and
+   * assign versions at commit time.  That's probably going to be the
+   * hard part.
    */
   class pipeline_state_t {
-    enum {
-      CACHE_VALID = 0,
-      CACHE_INVALID = 1
-    } pipeline_state = CACHE_VALID;
+    /// number of writes past waiting_state touching each object
+    std::map<hobject_t, unsigned> in_flight;
+    /// objects with an in flight write that bypassed or invalidated the
+    /// extent cache; rmws on them have to wait for those to finish
+    std::set<hobject_t> cache_invalid;
   public:
-    bool caching_enabled() const {
-      return pipeline_state == CACHE_VALID;
+    bool caching_enabled(const Op &op) const {
+      for (auto &&i: op.plan.hash_infos) {
+	if (cache_invalid.count(i.first))
+	  return false;
+      }
+      return true;
     }
-    bool cache_invalid() const {
-      return !caching_enabled();
+    bool is_empty() const {
+      return in_flight.empty();
     }
-    void invalidate() {
-      pipeline_state = CACHE_INVALID;
+    /// no write on any of op's objects is in flight
+    bool is_idle(const Op &op) const {
+      for (auto &&i: op.plan.hash_infos) {
+	if (in_flight.count(i.first))
+	  return false;
+      }
+      return true;
+    }
+    /// op is leaving waiting_state
+    void start(const Op &op) {
+      for (auto &&i: op.plan.hash_infos) {
+	++in_flight[i.first];
+	if (!op.using_cache || op.invalidates_cache())
+	  cache_invalid.insert(i.first);
+      }
+    }
+    /// op is done
+    void finish(const Op &op) {
+      for (auto &&i: op.plan.hash_infos) {
+	auto p = in_flight.find(i.first);
+	ceph_assert(p != in_flight.end());
+	if (--p->second == 0) {
+	  in_flight.erase(p);
+	  cache_invalid.erase(i.first);
+	}
+      }
     }
     void clear() {
-      pipeline_state = CACHE_VALID;
+      in_flight.clear();
+      cache_invalid.clear();
     }
+    /**
+     * The oldest write in waiting_state that may leave it now, or null.
+     * A write may only pass older ones still waiting if it touches none
+     * of their objects, and an rmw has to wait while the cache is invalid
+     * for one of its objects.
+     */
+    Op *next_ready(op_list &waiting_state) const;
     friend ostream &operator<<(ostream &lhs, const pipeline_state_t &rhs);
   } pipeline_state;
 
-
   op_list waiting_state;        /// writes waiting on pipe_state
-  op_list waiting_reads;        /// writes waiting on partial stripe reads
+  op_list waiting_reads;        /// writes waiting on partial stripe reads, by tid
   op_list waiting_commit;       /// writes waiting on initial commit
   eversion_t completed_to;
   eversion_t committed_to;
   void start_rmw(Op *op, PGTransactionUPtr &&t);
   bool try_state_to_reads();
   bool try_reads_to_commit();
+  bool try_parity_delta(Op &op);
+  void start_remote_read(Op *op);
+  void start_parity_delta_read(Op *op);
+  friend struct FinishParityDeltaRead;
+  void handle_parity_delta_read(
+    Op *op,
+    const hobject_t &hoid,
+    read_result_t &res);
   bool try_finish_rmw();
   void check_ops();
 
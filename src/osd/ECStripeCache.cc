@@ -0,0 +1,228 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "ECStripeCache.h"
+#include "common/debug.h"
+#include "common/perf_counters.h"
+#include "osd_perf_counters.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_osd
+#undef dout_prefix
+#define dout_prefix *_dout << "ECStripeCache "
+
+using std::make_pair;
+
+using ceph::bufferlist;
+
+struct ECStripeCache::MemCache : public PriorityCache::PriCache {
+  ECStripeCache *cache;
+  int64_t cache_bytes[PriorityCache::Priority::LAST+1] = {0};
+  int64_t committed_bytes = 0;
+
+  explicit MemCache(ECStripeCache *c) : cache(c) {}
+
+  int64_t request_cache_bytes(
+    PriorityCache::Priority pri, uint64_t total_cache) const override {
+    // recently written stripes are all equally hot.  Ask for the whole
+    // configured budget rather than what is cached now: the cache can
+    // only grow into what it was assigned, so asking for its current
+    // size would keep it from ever growing back once shrunk.
+    if (pri != PriorityCache::Priority::PRI1)
+      return -EOPNOTSUPP;
+    int64_t assigned = get_cache_bytes(pri);
+    int64_t request = cache->cct->_conf->osd_ec_stripe_cache_size;
+    return (request > assigned) ? request - assigned : 0;
+  }
+  int64_t get_cache_bytes(PriorityCache::Priority pri) const override {
+    return cache_bytes[pri];
+  }
+  int64_t get_cache_bytes() const override {
+    int64_t total = 0;
+    for (int i = 0; i < PriorityCache::Priority::LAST + 1; i++) {
+      total += cache_bytes[i];
+    }
+    return total;
+  }
+  void set_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] = bytes;
+  }
+  void add_cache_bytes(PriorityCache::Priority pri, int64_t bytes) override {
+    cache_bytes[pri] += bytes;
+  }
+  int64_t commit_cache_size(uint64_t total_cache) override {
+    committed_bytes = PriorityCache::get_chunk(
+      get_cache_bytes(), total_cache);
+    std::lock_guard l(cache->lock);
+    cache->tuned_bytes = committed_bytes;
+    cache->_trim();
+    return committed_bytes;
+  }
+  int64_t get_committed_size() const override {
+    return committed_bytes;
+  }
+  double get_cache_ratio() const override {
+    return cache->cct->_conf->osd_ec_stripe_cache_ratio;
+  }
+  void set_cache_ratio(double ratio) override {
+  }
+  std::string get_cache_name() const override {
+    return "EC Stripe Cache";
+  }
+  void shift_bins() override {
+  }
+  void import_bins(const std::vector<uint64_t> &bins) override {
+  }
+  void set_bins(PriorityCache::Priority pri, uint64_t end_bin) override {
+  }
+  uint64_t get_bins(PriorityCache::Priority pri) const override {
+    return 0;
+  }
+};
+
+ECStripeCache::ECStripeCache(CephContext *cct)
+  : cct(cct),
+    pricache(std::make_shared<MemCache>(this))
+{
+}
+
+ECStripeCache::~ECStripeCache()
+{
+  clear();
+}
+
+uint64_t ECStripeCache::_get_max_bytes() const
+{
+  uint64_t max = cct->_conf->osd_ec_stripe_cache_size;
+  if (tuned_bytes && *tuned_bytes < max)
+    max = *tuned_bytes;
+  return max;
+}
+
+void ECStripeCache::_erase(
+  std::map<std::pair<pg_t, hobject_t>, object_entry>::iterator i)
+{
+  ceph_assert(bytes >= i->second.bytes);
+  bytes -= i->second.bytes;
+  lru.erase(lru.iterator_to(i->second));
+  objects.erase(i);
+}
+
+void ECStripeCache::_trim()
+{
+  uint64_t max = _get_max_bytes();
+  while (bytes > max && !lru.empty()) {
+    auto &victim = lru.back();
+    dout(20) << __func__ << " evicting " << victim.key.second
+	     << " " << victim.bytes << " bytes" << dendl;
+    _erase(objects.find(victim.key));
+  }
+  _update_logger();
+}
+
+void ECStripeCache::_update_logger()
+{
+  if (logger)
+    logger->set(l_osd_ec_stripe_cache_bytes, bytes);
+}
+
+void ECStripeCache::put(
+  const pg_t &pgid,
+  const hobject_t &hoid,
+  const extent_map &stripes)
+{
+  if (stripes.empty())
+    return;
+  std::lock_guard l(lock);
+  if (_get_max_bytes() == 0)
+    return;
+  auto key = make_pair(pgid, hoid);
+  auto [i, inserted] = objects.try_emplace(key);
+  auto &entry = i->second;
+  if (inserted) {
+    entry.key = key;
+  } else {
+    lru.erase(lru.iterator_to(entry));
+  }
+  lru.push_front(entry);
+
+  for (auto &&extent: stripes) {
+    // copy out of whatever message or transaction buffer the data
+    // lives in, we don't want to pin those for the life of the entry
+    bufferlist bl = extent.get_val();
+    bl.rebuild();
+    entry.extents.insert(extent.get_off(), extent.get_len(), std::move(bl));
+  }
+  bytes -= entry.bytes;
+  entry.bytes = entry.extents.get_interval_set().size();
+  bytes += entry.bytes;
+  _trim();
+}
+
+extent_map ECStripeCache::get(
+  const pg_t &pgid,
+  const hobject_t &hoid,
+  const extent_set &want)
+{
+  extent_map ret;
+  uint64_t hit = 0;
+  {
+    std::lock_guard l(lock);
+    auto i = objects.find(make_pair(pgid, hoid));
+    if (i != objects.end()) {
+      for (auto &&extent: want) {
+	ret.insert(i->second.extents.intersect(extent.first, extent.second));
+      }
+      hit = ret.get_interval_set().size();
+      if (hit) {
+	lru.erase(lru.iterator_to(i->second));
+	lru.push_front(i->second);
+      }
+    }
+  }
+  dout(20) << __func__ << " " << hoid << " want " << want
+	   << " hit " << hit << " bytes" << dendl;
+  if (logger) {
+    logger->inc(l_osd_ec_stripe_cache_hit, hit);
+    logger->inc(l_osd_ec_stripe_cache_total, want.size());
+  }
+  return ret;
+}
+
+void ECStripeCache::invalidate(const pg_t &pgid, const hobject_t &hoid)
+{
+  std::lock_guard l(lock);
+  auto i = objects.find(make_pair(pgid, hoid));
+  if (i != objects.end()) {
+    _erase(i);
+    _update_logger();
+  }
+}
+
+void ECStripeCache::clear_pg(const pg_t &pgid)
+{
+  std::lock_guard l(lock);
+  auto i = objects.lower_bound(make_pair(pgid, hobject_t()));
+  while (i != objects.end() && i->first.first == pgid) {
+    _erase(i++);
+  }
+  _update_logger();
+}
+
+void ECStripeCache::clear()
+{
+  std::lock_guard l(lock);
+  lru.clear();
+  objects.clear();
+  bytes = 0;
+  _update_logger();
+}
@@ -0,0 +1,117 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef EC_STRIPE_CACHE_H
+#define EC_STRIPE_CACHE_H
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <boost/intrusive/list.hpp>
+
+#include "common/ceph_mutex.h"
+#include "common/PriorityCache.h"
+#include "common/hobject.h"
+#include "osd/osd_types.h"
+#include "ExtentCache.h"
+
+class PerfCounters;
+
+/**
+   ECStripeCache
+
+   ExtentCache only holds on to the stripes of in flight writes, so a
+   series of small writes to an EC object each read the same partial
+   stripe back from the shards as soon as the previous one completed
+   (sequential small appends being the common case).  This keeps the
+   logical content of recently written stripes around, shared by all
+   the PGs of the OSD, so that the rmw read can be skipped.
+
+   Entries are only ever filled from the primary's write path, which
+   sees every change to an object's data within an interval: writes
+   that change the object in ways we don't track (truncate, delete,
+   clone, parity delta) drop it, and ECBackend::on_change drops the
+   whole PG.  Objects are evicted LRU once the cache is over budget.
+
+   The budget is osd_ec_stripe_cache_size, or less if the object
+   store's memory autotuner (see ObjectStore::add_priority_cache)
+   assigns less; get_pricache() is the PriorityCache::PriCache for it.
+ */
+class ECStripeCache {
+  struct object_entry {
+    boost::intrusive::list_member_hook<> lru_item;
+    std::pair<pg_t, hobject_t> key;
+    extent_map extents;
+    uint64_t bytes = 0;
+  };
+  using lru_list = boost::intrusive::list<
+    object_entry,
+    boost::intrusive::member_hook<
+      object_entry,
+      boost::intrusive::list_member_hook<>,
+      &object_entry::lru_item>>;
+
+  CephContext *cct;
+  PerfCounters *logger = nullptr;
+
+  mutable ceph::mutex lock = ceph::make_mutex("ECStripeCache::lock");
+  std::map<std::pair<pg_t, hobject_t>, object_entry> objects;
+  lru_list lru;
+  uint64_t bytes = 0;
+  /// set by the memory autotuner, unset if not autotuned
+  std::optional<uint64_t> tuned_bytes;
+
+  uint64_t _get_max_bytes() const;
+  void _erase(std::map<std::pair<pg_t, hobject_t>, object_entry>::iterator i);
+  void _trim();
+  void _update_logger();
+
+  struct MemCache;
+  std::shared_ptr<PriorityCache::PriCache> pricache;
+
+public:
+  explicit ECStripeCache(CephContext *cct);
+  ~ECStripeCache();
+
+  void set_logger(PerfCounters *l) {
+    logger = l;
+  }
+  std::shared_ptr<PriorityCache::PriCache> get_pricache() {
+    return pricache;
+  }
+  uint64_t get_bytes() const {
+    std::lock_guard l(lock);
+    return bytes;
+  }
+
+  /// remember the current content of stripes of hoid, stripe aligned
+  void put(const pg_t &pgid, const hobject_t &hoid, const extent_map &stripes);
+
+  /**
+   * Look up the stripes in want, returning what's cached.  want is
+   * expected to be stripe aligned, so a hit is always whole stripes.
+   */
+  extent_map get(
+    const pg_t &pgid,
+    const hobject_t &hoid,
+    const extent_set &want);
+
+  /// forget everything about hoid
+  void invalidate(const pg_t &pgid, const hobject_t &hoid);
+
+  /// forget every object of pgid
+  void clear_pg(const pg_t &pgid);
+
+  void clear();
+};
+
+#endif
@@ -93,6 +93,160 @@ void encode_and_write(
   }
 }
 
+void write_parity_delta(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const ECTransaction::WritePlan::ParityDelta &delta,
+  const extent_map &to_write,
+  const map<int, extent_map> &old_chunks,
+  uint32_t flags,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const int k = ecimpl->get_data_chunk_count();
+
+  auto get_old_chunk = [&](int shard, uint64_t chunk_off) {
+    auto iter = old_chunks.find(shard);
+    ceph_assert(iter != old_chunks.end());
+    auto old = iter->second.intersect(chunk_off, chunk_size);
+    ceph_assert(old.ext_count() == 1);
+    ceph_assert(old.begin().get_off() == chunk_off);
+    ceph_assert(old.begin().get_len() == chunk_size);
+    return old.begin().get_val();
+  };
+
+  for (auto &&extent: delta.stripes) {
+    for (uint64_t stripe = extent.first;
+	 stripe < extent.first + extent.second;
+	 stripe += stripe_width) {
+      const uint64_t chunk_off =
+	sinfo.aligned_logical_offset_to_chunk_offset(stripe);
+      map<int, bufferlist> new_data;
+      map<int, bufferlist> deltas;
+      map<int, bufferlist> parity;
+      for (int shard: delta.shards) {
+	bufferlist old = get_old_chunk(shard, chunk_off);
+	if (shard >= k) {
+	  old.rebuild_page_aligned();
+	  parity[shard] = std::move(old);
+	  continue;
+	}
+	const uint64_t lstart = stripe + shard * chunk_size;
+	auto updates = to_write.intersect(lstart, chunk_size);
+	if (updates.empty())
+	  continue;
+	bufferlist &bl = new_data[shard];
+	uint64_t pos = lstart;
+	for (auto &&u: updates) {
+	  if (u.get_off() > pos) {
+	    bufferlist head;
+	    head.substr_of(old, pos - lstart, u.get_off() - pos);
+	    bl.claim_append(head);
+	  }
+	  bl.append(u.get_val());
+	  pos = u.get_off() + u.get_len();
+	}
+	if (pos < lstart + chunk_size) {
+	  bufferlist tail;
+	  tail.substr_of(old, pos - lstart, lstart + chunk_size - pos);
+	  bl.claim_append(tail);
+	}
+	int r = ecimpl->encode_delta(old, bl, &deltas[shard]);
+	ceph_assert(r == 0);
+      }
+      ceph_assert(!deltas.empty());
+      int r = ecimpl->apply_delta(deltas, &parity);
+      ceph_assert(r == 0);
+
+      ldpp_dout(dpp, 20) << __func__ << ": " << oid
+			 << " stripe " << stripe
+			 << " updating " << deltas.size()
+			 << " data shards"
+			 << dendl;
+      new_data.insert(parity.begin(), parity.end());
+      for (auto &&[shard, bl]: new_data) {
+	auto st = transactions->find(shard_id_t(shard));
+	if (st == transactions->end())
+	  continue;
+	st->second.write(
+	  coll_t(spg_t(pgid, st->first)),
+	  ghobject_t(oid, ghobject_t::NO_GEN, st->first),
+	  chunk_off,
+	  bl.length(),
+	  bl,
+	  flags);
+      }
+    }
+  }
+}
+
+bool ECTransaction::plan_parity_delta(
+  const ECUtil::stripe_info_t &sinfo,
+  const ErasureCodeInterfaceRef &ecimpl,
+  WritePlan &plan,
+  DoutPrefixProvider *dpp)
+{
+  ceph_assert(plan.t);
+  if (plan.hash_infos.size() != 1 ||
+      plan.to_read.size() != 1 ||
+      plan.invalidates_cache)
+    return false;
+  const hobject_t &oid = plan.to_read.begin()->first;
+  const extent_set &stripes = plan.to_read.begin()->second;
+  // stripes overwritten in full are cheaper to just encode
+  if (plan.will_write[oid] != stripes)
+    return false;
+
+  auto opiter = plan.t->op_map.find(oid);
+  if (opiter == plan.t->op_map.end())
+    return false;
+  auto &op = opiter->second;
+  if (!op.is_none() ||
+      op.deletes_first() ||
+      op.truncate ||
+      op.has_source() ||
+      op.buffer_updates.empty())
+    return false;
+
+  const uint64_t size =
+    plan.hash_infos.begin()->second->get_total_logical_size(sinfo);
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  set<int> shards;
+  for (auto &&extent: op.buffer_updates) {
+    const uint64_t end = extent.get_off() + extent.get_len();
+    if (end > size)
+      return false;
+    for (uint64_t off = extent.get_off(); off < end;
+	 off = (off / chunk_size + 1) * chunk_size) {
+      shards.insert((off % stripe_width) / chunk_size);
+    }
+  }
+
+  const uint64_t k = ecimpl->get_data_chunk_count();
+  const uint64_t m = ecimpl->get_chunk_count() - k;
+  const uint64_t nstripes = stripes.size() / stripe_width;
+  const uint64_t full_cost = nstripes * (k + k + m);
+  const uint64_t delta_cost = nstripes * 2 * (shards.size() + m);
+  ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		     << " data shards " << shards
+		     << " delta cost " << delta_cost
+		     << " full cost " << full_cost
+		     << dendl;
+  if (delta_cost >= full_cost)
+    return false;
+
+  for (uint64_t i = k; i < k + m; ++i)
+    shards.insert(i);
+  auto &delta = plan.parity_deltas[oid];
+  delta.stripes = stripes;
+  delta.shards = std::move(shards);
+  return true;
+}
+
 bool ECTransaction::requires_overwrite(
   uint64_t prev_size,
   const PGTransaction::ObjectOperation &op) {
@@ -112,6 +266,7 @@ void ECTransaction::generate_transactions(
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,map<int,extent_map>> &shard_extents,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -558,6 +713,55 @@ void ECTransaction::generate_transactions(
       ldpp_dout(dpp, 20) << __func__ << ": to_overwrite: "
 			 << to_overwrite
 			 << dendl;
+      auto pditer = plan.parity_deltas.find(oid);
+      if (pditer != plan.parity_deltas.end()) {
+	auto shiter = shard_extents.find(oid);
+	ceph_assert(shiter != shard_extents.end());
+	ceph_assert(to_write.get_interval_set().subset_of(
+		      pditer->second.stripes));
+	/* Rollback works on all shards, so the extents are still
+	 * saved everywhere even though only some of them are written. */
+	if (entry) {
+	  for (auto &&extent: pditer->second.stripes) {
+	    uint64_t restore_from = sinfo.aligned_logical_offset_to_chunk_offset(
+	      extent.first);
+	    uint64_t restore_len = sinfo.aligned_logical_offset_to_chunk_offset(
+	      extent.second);
+	    ldpp_dout(dpp, 20) << __func__ << ": parity delta overwriting "
+			       << restore_from << "~" << restore_len
+			       << dendl;
+	    if (rollback_extents.empty()) {
+	      for (auto &&st : *transactions) {
+		st.second.touch(
+		  coll_t(spg_t(pgid, st.first)),
+		  ghobject_t(oid, entry->version.version, st.first));
+	      }
+	    }
+	    rollback_extents.emplace_back(make_pair(restore_from, restore_len));
+	    for (auto &&st : *transactions) {
+	      st.second.clone_range(
+		coll_t(spg_t(pgid, st.first)),
+		ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+		ghobject_t(oid, entry->version.version, st.first),
+		restore_from,
+		restore_len,
+		restore_from);
+	    }
+	  }
+	}
+	write_parity_delta(
+	  pgid,
+	  oid,
+	  sinfo,
+	  ecimpl,
+	  pditer->second,
+	  to_write,
+	  shiter->second,
+	  fadvise_flags,
+	  transactions,
+	  dpp);
+	to_overwrite.clear();
+      }
       for (auto &&extent: to_overwrite) {
 	ceph_assert(extent.get_off() + extent.get_len() <= append_after);
 	ceph_assert(sinfo.logical_offset_is_stripe_aligned(extent.get_off()));
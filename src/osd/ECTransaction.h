@@ -30,6 +30,16 @@ namespace ECTransaction {
     std::map<hobject_t,extent_set> will_write; // superset of to_read
 
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /* Objects whose partial stripe overwrite updates the parity from
+     * the change to the data chunks instead of encoding the stripes
+     * again (see plan_parity_delta).  Only shards are read for those,
+     * not the logical to_read extents. */
+    struct ParityDelta {
+      extent_set stripes;    // logical, same as to_read
+      std::set<int> shards;  // modified data chunks + all parity chunks
+    };
+    std::map<hobject_t,ParityDelta> parity_deltas;
   };
 
   bool requires_overwrite(
@@ -182,12 +192,27 @@ namespace ECTransaction {
     return plan;
   }
 
+  /**
+   * Switch plan's partial stripe overwrite to a parity delta update if
+   * that's eligible and moves fewer chunks: reading and writing the d
+   * modified data chunks plus the m parity chunks of each stripe rather
+   * than reading k chunks and writing k+m.  Only plain overwrites of a
+   * single object within its current size qualify.  Returns true if
+   * plan.parity_deltas was filled in.
+   */
+  bool plan_parity_delta(
+    const ECUtil::stripe_info_t &sinfo,
+    const ceph::ErasureCodeInterfaceRef &ecimpl,
+    WritePlan &plan,
+    DoutPrefixProvider *dpp);
+
   void generate_transactions(
     WritePlan &plan,
     ceph::ErasureCodeInterfaceRef &ecimpl,
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const std::map<hobject_t,extent_map> &partial_extents,
+    const std::map<hobject_t,std::map<int,extent_map>> &shard_extents,
     std::vector<pg_log_entry_t> &entries,
     std::map<hobject_t,extent_map> *written,
     std::map<shard_id_t, ObjectStore::Transaction> *transactions,
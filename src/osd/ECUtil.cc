@@ -120,6 +120,80 @@ int ECUtil::decode(
   return 0;
 }
 
+int ECUtil::decode(
+  const stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ec_impl,
+  map<int, bufferlist> &to_decode,
+  uint64_t off,
+  uint64_t len,
+  bufferlist *out) {
+  ceph_assert(to_decode.size());
+  ceph_assert(out);
+  ceph_assert(out->length() == 0);
+
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  for (auto &&i : to_decode) {
+    if (i.second.length() == 0)
+      return 0;
+  }
+
+  const vector<int> &chunk_mapping = ec_impl->get_chunk_mapping();
+  auto chunk_to_shard = [&](int c) {
+    return (int)chunk_mapping.size() > c ? chunk_mapping[c] : c;
+  };
+  set<int> chunks;
+  sinfo.offset_len_to_chunks(make_pair(off, len), &chunks);
+  if (chunks.empty())
+    return 0;
+
+  map<int, bufferlist> decoded;
+  map<int, bufferlist*> want;
+  for (auto c : chunks) {
+    int shard = chunk_to_shard(c);
+    auto p = to_decode.find(shard);
+    if (p != to_decode.end()) {
+      // have it, no need to decode
+      decoded[shard] = p->second;
+    } else {
+      want[shard] = &decoded[shard];
+    }
+  }
+  if (!want.empty()) {
+    // may be working from sub-chunks (clay), so only look at sizes
+    // after decoding
+    int r = decode(sinfo, ec_impl, to_decode, want);
+    if (r < 0)
+      return r;
+  }
+
+  uint64_t total_data_size = decoded.begin()->second.length();
+  ceph_assert(total_data_size % chunk_size == 0);
+  uint64_t logical_size =
+    sinfo.aligned_chunk_offset_to_logical_offset(total_data_size);
+  if (off >= logical_size)
+    return 0;
+  len = std::min(len, logical_size - off);
+
+  // walk the range one chunk piece at a time
+  uint64_t pos = off;
+  uint64_t end = off + len;
+  while (pos < end) {
+    uint64_t stripe = pos / stripe_width;
+    uint64_t in_stripe = pos % stripe_width;
+    int c = in_stripe / chunk_size;
+    uint64_t in_chunk = in_stripe % chunk_size;
+    uint64_t n = std::min(chunk_size - in_chunk, end - pos);
+    bufferlist &src = decoded[chunk_to_shard(c)];
+    ceph_assert(src.length() >= stripe * chunk_size + in_chunk + n);
+    bufferlist piece;
+    piece.substr_of(src, stripe * chunk_size + in_chunk, n);
+    out->claim_append(piece);
+    pos += n;
+  }
+  return 0;
+}
+
 int ECUtil::encode(
   const stripe_info_t &sinfo,
   ErasureCodeInterfaceRef &ec_impl,
@@ -136,19 +210,8 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    ceph_assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      ceph_assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
-    }
-  }
+  int r = ec_impl->encode_stripes(want, in, sinfo.get_stripe_width(), out);
+  ceph_assert(r == 0);
 
   for (map<int, bufferlist>::iterator i = out->begin();
        i != out->end();
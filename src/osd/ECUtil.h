@@ -77,6 +77,30 @@ public:
       (in.first - off) + in.second);
     return std::make_pair(off, len);
   }
+  /// data chunks (by position in the stripe, not shard) that
+  /// [off, off+len) touches
+  void offset_len_to_chunks(
+    std::pair<uint64_t, uint64_t> in, std::set<int> *chunks) const {
+    uint64_t k = stripe_width / chunk_size;
+    if (in.second == 0)
+      return;
+    if (in.second >= stripe_width) {
+      for (uint64_t i = 0; i < k; ++i)
+	chunks->insert(i);
+      return;
+    }
+    uint64_t end = in.first + in.second - 1;
+    uint64_t first = (in.first % stripe_width) / chunk_size;
+    uint64_t last = (end % stripe_width) / chunk_size;
+    if (in.first / stripe_width != end / stripe_width) {
+      // wraps into the next stripe
+      for (uint64_t i = first; i < k; ++i)
+	chunks->insert(i);
+      first = 0;
+    }
+    for (uint64_t i = first; i <= last; ++i)
+      chunks->insert(i);
+  }
 };
 
 int decode(
@@ -91,6 +115,20 @@ int decode(
   std::map<int, ceph::buffer::list> &to_decode,
   std::map<int, ceph::buffer::list*> &out);
 
+/**
+ * Reconstruct logical [off, off+len) from shard chunks that cover whole
+ * stripes starting at logical 0, decoding only the data chunks the
+ * range touches.  to_decode need not contain the other data chunks.
+ * The result is cut short if the chunks end before off+len.
+ */
+int decode(
+  const stripe_info_t &sinfo,
+  ceph::ErasureCodeInterfaceRef &ec_impl,
+  std::map<int, ceph::buffer::list> &to_decode,
+  uint64_t off,
+  uint64_t len,
+  ceph::buffer::list *out);
+
 int encode(
   const stripe_info_t &sinfo,
   ceph::ErasureCodeInterfaceRef &ec_impl,
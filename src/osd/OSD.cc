@@ -19,6 +19,7 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <thread>
 
 #include <unistd.h>
 #include <sys/stat.h>
@@ -280,6 +281,7 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
   next_notif_id(0),
   recovery_request_timer(cct, recovery_request_lock, false),
   sleep_timer(cct, sleep_lock, false),
+  ec_stripe_cache(cct),
   reserver_finisher(cct),
   local_reserver(cct, &reserver_finisher, cct->_conf->osd_max_backfills,
 		 cct->_conf->osd_min_recovery_priority),
@@ -518,6 +520,10 @@ void OSDService::shutdown()
     f->stop();
   }
 
+  // the logger goes away before we do
+  ec_stripe_cache.clear();
+  ec_stripe_cache.set_logger(nullptr);
+
   publish_map(OSDMapRef());
   next_osdmap = OSDMapRef();
 }
@@ -539,6 +545,9 @@ void OSDService::init()
 
   agent_thread.create("osd_srv_agent");
 
+  ec_stripe_cache.set_logger(logger);
+  store->add_priority_cache("ec_stripe", ec_stripe_cache.get_pricache());
+
   if (cct->_conf->osd_recovery_delay_start)
     defer_recovery(cct->_conf->osd_recovery_delay_start);
 }
@@ -2268,6 +2277,7 @@ OSD::OSD(CephContext *cct_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_sample_rate(cct->_conf->osd_op_tracker_sample_rate);
   ObjectCleanRegions::set_max_num_intervals(cct->_conf->osd_object_clean_region_max_num_intervals);
 #ifdef WITH_BLKIN
   std::stringstream ss;
@@ -3430,6 +3440,36 @@ float OSD::get_osd_recovery_sleep()
     return cct->_conf->osd_recovery_sleep_hdd;
 }
 
+float recovery_bytes_sleep(uint64_t recovered, uint64_t *scheduled,
+			   uint64_t rate, float max_sleep)
+{
+  uint64_t bytes = recovered > *scheduled ? recovered - *scheduled : 0;
+  *scheduled = recovered;
+  if (!rate) {
+    return 0;
+  }
+  return std::min((float)bytes / rate, max_sleep);
+}
+
+/*
+ * the sleep for osd_recovery_max_bytes_per_sec, if set.  recovered is the
+ * recovery_bytes counter.  called with sleep_lock held.
+ */
+std::optional<float> OSDService::get_recovery_bytes_sleep(uint64_t recovered)
+{
+  // long enough for any sane rate and recovery op size, short enough not
+  // to stall recovery for good on a bogus count
+  constexpr float max_sleep = 60;
+  auto rate = cct->_conf.get_val<Option::size_t>(
+    "osd_recovery_max_bytes_per_sec");
+  float sleep = recovery_bytes_sleep(recovered, &recovery_bytes_scheduled,
+				     rate, max_sleep);
+  if (!rate) {
+    return std::nullopt;
+  }
+  return sleep;
+}
+
 float OSD::get_osd_delete_sleep()
 {
   float osd_delete_sleep = cct->_conf.get_val<double>("osd_delete_sleep");
@@ -4949,7 +4989,8 @@ void OSD::load_pgs()
     derr << "failed to list pgs: " << cpp_strerror(-r) << dendl;
   }
 
-  int num = 0;
+  // make the pgs first, their state and log are read in parallel below
+  vector<pair<PGRef, coll_t>> pgs;
   for (vector<coll_t>::iterator it = ls.begin();
        it != ls.end();
        ++it) {
@@ -5002,20 +5043,55 @@ void OSD::load_pgs()
       recursive_remove_collection(cct, store.get(), pgid, *it);
       continue;
     }
+    pgs.emplace_back(std::move(pg), *it);
+  }
 
-    // there can be no waiters here, so we don't call _wake_pg_slot
+  // reading the logs dominates the startup of an osd with many pgs, and
+  // the pgs are independent of each other, so spread them over a few
+  // threads.  there can be no waiters here, so we don't call _wake_pg_slot
+  {
+    auto read_pg = [this, &pgs](size_t i) {
+      PGRef& pg = pgs[i].first;
+      pg->lock();
+      pg->ch = store->open_collection(pg->coll);
+      // read pg state, log
+      pg->read_state(store.get());
+      pg->unlock();
+    };
+    const size_t num_threads = std::min<size_t>(
+      pgs.size(), cct->_conf.get_val<uint64_t>("osd_load_pgs_threads"));
+    if (num_threads <= 1) {
+      for (size_t i = 0; i < pgs.size(); ++i) {
+	read_pg(i);
+      }
+    } else {
+      dout(10) << __func__ << " reading " << pgs.size() << " pgs with "
+	       << num_threads << " threads" << dendl;
+      std::atomic<size_t> next{0};
+      vector<std::thread> threads;
+      for (size_t t = 0; t < num_threads; ++t) {
+	threads.push_back(make_named_thread(
+	  "osd_load_pgs", [&read_pg, &next, &pgs] {
+	    for (size_t i = next++; i < pgs.size(); i = next++) {
+	      read_pg(i);
+	    }
+	  }));
+      }
+      for (auto& t : threads) {
+	t.join();
+      }
+    }
+  }
 
+  int num = 0;
+  for (auto& [pg, coll] : pgs) {
+    spg_t pgid = pg->get_pgid();
     pg->lock();
-    pg->ch = store->open_collection(pg->coll);
-
-    // read pg state, log
-    pg->read_state(store.get());
-
     if (pg->dne())  {
-      dout(10) << "load_pgs " << *it << " deleting dne" << dendl;
+      dout(10) << "load_pgs " << coll << " deleting dne" << dendl;
       pg->ch = nullptr;
       pg->unlock();
-      recursive_remove_collection(cct, store.get(), pgid, *it);
+      recursive_remove_collection(cct, store.get(), pgid, coll);
       continue;
     }
     {
@@ -7921,14 +7997,26 @@ void OSD::handle_osd_map(MOSDMap *m)
 
       OSDMap *o = new OSDMap;
       if (e > 1) {
-	bufferlist obl;
-        bool got = get_map_bl(e - 1, obl);
-	if (!got) {
-	  auto p = added_maps_bl.find(e - 1);
-	  ceph_assert(p != added_maps_bl.end());
-	  obl = p->second;
+	// share what the incremental leaves alone with the previous epoch
+	// if we have it at hand, rather than decoding it all over again
+	OSDMapRef prev;
+	if (auto p = added_maps.find(e - 1); p != added_maps.end()) {
+	  prev = p->second;
+	} else {
+	  prev = service.lookup_cached_map(e - 1);
+	}
+	if (prev) {
+	  o->cow_copy_from(*prev);
+	} else {
+	  bufferlist obl;
+	  bool got = get_map_bl(e - 1, obl);
+	  if (!got) {
+	    auto p = added_maps_bl.find(e - 1);
+	    ceph_assert(p != added_maps_bl.end());
+	    obl = p->second;
+	  }
+	  o->decode(obl);
 	}
-	o->decode(obl);
       }
 
       OSDMap::Incremental inc;
@@ -8481,6 +8569,9 @@ bool OSD::advance_pg(
 
   unsigned old_pg_num = lastmap->have_pg_pool(pg->pg_id.pool()) ?
     lastmap->get_pg_num(pg->pg_id.pool()) : 0;
+  const bool skip_idle_maps =
+    cct->_conf.get_val<bool>("osd_pg_skip_idle_maps");
+  unsigned skipped = 0;
   for (epoch_t next_epoch = pg->get_osdmap_epoch() + 1;
        next_epoch <= osd_epoch;
        ++next_epoch) {
@@ -8615,6 +8706,14 @@ bool OSD::advance_pg(
       pg->pg_id.pgid,
       &newup, &up_primary,
       &newacting, &acting_primary);
+    if (skip_idle_maps && next_epoch < osd_epoch &&
+	pg->can_skip_map(nextmap, lastmap, newup, up_primary,
+			 newacting, acting_primary)) {
+      // stay on lastmap, the next map gets compared against it instead
+      ++skipped;
+      handle.reset_tp_timeout();
+      continue;
+    }
     pg->handle_advance_map(
       nextmap, lastmap, newup, up_primary,
       newacting, acting_primary, rctx);
@@ -8661,6 +8760,10 @@ bool OSD::advance_pg(
     old_pg_num = new_pg_num;
     handle.reset_tp_timeout();
   }
+  if (skipped) {
+    dout(10) << __func__ << " " << pg->pg_id << " skipped " << skipped
+	     << " maps that changed nothing for it" << dendl;
+  }
   pg->handle_activate_map(rctx);
 
   ret = true;
@@ -9268,12 +9371,24 @@ void OSD::do_recovery(
    * ops are scheduled after osd_recovery_sleep amount of time from the previous
    * recovery event's schedule time. This is done by adding a
    * recovery_requeue_callback event, which re-queues the recovery op using
-   * queue_recovery_after_sleep.
+   * queue_recovery_after_sleep.  With osd_recovery_max_bytes_per_sec the
+   * sleep is at least as long as the bytes recovered meanwhile take at that
+   * rate.
    */
   float recovery_sleep = get_osd_recovery_sleep();
   {
     std::lock_guard l(service.sleep_lock);
-    if (recovery_sleep > 0 && service.recovery_needs_sleep) {
+    bool pace_bytes = false;
+    if (service.recovery_needs_sleep) {
+      if (auto bytes_sleep = service.get_recovery_bytes_sleep(
+	    logger->get(l_osd_rbytes)); bytes_sleep) {
+	// go through the timer even without a sleep, so that this op waits
+	// for the ones scheduled before it
+	pace_bytes = true;
+	recovery_sleep = std::max(recovery_sleep, *bytes_sleep);
+      }
+    }
+    if ((recovery_sleep > 0 || pace_bytes) && service.recovery_needs_sleep) {
       PGRef pgref(pg);
       auto recovery_requeue_callback = new LambdaContext([this, pgref, queued, reserved_pushes](int r) {
         dout(20) << "do_recovery wake up at "
@@ -9571,6 +9686,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_slow_op_size",
     "osd_op_history_slow_op_threshold",
     "osd_enable_op_tracker",
+    "osd_op_tracker_sample_rate",
     "osd_map_cache_size",
     "osd_pg_epoch_max_lag_factor",
     "osd_pg_epoch_persisted_max_stale",
@@ -9665,6 +9781,9 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                       cct->_conf->osd_op_history_slow_op_threshold);
   }
+  if (changed.count("osd_op_tracker_sample_rate")) {
+    op_tracker.set_sample_rate(cct->_conf->osd_op_tracker_sample_rate);
+  }
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
@@ -9845,6 +9964,7 @@ bool OSD::maybe_override_options_for_qos()
 
     // Disable recovery sleep
     cct->_conf.set_val("osd_recovery_sleep", std::to_string(0));
+    cct->_conf.set_val("osd_recovery_max_bytes_per_sec", std::to_string(0));
     cct->_conf.set_val("osd_recovery_sleep_hdd", std::to_string(0));
     cct->_conf.set_val("osd_recovery_sleep_ssd", std::to_string(0));
     cct->_conf.set_val("osd_recovery_sleep_hybrid", std::to_string(0));
@@ -10458,10 +10578,41 @@ void OSD::ShardedOpWQ::_add_slot_waiter(
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq(" << shard_index << ") "
 
+unsigned OSD::ShardedOpWQ::_threads_per_shard() const
+{
+  return std::max<unsigned>(1, osd->get_num_op_threads() / osd->num_shards);
+}
+
+OSDShard* OSD::ShardedOpWQ::_pick_shard_to_help(uint32_t shard_index)
+{
+  const unsigned threads_per_shard = _threads_per_shard();
+  for (uint32_t i = 1; i < osd->num_shards; i++) {
+    OSDShard *sdata = osd->shards[(shard_index + i) % osd->num_shards];
+    if (sdata->busy_threads < threads_per_shard) {
+      // its own threads will get to it
+      continue;
+    }
+    // one helper per shard, more would mostly queue up on its pg locks
+    if (sdata->thieves.fetch_add(1) > 0) {
+      --sdata->thieves;
+      continue;
+    }
+    if (sdata->shard_lock.try_lock()) {
+      bool has_work = !sdata->scheduler->empty();
+      sdata->shard_lock.unlock();
+      if (has_work) {
+	return sdata;
+      }
+    }
+    --sdata->thieves;
+  }
+  return nullptr;
+}
+
 void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
 {
   uint32_t shard_index = thread_index % osd->num_shards;
-  auto& sdata = osd->shards[shard_index];
+  OSDShard *sdata = osd->shards[shard_index];
   ceph_assert(sdata);
 
   // If all threads of shards do oncommits, there is a out-of-order
@@ -10472,7 +10623,33 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
 
   // peek at spg_t
   sdata->shard_lock.lock();
+  // Nothing to do here, help a shard whose threads are all busy.  This
+  // is safe for any item: like those of a shard with several threads,
+  // the items of a pg still go through its slot in order.
+  bool work_stealing = false;
+  bool stolen = false;
   if (sdata->scheduler->empty() &&
+      (!is_smallest_thread_index || sdata->context_queue.empty()) &&
+      osd->num_shards > 1 &&
+      osd->cct->_conf.get_val<bool>("osd_op_shard_work_stealing")) {
+    work_stealing = true;
+    sdata->shard_lock.unlock();
+    if (OSDShard *busy = _pick_shard_to_help(shard_index); busy) {
+      dout(20) << __func__ << " helping shard " << busy->shard_id << dendl;
+      sdata = busy;
+      stolen = true;
+      // our own oncommits wait for the next round
+      is_smallest_thread_index = false;
+    }
+    sdata->shard_lock.lock();
+  }
+  auto release_thief = make_scope_guard([sdata, stolen] {
+    if (stolen) {
+      --sdata->thieves;
+    }
+  });
+  if (!stolen &&
+      sdata->scheduler->empty() &&
       (!is_smallest_thread_index || sdata->context_queue.empty())) {
     std::unique_lock wait_lock{sdata->sdata_wait_lock};
     if (is_smallest_thread_index && !sdata->context_queue.empty()) {
@@ -10482,7 +10659,14 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
       dout(20) << __func__ << " empty q, waiting" << dendl;
       osd->cct->get_heartbeat_map()->clear_timeout(hb);
       sdata->shard_lock.unlock();
-      sdata->sdata_cond.wait(wait_lock);
+      if (work_stealing) {
+	// a busy shard wakes us up to help, see _wake_shard_helper()
+	++sdata->idle_threads;
+	sdata->sdata_cond.wait(wait_lock);
+	--sdata->idle_threads;
+      } else {
+	sdata->sdata_cond.wait(wait_lock);
+      }
       wait_lock.unlock();
       sdata->shard_lock.lock();
       if (sdata->scheduler->empty() &&
@@ -10535,7 +10719,7 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     // If the work item is scheduled in the future, wait until
     // the time returned in the dequeue response before retrying.
     if (auto when_ready = std::get_if<double>(&work_item)) {
-      if (is_smallest_thread_index) {
+      if (is_smallest_thread_index || stolen) {
         sdata->shard_lock.unlock();
         handle_oncommits(oncommits);
         return;
@@ -10559,6 +10743,10 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
 
   // Access the stored item
   auto item = std::move(std::get<OpSchedulerItem>(work_item));
+  ++sdata->busy_threads;
+  auto not_busy = make_scope_guard([sdata] {
+    --sdata->busy_threads;
+  });
   if (osd->is_stopping()) {
     sdata->shard_lock.unlock();
     for (auto c : oncommits) {
@@ -10775,7 +10963,26 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   delete f;
   *_dout << dendl;
 
-  qi.run(osd, sdata, pg, tp_handle);
+  const auto started = ceph::mono_clock::now();
+  {
+    // charge the store time of the op to its class in its own shard's
+    // scheduler, even when helping out another shard
+    OpStoreCost::Ref store_cost;
+    if (const auto class_id = qi.get_scheduler_class();
+	class_id != op_scheduler_class::immediate &&
+	sdata->scheduler->observes_cost()) {
+      store_cost = std::make_shared<OpStoreCost>(
+	sdata->scheduler.get(), class_id, qi.get_cost());
+    }
+    OpStoreCost::RunningGuard running(std::move(store_cost));
+    qi.run(osd, sdata, pg, tp_handle);
+  }
+  const auto elapsed = ceph::mono_clock::now() - started;
+  ++sdata->num_processed;
+  if (stolen) {
+    ++sdata->num_stolen;
+  }
+  sdata->busy_ns += std::chrono::nanoseconds(elapsed).count();
 
   {
 #ifdef WITH_LTTNG
@@ -10823,6 +11030,38 @@ void OSD::ShardedOpWQ::_enqueue(OpSchedulerItem&& item) {
       sdata->sdata_cond.notify_one();
     }
   }
+
+  if (sdata->busy_threads >= _threads_per_shard() &&
+      sdata->thieves == 0 &&
+      osd->num_shards > 1 &&
+      osd->cct->_conf.get_val<bool>("osd_op_shard_work_stealing")) {
+    _wake_shard_helper(shard_index);
+  }
+}
+
+void OSD::ShardedOpWQ::_wake_shard_helper(uint32_t shard_index)
+{
+  for (uint32_t i = 1; i < osd->num_shards; i++) {
+    OSDShard *sdata = osd->shards[(shard_index + i) % osd->num_shards];
+    if (sdata->idle_threads == 0) {
+      continue;
+    }
+    std::lock_guard l{sdata->sdata_wait_lock};
+    if (sdata->idle_threads == 0) {
+      continue;
+    }
+    dout(20) << __func__ << " waking a thread of shard " << sdata->shard_id
+	     << dendl;
+    // Its queue is empty, so the woken thread goes on to look for a shard
+    // to help in _process().  Threads waiting for a future item of mclock
+    // share the cond though; make sure one which can help wakes up.
+    if (sdata->waiting_threads) {
+      sdata->sdata_cond.notify_all();
+    } else {
+      sdata->sdata_cond.notify_one();
+    }
+    return;
+  }
 }
 
 void OSD::ShardedOpWQ::_enqueue_front(OpSchedulerItem&& item)
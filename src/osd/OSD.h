@@ -37,6 +37,7 @@
 
 #include "OpRequest.h"
 #include "Session.h"
+#include "ECStripeCache.h"
 
 #include "osd/scheduler/OpScheduler.h"
 
@@ -94,6 +95,17 @@ class MMonGetPurgedSnapsReply;
 
 class OSD;
 
+/**
+ * the time the bytes recovered since the previous recovery op was
+ * scheduled take at rate bytes/sec, capped at max_sleep.  recovered is
+ * the recovery bytes counter and *scheduled its value at the previous
+ * call, which is updated even if rate is 0 so that turning the pacing on
+ * only charges the bytes recovered from then on.  The counter going
+ * backwards (perf reset) counts as nothing recovered.
+ */
+float recovery_bytes_sleep(uint64_t recovered, uint64_t *scheduled,
+			   uint64_t rate, float max_sleep);
+
 class OSDService : public Scrub::ScrubSchedListener {
   using OpSchedulerItem = ceph::osd::scheduler::OpSchedulerItem;
 public:
@@ -474,11 +486,17 @@ public:
   // For async recovery sleep
   bool recovery_needs_sleep = true;
   ceph::real_clock::time_point recovery_schedule_time;
+  /// recovery bytes counted when recovery_schedule_time was last set
+  uint64_t recovery_bytes_scheduled = 0;
+  std::optional<float> get_recovery_bytes_sleep(uint64_t recovered);
 
   // For recovery & scrub & snap
   ceph::mutex sleep_lock = ceph::make_mutex("OSDService::sleep_lock");
   SafeTimer sleep_timer;
 
+  // -- EC stripes recently written by our primary PGs --
+  ECStripeCache ec_stripe_cache;
+
   // -- tids --
   // for ops i issue
   std::atomic<unsigned int> last_tid{0};
@@ -706,6 +724,11 @@ public:
     ceph_assert(ret);
     return ret;
   }
+  /// the map of epoch e if it is in the cache, without loading it
+  OSDMapRef lookup_cached_map(epoch_t e) {
+    std::lock_guard l(map_cache_lock);
+    return map_cache.lookup(e);
+  }
   OSDMapRef add_map(OSDMap *o) {
     std::lock_guard l(map_cache_lock);
     return _add_map(o);
@@ -993,6 +1016,9 @@ struct OSDShard {
   ceph::mutex sdata_wait_lock;
   ceph::condition_variable sdata_cond;
   int waiting_threads = 0;
+  /// threads out of work which would help a busy shard if woken, see
+  /// ShardedOpWQ::_wake_shard_helper()
+  std::atomic<unsigned> idle_threads = 0;
 
   ceph::mutex osdmap_lock;  ///< protect shard_osdmap updates vs users w/o shard_lock
   OSDMapRef shard_osdmap;
@@ -1034,6 +1060,15 @@ struct OSDShard {
 
   ContextQueue context_queue;
 
+  /// threads in the middle of an item of this shard, and how many of
+  /// them came from other shards, see ShardedOpWQ::_process()
+  std::atomic<unsigned> busy_threads = 0;
+  std::atomic<unsigned> thieves = 0;
+  /// utilisation: items run and the time spent running them
+  std::atomic<uint64_t> num_processed = 0;
+  std::atomic<uint64_t> num_stolen = 0;
+  std::atomic<uint64_t> busy_ns = 0;
+
   void _attach_pg(OSDShardPGSlot *slot, PG *pg);
   void _detach_pg(OSDShardPGSlot *slot);
 
@@ -1599,6 +1634,14 @@ protected:
       OSDShardPGSlot *slot,
       OpSchedulerItem&& qi);
 
+    unsigned _threads_per_shard() const;
+
+    /// pick a shard whose threads are all busy to help out, if any
+    OSDShard* _pick_shard_to_help(uint32_t shard_index);
+
+    /// wake an idle thread of another shard to help shard_index out
+    void _wake_shard_helper(uint32_t shard_index);
+
     /// try to do some work
     void _process(uint32_t thread_index, ceph::heartbeat_handle_d *hb) override;
 
@@ -1640,6 +1683,13 @@ protected:
 	std::scoped_lock l{sdata->shard_lock};
 	f->open_object_section(queue_name);
 	sdata->scheduler->dump(*f);
+	f->open_object_section("utilization");
+	f->dump_unsigned("busy_threads", sdata->busy_threads);
+	f->dump_unsigned("processed", sdata->num_processed);
+	f->dump_unsigned("stolen", sdata->num_stolen);
+	f->dump_unsigned("helpers", sdata->thieves);
+	f->dump_float("busy_sec", sdata->busy_ns / 1e9);
+	f->close_section();
 	f->close_section();
       }
     }
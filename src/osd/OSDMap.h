@@ -573,8 +573,12 @@ private:
   std::shared_ptr< mempool::osdmap::vector<__u32> > osd_primary_affinity; ///< 16.16 fixed point, 0x10000 = baseline
 
   // remap (post-CRUSH, pre-up)
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>> pg_upmap; ///< remap pg
-  mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>> pg_upmap_items; ///< remap osds in up set
+  using pg_upmap_t =
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<int32_t>>;
+  using pg_upmap_items_t =
+    mempool::osdmap::map<pg_t,mempool::osdmap::vector<std::pair<int32_t,int32_t>>>;
+  std::shared_ptr<pg_upmap_t> pg_upmap; ///< remap pg
+  std::shared_ptr<pg_upmap_items_t> pg_upmap_items; ///< remap osds in up set
 
   mempool::osdmap::map<int64_t,pg_pool_t> pools;
   mempool::osdmap::map<int64_t,std::string> pool_name;
@@ -640,6 +644,17 @@ private:
 
   void _calc_up_osd_features();
 
+  /// the container p points to, copied first if other maps share it
+  template <typename T>
+  static T& make_writable(std::shared_ptr<T>& p) {
+    if (p.use_count() > 1) {
+      p = std::make_shared<T>(*p);
+    }
+    return *p;
+  }
+  /// replace the containers shared with other maps before decoding over them
+  void unshare_for_decode();
+
  public:
   bool have_crc() const { return crc_defined; }
   uint32_t get_crc() const { return crc; }
@@ -664,6 +679,8 @@ private:
 	     osd_addrs(std::make_shared<addrs_s>()),
 	     pg_temp(std::make_shared<PGTempMap>()),
 	     primary_temp(std::make_shared<mempool::osdmap::map<pg_t,int32_t>>()),
+	     pg_upmap(std::make_shared<pg_upmap_t>()),
+	     pg_upmap_items(std::make_shared<pg_upmap_items_t>()),
 	     osd_uuid(std::make_shared<mempool::osdmap::vector<uuid_d>>()),
 	     cluster_snapshot_epoch(0),
 	     new_blocklist_entries(false),
@@ -695,6 +712,9 @@ public:
     if (o.osd_primary_affinity)
       osd_primary_affinity.reset(new mempool::osdmap::vector<__u32>(*o.osd_primary_affinity));
 
+    pg_upmap.reset(new pg_upmap_t(*o.pg_upmap));
+    pg_upmap_items.reset(new pg_upmap_items_t(*o.pg_upmap_items));
+
     // NOTE: this still references shared entity_addrvec_t's.
     osd_addrs.reset(new addrs_s(*o.osd_addrs));
 
@@ -702,6 +722,18 @@ public:
     // allocate a new CrushWrapper, though.
   }
 
+  /**
+   * share all of o's containers with it instead of copying them.
+   * apply_incremental() and decode() copy a shared container before
+   * changing it, so that building the next epoch out of this one costs
+   * about the size of the incremental rather than the size of the map.
+   * the copy must only be advanced with those; crush in particular is
+   * shared too, and must be replaced rather than modified.
+   */
+  void cow_copy_from(const OSDMap& o) {
+    *this = o;
+  }
+
   // map info
   const uuid_d& get_fsid() const { return fsid; }
   void set_fsid(uuid_d& f) { fsid = f; }
@@ -817,7 +849,7 @@ public:
       osd_primary_affinity.reset(
 	new mempool::osdmap::vector<__u32>(
 	  max_osd, CEPH_OSD_DEFAULT_PRIMARY_AFFINITY));
-    (*osd_primary_affinity)[o] = w;
+    make_writable(osd_primary_affinity)[o] = w;
   }
   unsigned get_primary_affinity(int o) const {
     ceph_assert(o < max_osd);
@@ -1561,8 +1593,8 @@ public:
   int get_osds_by_bucket_name(const std::string &name, std::set<int> *osds) const;
 
   bool have_pg_upmaps(pg_t pg) const {
-    return pg_upmap.count(pg) ||
-      pg_upmap_items.count(pg);
+    return pg_upmap->count(pg) ||
+      pg_upmap_items->count(pg);
   }
 
   bool check_full(const std::set<pg_shard_t> &missing_on) const {
@@ -1618,8 +1650,8 @@ public:
   int validate_crush_rules(CrushWrapper *crush, std::ostream *ss) const;
 
   void clear_temp() {
-    pg_temp->clear();
-    primary_temp->clear();
+    pg_temp = std::make_shared<PGTempMap>();
+    primary_temp = std::make_shared<mempool::osdmap::map<pg_t,int32_t>>();
   }
 
 private:
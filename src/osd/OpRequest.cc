@@ -11,6 +11,7 @@
 #include "messages/MOSDRepOp.h"
 #include "messages/MOSDRepOpReply.h"
 #include "include/ceph_assert.h"
+#include "include/intarith.h"
 #include "osd/osd_types.h"
 
 #ifdef WITH_LTTNG
@@ -120,7 +121,9 @@ void OpRequest::mark_flag_point(uint8_t flag, const char *s) {
 #ifdef WITH_LTTNG
   uint8_t old_flags = hit_flag_points;
 #endif
-  mark_event(s);
+  const utime_t now = ceph_clock_now();
+  mark_event(s, now);
+  flag_point_stamps[ctz(flag)] = now;
   hit_flag_points |= flag;
   latest_flag_point = flag;
   tracepoint(oprequest, mark_flag_point, reqid.name._type,
@@ -132,7 +135,9 @@ void OpRequest::mark_flag_point_string(uint8_t flag, const string& s) {
 #ifdef WITH_LTTNG
   uint8_t old_flags = hit_flag_points;
 #endif
-  mark_event(s);
+  const utime_t now = ceph_clock_now();
+  mark_event(s, now);
+  flag_point_stamps[ctz(flag)] = now;
   hit_flag_points |= flag;
   latest_flag_point = flag;
   tracepoint(oprequest, mark_flag_point, reqid.name._type,
@@ -64,6 +64,12 @@ private:
   uint8_t hit_flag_points;
   uint8_t latest_flag_point;
   utime_t dequeued_time;
+public:
+  static constexpr unsigned num_flag_points = 6;
+private:
+  /// when the op last reached each flag point, indexed by the bit of the
+  /// flag; kept for every op, whether the tracker samples it or not
+  std::array<utime_t, num_flag_points> flag_point_stamps;
   static const uint8_t flag_queued_for_pg=1 << 0;
   static const uint8_t flag_reached_pg =  1 << 1;
   static const uint8_t flag_delayed =     1 << 2;
@@ -168,6 +174,10 @@ public:
   utime_t get_dequeued_time() const {
     return dequeued_time;
   }
+  /// when the op reached the i-th flag point, zero if it did not
+  utime_t get_flag_point_stamp(unsigned i) const {
+    return flag_point_stamps[i];
+  }
   void set_dequeued_time(utime_t deq_time) {
     dequeued_time = deq_time;
   }
@@ -2492,6 +2492,17 @@ void PG::C_DeleteMore::complete(int r) {
   delete this;
 }
 
+int PG::get_delete_list_max(int ideal_list_max,
+			    int target_transaction_size,
+			    uint64_t batch_size)
+{
+  if (batch_size) {
+    // the option is bounded, see osd_pg_delete_batch_size
+    return std::min<uint64_t>(batch_size, std::numeric_limits<int>::max());
+  }
+  return std::min(ideal_list_max, target_transaction_size);
+}
+
 std::pair<ghobject_t, bool> PG::do_delete_work(
   ObjectStore::Transaction &t,
   ghobject_t _next)
@@ -2529,8 +2540,10 @@ std::pair<ghobject_t, bool> PG::do_delete_work(
   ghobject_t next;
 
   vector<ghobject_t> olist;
-  int max = std::min(osd->store->get_ideal_list_max(),
-		     (int)cct->_conf->osd_target_transaction_size);
+  int max = get_delete_list_max(
+    osd->store->get_ideal_list_max(),
+    cct->_conf->osd_target_transaction_size,
+    cct->_conf.get_val<uint64_t>("osd_pg_delete_batch_size"));
 
   osd->store->collection_list(
     ch,
@@ -2573,9 +2586,12 @@ std::pair<ghobject_t, bool> PG::do_delete_work(
       osd->clog->warn() << info.pgid << " found stray pgmeta-like " << oid
 			<< " during PG removal";
     }
-    int r = snap_mapper.remove_oid(oid.hobj, &_t);
-    if (r != 0 && r != -ENOENT) {
-      ceph_abort();
+    // only clones are in the snap mapper, don't look the heads up there
+    if (SnapMapper::may_be_mapped(oid.hobj)) {
+      int r = snap_mapper.remove_oid(oid.hobj, &_t);
+      if (r != 0 && r != -ENOENT) {
+	ceph_abort();
+      }
     }
     t.remove(coll, oid);
     ++num;
@@ -654,6 +654,13 @@ public:
   std::pair<ghobject_t, bool> do_delete_work(ObjectStore::Transaction &t,
     ghobject_t _next) override;
 
+  /// objects to list and remove per PG deletion transaction: batch_size
+  /// if it is set, the smaller of ideal_list_max and
+  /// target_transaction_size otherwise
+  static int get_delete_list_max(int ideal_list_max,
+				 int target_transaction_size,
+				 uint64_t batch_size);
+
   void clear_ready_to_merge() override;
   void set_not_ready_to_merge_target(pg_t pgid, pg_t src) override;
   void set_not_ready_to_merge_source(pg_t pgid) override;
@@ -678,6 +685,13 @@ public:
     std::vector<int>& newup, int up_primary,
     std::vector<int>& newacting, int acting_primary,
     PeeringCtx &rctx);
+  bool can_skip_map(
+    OSDMapRef osdmap, OSDMapRef lastmap,
+    const std::vector<int>& newup, int up_primary,
+    const std::vector<int>& newacting, int acting_primary) {
+    return recovery_state.can_skip_map(
+      osdmap, lastmap, newup, up_primary, newacting, acting_primary);
+  }
   void handle_activate_map(PeeringCtx &rctx);
   void handle_initialize(PeeringCtx &rxcx);
   void handle_query_state(ceph::Formatter *f);
@@ -36,6 +36,7 @@ struct inconsistent_obj_wrapper;
 //forward declaration
 class OSDMap;
 class PGLog;
+class ECStripeCache;
 typedef std::shared_ptr<const OSDMap> OSDMapRef;
 
  /**
@@ -289,6 +290,7 @@ typedef std::shared_ptr<const OSDMap> OSDMapRef;
      virtual entity_name_t get_cluster_msgr_name() = 0;
 
      virtual PerfCounters *get_logger() = 0;
+     virtual ECStripeCache *get_ec_stripe_cache() = 0;
 
      virtual ceph_tid_t get_tid() = 0;
 
@@ -289,6 +289,7 @@ void PGLog::proc_replica_log(
     olog.get_can_rollback_to(),
     omissing,
     0,
+    keep_divergent_regions,
     this);
 
   if (lu < oinfo.last_update) {
@@ -350,6 +351,7 @@ void PGLog::rewind_divergent_log(eversion_t newhead,
     original_crt,
     missing,
     rollbacker,
+    keep_divergent_regions,
     this);
 
   dirty_info = true;
@@ -473,6 +475,7 @@ void PGLog::merge_log(pg_info_t &oinfo, pg_log_t&& olog, pg_shard_t fromosd,
       original_crt,
       missing,
       rollbacker,
+      keep_divergent_regions,
       this);
 
     info.last_update = log.head = olog.head;
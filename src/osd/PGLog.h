@@ -21,6 +21,8 @@
 #include "include/common_fwd.h"
 #include "osd_types.h"
 #include "os/ObjectStore.h"
+#include <functional>
+#include <optional>
 #include <list>
 
 #ifdef WITH_SEASTAR
@@ -146,7 +148,14 @@ public:
    * plus some methods to manipulate it all.
    */
   struct IndexedLog : public pg_log_t {
-    mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
+    /**
+     * ptrs into log, be careful!  the key is the soid of the entry it maps
+     * to rather than a copy of it, so that the index does not hold a second
+     * copy of the name of every object in the log.
+     */
+    mutable mempool::osd_pglog::unordered_map<
+      std::reference_wrapper<const hobject_t>, pg_log_entry_t*,
+      std::hash<hobject_t>, std::equal_to<hobject_t>> objects;
     mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
     mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
     mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
@@ -194,6 +203,19 @@ public:
       return dirty_log;
     }
 
+    /// point the index of e.soid at e, keyed by e's own soid
+    void index_object(pg_log_entry_t *e) const {
+      auto [it, inserted] = objects.try_emplace(std::cref(e->soid), e);
+      if (!inserted) {
+	// the key refers to the soid of the entry being replaced, which may
+	// be trimmed before e is
+	auto node = objects.extract(it);
+	node.key() = std::cref(e->soid);
+	node.mapped() = e;
+	objects.insert(std::move(node));
+      }
+    }
+
     void reset_rollback_info_trimmed_to_riter() {
       rollback_info_trimmed_to_riter = log.rbegin();
       while (rollback_info_trimmed_to_riter != log.rend() &&
@@ -239,11 +261,14 @@ public:
       return *this;
     }
 
+    // once its rollback info is trimmed or rolled forward an entry can
+    // never be rolled back again, so do not keep that info in memory
     void trim_rollback_info_to(eversion_t to, LogEntryHandler *h) {
       advance_can_rollback_to(
 	to,
 	[&](pg_log_entry_t &entry) {
 	  h->trim(entry);
+	  entry.mark_unrollbackable();
 	});
     }
     bool roll_forward_to(eversion_t to, LogEntryHandler *h) {
@@ -251,6 +276,7 @@ public:
 	to,
 	[&](pg_log_entry_t &entry) {
 	  h->rollforward(entry);
+	  entry.mark_unrollbackable();
 	});
     }
 
@@ -472,7 +498,7 @@ public:
 	for (auto i = log.begin(); i != log.end(); ++i) {
 	  if (to_index & PGLOG_INDEXED_OBJECTS) {
 	    if (i->object_is_indexed()) {
-	      objects[i->soid] = const_cast<pg_log_entry_t*>(&(*i));
+	      index_object(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
@@ -514,9 +540,9 @@ public:
 
     void index(pg_log_entry_t& e) {
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        if (objects.count(e.soid) == 0 ||
-            objects[e.soid]->version < e.version)
-          objects[e.soid] = &e;
+        if (auto it = objects.find(e.soid);
+            it == objects.end() || it->second->version < e.version)
+          index_object(&e);
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	// divergent merge_log indexes new before unindexing old
@@ -609,7 +635,7 @@ public:
 
       // to our index
       if ((indexed_data & PGLOG_INDEXED_OBJECTS) && e.object_is_indexed()) {
-        objects[e.soid] = &(log.back());
+        index_object(&(log.back()));
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
         if (e.reqid_is_indexed()) {
@@ -662,6 +688,9 @@ protected:
   bool dirty_log;
   bool clear_divergent_priors;
   bool may_include_deletes_in_missing_dirty = false;
+  /// keep objects whose divergent writes only dirtied some regions, see
+  /// _merge_object_divergent_entries case 5
+  bool keep_divergent_regions = false;
 
   void mark_dirty_to(eversion_t to) {
     if (to > dirty_to)
@@ -712,6 +741,11 @@ public:
   bool get_may_include_deletes_in_missing_dirty() const {
     return may_include_deletes_in_missing_dirty;
   }
+  /// only once every up and acting OSD keeps them too, so that the
+  /// primary and the replicas agree on what a replica holds
+  void set_keep_divergent_regions(bool keep) {
+    keep_divergent_regions = keep;
+  }
 protected:
 
   /// DEBUG
@@ -971,7 +1005,10 @@ protected:
    * 5) We cannot rollback at least 1 of the entries.  In this case, we
    *    clear the object out of the store and add a missing entry at
    *    prior_version taking care to add a divergent_prior if
-   *    necessary.
+   *    necessary.  With keep_regions, if the entries only modified the
+   *    object in place and recorded what they modified, the object is
+   *    kept instead and only those regions are marked dirty in the missing
+   *    entry, so that recovery pushes just them.
    */
   template <typename missing_type>
   static void _merge_object_divergent_entries(
@@ -982,6 +1019,7 @@ protected:
     eversion_t olog_can_rollback_to,     ///< [in] rollback boundary of input InedexedLog
     missing_type &missing,               ///< [in,out] missing to adjust, use
     LogEntryHandler *rollbacker,         ///< [in] optional rollbacker object
+    bool keep_regions,                   ///< [in] see case 5
     const DoutPrefixProvider *dpp        ///< [in] logging provider
     ) {
     ldpp_dout(dpp, 20) << __func__ << ": merging hoid " << hoid
@@ -1167,16 +1205,45 @@ protected:
       return;
     } else {
       /// Case 5)
-      ldpp_dout(dpp, 10) << __func__ << ": hoid " << hoid << " cannot roll back, "
-			 << "removing and adding to missing" << dendl;
+      std::optional<ObjectCleanRegions> divergent_regions;
+      if (keep_regions && !object_not_in_store) {
+	// an entry which recorded no change at all is treated as one which
+	// did not track its changes
+	bool recorded = false;
+	divergent_regions.emplace();
+	for (auto &&i: entries) {
+	  if (!i.is_modify() || !i.clean_regions.object_is_exist()) {
+	    divergent_regions.reset();
+	    break;
+	  }
+	  recorded = recorded ||
+	    i.clean_regions.omap_is_dirty() ||
+	    !i.clean_regions.get_dirty_regions().empty();
+	  divergent_regions->merge(i.clean_regions);
+	}
+	if (!recorded) {
+	  divergent_regions.reset();
+	}
+      }
       if (rollbacker) {
-	if (!object_not_in_store)
+	if (!object_not_in_store && !divergent_regions)
 	  rollbacker->remove(hoid);
 	for (auto &&i: entries) {
 	  rollbacker->trim(i);
 	}
       }
-      missing.add(hoid, prior_version, eversion_t(), false);
+      if (divergent_regions) {
+	ldpp_dout(dpp, 10) << __func__ << ": hoid " << hoid << " cannot roll back, "
+			   << "adding to missing with divergent regions "
+			   << *divergent_regions << dendl;
+	pg_missing_item item(prior_version, eversion_t());
+	item.clean_regions = *divergent_regions;
+	missing.add(hoid, std::move(item));
+      } else {
+	ldpp_dout(dpp, 10) << __func__ << ": hoid " << hoid << " cannot roll back, "
+			   << "removing and adding to missing" << dendl;
+	missing.add(hoid, prior_version, eversion_t(), false);
+      }
       if (prior_version <= info.log_tail) {
 	ldpp_dout(dpp, 10) << __func__ << ": hoid " << hoid
 			   << " prior_version " << prior_version
@@ -1195,6 +1262,7 @@ protected:
     eversion_t olog_can_rollback_to,     ///< [in] rollback boundary of input IndexedLog
     missing_type &omissing,              ///< [in,out] missing to adjust, use
     LogEntryHandler *rollbacker,         ///< [in] optional rollbacker object
+    bool keep_regions,                   ///< [in] see _merge_object_divergent_entries
     const DoutPrefixProvider *dpp        ///< [in] logging provider
     ) {
     std::map<hobject_t, mempool::osd_pglog::list<pg_log_entry_t> > split;
@@ -1208,6 +1276,7 @@ protected:
 	olog_can_rollback_to,
 	omissing,
 	rollbacker,
+	keep_regions,
 	dpp);
     }
   }
@@ -1231,6 +1300,7 @@ protected:
       log.get_can_rollback_to(),
       missing,
       rollbacker,
+      keep_divergent_regions,
       this);
   }
 
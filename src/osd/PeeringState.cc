@@ -455,6 +455,37 @@ void PeeringState::advance_map(
   last_require_osd_release = osdmap->require_osd_release;
 }
 
+bool PeeringState::can_skip_map(
+  OSDMapRef osdmap, OSDMapRef lastmap,
+  const vector<int>& newup, int up_primary,
+  const vector<int>& newacting, int acting_primary)
+{
+  ceph_assert(lastmap == osdmap_ref);
+  // a stray only checks for a new interval (and the pool getting full) on
+  // an advmap, see Started::react(const AdvMap&)
+  if (is_primary() ||
+      lastmap->is_up(pg_whoami.osd) ||
+      osdmap->is_up(pg_whoami.osd)) {
+    return false;
+  }
+  if (lastmap->require_osd_release != osdmap->require_osd_release) {
+    return false;
+  }
+  // once skipped, lastmap stands in for osdmap when the next interval is
+  // closed out, so osdmap must not change what check_new_interval reads
+  if (PastIntervals::interval_inputs_changed(
+	acting, up, osdmap.get(), lastmap.get(), info.pgid.pgid)) {
+    return false;
+  }
+  return !should_restart_peering(
+    up_primary,
+    acting_primary,
+    newup,
+    newacting,
+    lastmap,
+    osdmap);
+}
+
 void PeeringState::activate_map(PeeringCtx &rctx)
 {
   psdout(10) << __func__ << dendl;
@@ -769,6 +800,10 @@ void PeeringState::on_new_interval()
   psdout(20) << __func__ << " upacting_features 0x" << std::hex
 	     << upacting_features << std::dec
 	     << " from " << acting << "+" << up << dendl;
+  // an older replica removes the object where we would only mark the
+  // divergent regions, and would have them recovered onto nothing
+  pg_log.set_keep_divergent_regions(
+    HAVE_FEATURE(upacting_features, OSD_DIVERGENT_REGIONS));
 
   psdout(20) << __func__ << " checking missing set deletes flag. missing = "
 	     << get_pg_log().get_missing() << dendl;
@@ -2065,6 +2065,21 @@ public:
     PeeringCtx &rctx        ///< [out] recovery context
     );
 
+  /**
+   * true if the pg may skip osdmap and go on to the map after it: the osd
+   * is down in both maps, so the pg is a stray, and osdmap neither starts
+   * a new interval nor changes any input of the interval check (pool, map
+   * flags, crush, stretch mode, up_from/up_thru of the up and acting sets).
+   */
+  bool can_skip_map(
+    OSDMapRef osdmap,       ///< [in] new osdmap
+    OSDMapRef lastmap,      ///< [in] prev osdmap
+    const std::vector<int>& newup, ///< [in] new up set
+    int up_primary,         ///< [in] new up primary
+    const std::vector<int>& newacting, ///< [in] new acting
+    int acting_primary      ///< [in] new acting primary
+    );
+
   /// Activates most recently updated map
   void activate_map(
     PeeringCtx &rctx        ///< [out] recovery context
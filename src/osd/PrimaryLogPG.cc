@@ -287,30 +287,78 @@ class PrimaryLogPG::C_OSD_AppliedRecoveredObjectReplica : public Context {
   }
 };
 
+class PrimaryLogPG::C_CoalescedRead : public Context {
+  PrimaryLogPG *pg;
+  coalesced_read_key_t key;
+  uint64_t id;
+  bufferlist *outbl;
+  Context *on_read;
+public:
+  C_CoalescedRead(PrimaryLogPG *pg, const coalesced_read_key_t& key,
+		  uint64_t id, bufferlist *outbl, Context *on_read)
+    : pg(pg), key(key), id(id), outbl(outbl), on_read(on_read) {}
+  ~C_CoalescedRead() override {
+    delete on_read;
+  }
+  void finish(int r) override {
+    // hand the data to the waiters before on_read gets to reshape it
+    pg->finish_coalesced_read(key, id, r, *outbl);
+    if (on_read) {
+      std::exchange(on_read, nullptr)->complete(r);
+    }
+  }
+};
+
 // OpContext
 void PrimaryLogPG::OpContext::start_async_reads(PrimaryLogPG *pg)
 {
-  inflightreads = 1;
   list<pair<boost::tuple<uint64_t, uint64_t, unsigned>,
 	    pair<bufferlist*, Context*> > > in;
   in.swap(pending_async_reads);
-  pg->pgbackend->objects_read_async(
-    obc->obs.oi.soid,
-    in,
-    new OnReadComplete(pg, this), pg->get_pool().fast_read);
+  list<pair<boost::tuple<uint64_t, uint64_t, unsigned>,
+	    pair<bufferlist*, Context*> > > to_read;
+  const auto& oi = obc->obs.oi;
+  inflightreads = 0;
+  for (auto& read : in) {
+    if (!pg->cct->_conf->osd_ec_coalesce_reads) {
+      to_read.push_back(std::move(read));
+      continue;
+    }
+    // the object context lock keeps writes out while we read, so the
+    // same extent of the same version always reads the same data
+    coalesced_read_key_t key{oi.soid, oi.version,
+			     read.first.get<0>(), read.first.get<1>(),
+			     read.first.get<2>()};
+    auto [p, inserted] = pg->in_flight_reads.try_emplace(key);
+    if (!inserted) {
+      p->second.waiters.push_back(
+	{this, read.second.first, read.second.second});
+      ++inflightreads;
+      pg->osd->logger->inc(l_osd_op_r_coalesced);
+      continue;
+    }
+    p->second.id = ++pg->last_in_flight_read;
+    to_read.push_back(
+      make_pair(read.first,
+		make_pair(read.second.first,
+			  new C_CoalescedRead(pg, key, p->second.id,
+					      read.second.first,
+					      read.second.second))));
+  }
+  if (!to_read.empty()) {
+    ++inflightreads;
+    pg->pgbackend->objects_read_async(
+      oi.soid,
+      to_read,
+      new OnReadComplete(pg, this), pg->get_pool().fast_read);
+  }
 }
 void PrimaryLogPG::OpContext::finish_read(PrimaryLogPG *pg)
 {
   ceph_assert(inflightreads > 0);
   --inflightreads;
   if (async_reads_complete()) {
-    ceph_assert(pg->in_progress_async_reads.size());
-    ceph_assert(pg->in_progress_async_reads.front().second == this);
-    pg->in_progress_async_reads.pop_front();
-
-    // Restart the op context now that all reads have been
-    // completed. Read failures will be handled by the op finisher
-    pg->execute_ctx(this);
+    pg->complete_async_reads();
   }
 }
 
@@ -1750,7 +1798,11 @@ PrimaryLogPG::PrimaryLogPG(OSDService *o, OSDMapRef curmap,
   pgbackend(
     PGBackend::build_pg_backend(
       _pool.info, ec_profile, this, coll_t(p), ch, o->store, cct)),
-  object_contexts(o->cct, o->cct->_conf->osd_pg_object_context_cache_count),
+  object_contexts(
+    o->cct,
+    o->cct->_conf->osd_pg_object_context_cache_count,
+    o->cct->_conf.get_val<uint64_t>("osd_pg_object_context_cache_max_count"),
+    o->cct->_conf.get_val<uint64_t>("osd_pg_object_context_cache_shards")),
   new_backfill(false),
   temp_seq(0),
   snap_trimmer_machine(this)
@@ -4382,6 +4434,13 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  for (unsigned i = 0; i < OpRequest::num_flag_points; ++i) {
+    const utime_t stamp = op.get_flag_point_stamp(i);
+    if (stamp != utime_t()) {
+      osd->logger->hinc(l_osd_op_flag_point_lat_hist,
+			(stamp - m->get_recv_stamp()).to_nsec(), i);
+    }
+  }
 
   if (op.may_read() && op.may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -9054,6 +9113,44 @@ void PrimaryLogPG::apply_stats(
   m_scrubber->stats_of_handled_objects(delta_stats, soid);
 }
 
+void PrimaryLogPG::complete_async_reads()
+{
+  // a coalesced read may complete ahead of the reads started before
+  // it, restart the op contexts in order so the replies keep it.
+  // Read failures will be handled by the op finisher
+  while (!in_progress_async_reads.empty() &&
+	 in_progress_async_reads.front().second->async_reads_complete()) {
+    OpContext *ctx = in_progress_async_reads.front().second;
+    in_progress_async_reads.pop_front();
+    execute_ctx(ctx);
+  }
+}
+
+void PrimaryLogPG::finish_coalesced_read(
+  const coalesced_read_key_t& key, uint64_t id,
+  int r, const bufferlist& bl)
+{
+  auto p = in_flight_reads.find(key);
+  if (p == in_flight_reads.end() || p->second.id != id) {
+    // the waiters went away with an interval change
+    return;
+  }
+  auto waiters = std::move(p->second.waiters);
+  in_flight_reads.erase(p);
+  dout(20) << __func__ << " " << std::get<0>(key) << " " << std::get<2>(key)
+	   << "~" << std::get<3>(key) << " r=" << r
+	   << " for " << waiters.size() << " waiters" << dendl;
+  for (auto& w : waiters) {
+    if (r >= 0) {
+      *w.outbl = bl;
+    }
+    if (w.on_read) {
+      std::exchange(w.on_read, nullptr)->complete(r);
+    }
+    w.ctx->finish_read(this);
+  }
+}
+
 void PrimaryLogPG::complete_read_ctx(int result, OpContext *ctx)
 {
   auto m = ctx->op->get_req<MOSDOp>();
@@ -12857,6 +12954,7 @@ void PrimaryLogPG::clear_async_reads()
              << dendl;
     close_op_ctx(i.second);
   }
+  in_flight_reads.clear();
 }
 
 void PrimaryLogPG::clear_cache()
@@ -13055,6 +13153,7 @@ void PrimaryLogPG::on_change(ObjectStore::Transaction &t)
     if (is_primary())
       requeue_op(i->first);
   }
+  in_flight_reads.clear();
 
   // this will requeue ops we were working on but didn't finish, and
   // any dups
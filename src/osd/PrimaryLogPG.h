@@ -27,7 +27,7 @@
 #include "messages/MOSDOpReply.h"
 #include "common/Checksummer.h"
 #include "common/sharedptr_registry.hpp"
-#include "common/shared_cache.hpp"
+#include "common/sharded_shared_cache.hpp"
 #include "ReplicatedBackend.h"
 #include "PGTransaction.h"
 #include "cls/cas/cls_cas_ops.h"
@@ -358,10 +358,18 @@ public:
   }
   void queue_transaction(ObjectStore::Transaction&& t,
 			 OpRequestRef op) override {
+    if (auto c = ceph::osd::scheduler::OpStoreCost::commit_timer(); c) {
+      t.register_on_commit(c);
+    }
     osd->store->queue_transaction(ch, std::move(t), op);
   }
   void queue_transactions(std::vector<ObjectStore::Transaction>& tls,
 			  OpRequestRef op) override {
+    if (!tls.empty()) {
+      if (auto c = ceph::osd::scheduler::OpStoreCost::commit_timer(); c) {
+	tls.back().register_on_commit(c);
+      }
+    }
     osd->store->queue_transactions(ch, tls, op, NULL);
   }
   epoch_t get_interval_start_epoch() const override {
@@ -585,6 +593,9 @@ public:
   }
 
   PerfCounters *get_logger() override;
+  ECStripeCache *get_ec_stripe_cache() override {
+    return &osd->ec_stripe_cache;
+  }
 
   ceph_tid_t get_tid() override { return osd->get_tid(); }
 
@@ -998,7 +1009,7 @@ protected:
   bool already_complete(eversion_t v);
 
   // projected object info
-  SharedLRU<hobject_t, ObjectContext> object_contexts;
+  ShardedSharedLRU<hobject_t, ObjectContext> object_contexts;
   // std::map from oid.snapdir() to SnapSetContext *
   std::map<hobject_t, SnapSetContext*> snapset_contexts;
   ceph::mutex snapset_contexts_lock =
@@ -1248,8 +1259,36 @@ protected:
 
   int prepare_transaction(OpContext *ctx);
   std::list<std::pair<OpRequestRef, OpContext*> > in_progress_async_reads;
+  void complete_async_reads();
   void complete_read_ctx(int result, OpContext *ctx);
 
+  // async reads of the same extent of an object version share one
+  // backend read: <soid, version, off, len, op_flags>
+  using coalesced_read_key_t =
+    std::tuple<hobject_t, eversion_t, uint64_t, uint64_t, uint32_t>;
+  struct InFlightRead {
+    struct waiter_t {
+      OpContext *ctx;
+      ceph::buffer::list *outbl;
+      Context *on_read;
+    };
+    uint64_t id = 0;
+    /// the reads waiting for the one which went to the backend
+    std::list<waiter_t> waiters;
+    InFlightRead() = default;
+    InFlightRead(const InFlightRead&) = delete;
+    ~InFlightRead() {
+      for (auto& w : waiters) {
+	delete w.on_read;
+      }
+    }
+  };
+  std::map<coalesced_read_key_t, InFlightRead> in_flight_reads;
+  uint64_t last_in_flight_read = 0;
+  class C_CoalescedRead;
+  void finish_coalesced_read(const coalesced_read_key_t& key, uint64_t id,
+			     int r, const ceph::buffer::list& bl);
+
   // pg on-disk content
   void check_local() override;
 
@@ -49,6 +49,7 @@ using ceph::bufferhash;
 using ceph::bufferlist;
 using ceph::decode;
 using ceph::encode;
+using ceph::osd::scheduler::OpStoreCost;
 
 namespace {
 class PG_SendMessageOnConn: public Context {
@@ -268,6 +269,7 @@ int ReplicatedBackend::objects_read_sync(
   uint32_t op_flags,
   bufferlist *bl)
 {
+  OpStoreCost::ReadTimer timer;
   return store->read(ch, ghobject_t(hoid), off, len, *bl, op_flags);
 }
 
@@ -278,6 +280,7 @@ int ReplicatedBackend::objects_readv_sync(
   bufferlist *bl)
 {
   interval_set<uint64_t> im(std::move(m));
+  OpStoreCost::ReadTimer timer;
   auto r = store->readv(ch, ghobject_t(hoid), im, *bl, op_flags);
   if (r >= 0) {
     m = std::move(im).detach();
@@ -654,13 +657,16 @@ int ReplicatedBackend::be_deep_scrub(
     }
 
     bufferlist bl;
-    r = store->read(
-      ch,
-      ghobject_t(
-	poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
-      pos.data_pos,
-      cct->_conf->osd_deep_scrub_stride, bl,
-      fadvise_flags);
+    {
+      OpStoreCost::ReadTimer timer;
+      r = store->read(
+	ch,
+	ghobject_t(
+	  poid, ghobject_t::NO_GEN, get_parent()->whoami_shard().shard),
+	pos.data_pos,
+	cct->_conf->osd_deep_scrub_stride, bl,
+	fadvise_flags);
+    }
     if (r < 0) {
       dout(20) << __func__ << "  " << poid << " got "
 	       << r << " on read, read_error" << dendl;
@@ -1004,11 +1010,17 @@ void ReplicatedBackend::issue_op(
   if (parent->get_acting_recovery_backfill_shards().size() > 1) {
     if (op->op) {
       op->op->pg_trace.event("issue replication ops");
-      ostringstream ss;
-      set<pg_shard_t> replicas = parent->get_acting_recovery_backfill_shards();
-      replicas.erase(parent->whoami_shard());
-      ss << "waiting for subops from " << replicas;
-      op->op->mark_sub_op_sent(ss.str());
+      if (op->op->is_sampled()) {
+	ostringstream ss;
+	set<pg_shard_t> replicas =
+	  parent->get_acting_recovery_backfill_shards();
+	replicas.erase(parent->whoami_shard());
+	ss << "waiting for subops from " << replicas;
+	op->op->mark_sub_op_sent(ss.str());
+      } else {
+	// the event is not recorded, don't bother listing the replicas
+	op->op->mark_sub_op_sent("waiting for subops");
+      }
     }
 
     // avoid doing the same work in generate_subop
@@ -2121,9 +2133,13 @@ int ReplicatedBackend::build_push_op(const ObjectRecoveryInfo &recovery_info,
 
   auto origin_size = out_op->data_included.size();
   bufferlist bit;
-  int r = store->readv(ch, ghobject_t(recovery_info.soid),
-		       out_op->data_included, bit,
-                       cache_dont_need ? CEPH_OSD_OP_FLAG_FADVISE_DONTNEED: 0);
+  int r;
+  {
+    OpStoreCost::ReadTimer timer;
+    r = store->readv(ch, ghobject_t(recovery_info.soid),
+		     out_op->data_included, bit,
+		     cache_dont_need ? CEPH_OSD_OP_FLAG_FADVISE_DONTNEED: 0);
+  }
   if (cct->_conf->osd_debug_random_push_read_error &&
         (rand() % (int)(cct->_conf->osd_debug_random_push_read_error * 100.0)) == 0) {
     dout(0) << __func__ << ": inject EIO " << recovery_info.soid << dendl;
@@ -306,6 +306,11 @@ public:
     MapCacher::Transaction<std::string, ceph::buffer::list> *t ///< [out] transaction
     ); ///@ return error, 0 on success
 
+  /// Only clones carry snaps, so a head is never mapped
+  static bool may_be_mapped(const hobject_t &oid) {
+    return oid.snap != CEPH_NOSNAP;
+  }
+
   /// Add mapping for oid, must not already be mapped
   void add_oid(
     const hobject_t &oid,       ///< [in] oid to add
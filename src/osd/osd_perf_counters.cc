@@ -17,6 +17,15 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     32,                              ///< Enough to cover much longer than slow requests
   };
 
+  // Flag point axis configuration, values are the bit of the flag
+  PerfHistogramCommon::axis_config_d op_flag_point_axis_config{
+    "Flag point",
+    PerfHistogramCommon::SCALE_LINEAR, ///< One bucket per flag point
+    0,                                 ///< Start at queued_for_pg
+    1,                                 ///< One flag point per bucket
+    8,                                 ///< Six flag points, under and overflow
+  };
+
   // Op size axis configuration for op histograms, values are in bytes
   PerfHistogramCommon::axis_config_d op_hist_y_axis_config{
     "Request size (bytes)",
@@ -55,6 +64,11 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_time_avg(
     l_osd_op_prepare_lat, "op_prepare_latency",
     "Latency of client operations (excluding queue time and wait for finished)");
+  osd_plb.add_u64_counter_histogram(
+    l_osd_op_flag_point_lat_hist, "op_flag_point_latency_histogram",
+    op_hist_x_axis_config, op_flag_point_axis_config,
+    "Histogram of the time client operations take to reach each flag point "
+    "(queued_for_pg, reached_pg, delayed, started, sub_op_sent, commit_sent)");
 
   osd_plb.add_u64_counter(
     l_osd_op_r, "op_r", "Client read operations");
@@ -73,6 +87,9 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_time_avg(
     l_osd_op_r_prepare_lat, "op_r_prepare_latency",
     "Latency of read operations (excluding queue time and wait for finished)");
+  osd_plb.add_u64_counter(
+    l_osd_op_r_coalesced, "op_r_coalesced",
+    "Client reads served by an identical read already in flight");
   osd_plb.add_u64_counter(
     l_osd_op_w, "op_w", "Client write operations");
   osd_plb.add_u64_counter(
@@ -263,6 +280,17 @@ PerfCounters *build_osd_logger(CephContext *cct) {
     l_osd_object_ctx_cache_total, "object_ctx_cache_total", "Object context cache lookups");
 
   osd_plb.add_u64_counter(l_osd_op_cache_hit, "op_cache_hit");
+  osd_plb.add_u64_counter(
+    l_osd_ec_stripe_cache_hit, "ec_stripe_cache_hit",
+    "EC partial stripe bytes found in the stripe cache", NULL, 0,
+    unit_t(UNIT_BYTES));
+  osd_plb.add_u64_counter(
+    l_osd_ec_stripe_cache_total, "ec_stripe_cache_total",
+    "EC partial stripe bytes looked up in the stripe cache", NULL, 0,
+    unit_t(UNIT_BYTES));
+  osd_plb.add_u64(
+    l_osd_ec_stripe_cache_bytes, "ec_stripe_cache_bytes",
+    "Size of the EC stripe cache", NULL, 0, unit_t(UNIT_BYTES));
   osd_plb.add_time_avg(
     l_osd_tier_flush_lat, "osd_tier_flush_lat", "Object flush latency");
   osd_plb.add_time_avg(
@@ -15,12 +15,14 @@ enum {
   l_osd_op_lat,
   l_osd_op_process_lat,
   l_osd_op_prepare_lat,
+  l_osd_op_flag_point_lat_hist,
   l_osd_op_r,
   l_osd_op_r_outb,
   l_osd_op_r_lat,
   l_osd_op_r_lat_outb_hist,
   l_osd_op_r_process_lat,
   l_osd_op_r_prepare_lat,
+  l_osd_op_r_coalesced,
   l_osd_op_w,
   l_osd_op_w_inb,
   l_osd_op_w_lat,
@@ -110,6 +112,9 @@ enum {
   l_osd_object_ctx_cache_total,
 
   l_osd_op_cache_hit,
+  l_osd_ec_stripe_cache_hit,
+  l_osd_ec_stripe_cache_total,
+  l_osd_ec_stripe_cache_bytes,
   l_osd_tier_flush_lat,
   l_osd_tier_promote_lat,
   l_osd_tier_r_lat,
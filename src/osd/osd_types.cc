@@ -4176,6 +4176,51 @@ bool PastIntervals::is_new_interval(
 		    pgid);
 }
 
+bool PastIntervals::interval_inputs_changed(
+  const vector<int> &acting,
+  const vector<int> &up,
+  const OSDMap *osdmap,
+  const OSDMap *lastmap,
+  pg_t pgid)
+{
+  const pg_pool_t *plast = lastmap->get_pg_pool(pgid.pool());
+  const pg_pool_t *pi = osdmap->get_pg_pool(pgid.pool());
+  if (!plast || !pi ||
+      plast->last_change != pi->last_change ||
+      plast->get_flags() != pi->get_flags()) {
+    return true;
+  }
+  if (lastmap->get_flags() != osdmap->get_flags() ||
+      lastmap->get_crush_version() != osdmap->get_crush_version()) {
+    return true;
+  }
+  if (lastmap->stretch_mode_enabled != osdmap->stretch_mode_enabled ||
+      lastmap->stretch_bucket_count != osdmap->stretch_bucket_count ||
+      lastmap->degraded_stretch_mode != osdmap->degraded_stretch_mode ||
+      lastmap->recovering_stretch_mode != osdmap->recovering_stretch_mode ||
+      lastmap->stretch_mode_bucket != osdmap->stretch_mode_bucket) {
+    return true;
+  }
+  for (const auto *v : {&acting, &up}) {
+    for (int osd : *v) {
+      if (osd == CRUSH_ITEM_NONE) {
+	continue;
+      }
+      if (lastmap->exists(osd) != osdmap->exists(osd)) {
+	return true;
+      }
+      if (!lastmap->exists(osd)) {
+	continue;
+      }
+      if (lastmap->get_up_from(osd) != osdmap->get_up_from(osd) ||
+	  lastmap->get_up_thru(osd) != osdmap->get_up_thru(osd)) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
 bool PastIntervals::check_new_interval(
   int old_acting_primary,
   int new_acting_primary,
@@ -3360,6 +3360,20 @@ public:
     pg_t pgid                                   ///< [in] pgid for pg
     );
 
+  /**
+   * Determines whether osdmap changes anything check_new_interval reads
+   * from lastmap when it closes out an interval: the pool, the map flags,
+   * crush, the stretch mode state, or the up_from/up_thru of a member of
+   * the up or acting set.
+   */
+  static bool interval_inputs_changed(
+    const std::vector<int> &acting,             ///< [in] acting as of lastmap
+    const std::vector<int> &up,                 ///< [in] up as of lastmap
+    const OSDMap *osdmap,  ///< [in] current map
+    const OSDMap *lastmap, ///< [in] last map
+    pg_t pgid                                   ///< [in] pgid for pg
+    );
+
   /**
    * Integrates a new map into *past_intervals, returns true
    * if an interval was closed out.
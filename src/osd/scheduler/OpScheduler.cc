@@ -56,4 +56,24 @@ std::ostream &operator<<(std::ostream &lhs, const OpScheduler &rhs) {
   return lhs;
 }
 
+thread_local OpStoreCost::Ref OpStoreCost::running;
+
+OpStoreCost::~OpStoreCost()
+{
+  if (sampled) {
+    scheduler->observe_cost(class_id, cost, ceph::timespan(nsecs.load()));
+  }
+}
+
+Context *OpStoreCost::commit_timer()
+{
+  if (!running) {
+    return nullptr;
+  }
+  return new LambdaContext(
+    [op=running, start=ceph::mono_clock::now()](int) {
+      op->add(ceph::mono_clock::now() - start);
+    });
+}
+
 }
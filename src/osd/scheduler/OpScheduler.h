@@ -14,10 +14,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <ostream>
 #include <variant>
 
 #include "common/ceph_context.h"
+#include "common/ceph_time.h"
+#include "include/Context.h"
 #include "osd/scheduler/OpSchedulerItem.h"
 
 namespace ceph::osd::scheduler {
@@ -44,6 +48,17 @@ public:
   // Return next op to be processed
   virtual WorkItem dequeue() = 0;
 
+  // Note how long a dequeued op kept the ObjectStore busy, for the
+  // schedulers which learn the cost of ops. Called without the shard
+  // lock held, possibly from an ObjectStore completion thread.
+  virtual void observe_cost(op_scheduler_class class_id, int cost,
+			    ceph::timespan elapsed) {}
+
+  // Whether observe_cost() wants samples at all
+  virtual bool observes_cost() const {
+    return false;
+  }
+
   // Dump formatted representation for the queue
   virtual void dump(ceph::Formatter &f) const = 0;
 
@@ -60,6 +75,76 @@ public:
 std::ostream &operator<<(std::ostream &lhs, const OpScheduler &);
 using OpSchedulerRef = std::unique_ptr<OpScheduler>;
 
+/**
+ * The ObjectStore time of one op, for OpScheduler::observe_cost()
+ *
+ * Adds up the synchronous reads the op does while it runs and the
+ * commit latency of the transactions it queues, which may commit after
+ * it has run, and reports the total once the last of them is done.
+ * What the op waits for besides the store, replica round trips in
+ * particular, is left out.  An op which never got to the store is not
+ * sampled.
+ */
+class OpStoreCost {
+public:
+  using Ref = std::shared_ptr<OpStoreCost>;
+
+  OpStoreCost(OpScheduler *scheduler, op_scheduler_class class_id, int cost)
+    : scheduler(scheduler), class_id(class_id), cost(cost) {}
+  ~OpStoreCost();
+
+  void add(ceph::timespan elapsed) {
+    nsecs += std::chrono::nanoseconds(elapsed).count();
+    sampled = true;
+  }
+
+  /// the sampled op the calling thread runs, if any
+  static const Ref &get_running() {
+    return running;
+  }
+
+  /// makes op the running one of the calling thread while in scope
+  class RunningGuard {
+  public:
+    explicit RunningGuard(Ref op) {
+      running = std::move(op);
+    }
+    ~RunningGuard() {
+      running.reset();
+    }
+  };
+
+  /// adds the time until it goes out of scope to the running op
+  class ReadTimer {
+    Ref op;
+    ceph::mono_time start;
+  public:
+    ReadTimer() : op(running) {
+      if (op) {
+	start = ceph::mono_clock::now();
+      }
+    }
+    ~ReadTimer() {
+      if (op) {
+	op->add(ceph::mono_clock::now() - start);
+      }
+    }
+  };
+
+  /// an on_commit context for a transaction the running op queues now,
+  /// nullptr if there is no sampled op
+  static Context *commit_timer();
+
+private:
+  static thread_local Ref running;
+
+  OpScheduler *scheduler;
+  const op_scheduler_class class_id;
+  const int cost;
+  std::atomic<uint64_t> nsecs = 0;
+  std::atomic<bool> sampled = false;
+};
+
 OpSchedulerRef make_scheduler(
   CephContext *cct, uint32_t num_shards, bool is_rotational,
   std::string_view osd_objectstore);
@@ -0,0 +1,121 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <sstream>
+
+#include "osd/scheduler/mClockCostModel.h"
+
+namespace ceph::osd::scheduler {
+
+mClockCostModel::mClockCostModel(uint64_t window, uint64_t min_samples)
+{
+  set_window(window, min_samples);
+}
+
+void mClockCostModel::set_window(uint64_t window, uint64_t _min_samples)
+{
+  std::lock_guard l{lock};
+  decay = 1.0 - 1.0 / std::max<uint64_t>(window, 1);
+  min_samples = std::max<uint64_t>(_min_samples, 1);
+}
+
+void mClockCostModel::reset()
+{
+  std::lock_guard l{lock};
+  fits.fill(fit_t{});
+}
+
+void mClockCostModel::observe(
+  op_scheduler_class class_id, uint64_t cost, double secs)
+{
+  const auto i = static_cast<size_t>(class_id);
+  if (i >= fits.size() || class_id == op_scheduler_class::immediate) {
+    return;
+  }
+  std::lock_guard l{lock};
+  auto &fit = fits[i];
+  fit.weight = fit.weight * decay + 1;
+  const double w = 1 / fit.weight;
+  const double dx = cost - fit.mean_cost;
+  const double dy = secs - fit.mean_secs;
+  fit.mean_cost += w * dx;
+  fit.mean_secs += w * dy;
+  fit.var_cost = (1 - w) * (fit.var_cost + w * dx * dx);
+  fit.cov = (1 - w) * (fit.cov + w * dx * dy);
+  ++fit.samples;
+}
+
+std::optional<mClockCostModel::estimate_t> mClockCostModel::_get_estimate(
+  const fit_t &fit, double default_per_byte) const
+{
+  if (fit.samples < min_samples) {
+    return std::nullopt;
+  }
+  estimate_t est;
+  // a variance below a byte squared means the costs were all the same
+  if (fit.var_cost > 1.0) {
+    est.per_byte = std::max(0.0, fit.cov / fit.var_cost);
+  } else {
+    est.per_byte = default_per_byte;
+  }
+  est.per_io = fit.mean_secs - est.per_byte * fit.mean_cost;
+  if (est.per_io < 0) {
+    // the line crosses zero before the smallest op, charge by the byte
+    est.per_io = 0;
+    est.per_byte = fit.mean_secs / fit.mean_cost;
+  }
+  return est;
+}
+
+std::optional<mClockCostModel::estimate_t> mClockCostModel::get_estimate(
+  op_scheduler_class class_id, double default_per_byte) const
+{
+  const auto i = static_cast<size_t>(class_id);
+  if (i >= fits.size()) {
+    return std::nullopt;
+  }
+  std::lock_guard l{lock};
+  return _get_estimate(fits[i], default_per_byte);
+}
+
+void mClockCostModel::dump(ceph::Formatter &f, double default_per_byte) const
+{
+  std::lock_guard l{lock};
+  f.dump_float("window", 1 / (1 - decay));
+  f.dump_unsigned("min_samples", min_samples);
+  f.open_array_section("classes");
+  for (size_t i = 0; i < fits.size(); ++i) {
+    const auto class_id = static_cast<op_scheduler_class>(i);
+    if (class_id == op_scheduler_class::immediate) {
+      continue;
+    }
+    const auto &fit = fits[i];
+    f.open_object_section("class");
+    std::ostringstream name;
+    name << class_id;
+    f.dump_string("class", name.str());
+    f.dump_unsigned("samples", fit.samples);
+    f.dump_float("mean_cost", fit.mean_cost);
+    f.dump_float("mean_usec", fit.mean_secs * 1000000);
+    if (auto est = _get_estimate(fit, default_per_byte); est) {
+      f.dump_bool("calibrated", true);
+      f.dump_float("cost_per_io_usec", est->per_io * 1000000);
+      f.dump_float("cost_per_byte_usec", est->per_byte * 1000000);
+    } else {
+      f.dump_bool("calibrated", false);
+    }
+    f.close_section();
+  }
+  f.close_section();
+}
+
+}
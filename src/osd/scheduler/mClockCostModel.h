@@ -0,0 +1,89 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include "common/ceph_mutex.h"
+#include "common/Formatter.h"
+#include "osd/scheduler/OpSchedulerItem.h"
+
+namespace ceph::osd::scheduler {
+
+/**
+ * Learns the cost of the ops of each scheduler class from their store time
+ *
+ * The seconds an op keeps the ObjectStore busy (see OpStoreCost) are
+ * fitted to
+ * per_io + per_byte * cost by least squares, weighting the samples
+ * down exponentially with their age so that the estimate follows the
+ * device as its behaviour changes (garbage collection, a different mix
+ * of reads and writes, ...).  window is the number of samples the fit
+ * effectively remembers, and a class needs min_samples of them before
+ * it gets an estimate.
+ */
+class mClockCostModel {
+public:
+  struct estimate_t {
+    double per_io;   ///< seconds
+    double per_byte; ///< seconds
+    double predict(uint64_t cost) const {
+      return per_io + per_byte * cost;
+    }
+  };
+
+  mClockCostModel(uint64_t window, uint64_t min_samples);
+
+  void set_window(uint64_t window, uint64_t min_samples);
+
+  /// forget all samples
+  void reset();
+
+  /// an op of class_id with the given cost ran for secs
+  void observe(op_scheduler_class class_id, uint64_t cost, double secs);
+
+  /**
+   * the learned cost of the ops of class_id, if it has seen enough of
+   * them; if all of them had the same cost the fit cannot tell the per
+   * io cost from the per byte one, default_per_byte is used for the
+   * latter then.
+   */
+  std::optional<estimate_t> get_estimate(op_scheduler_class class_id,
+					 double default_per_byte) const;
+
+  void dump(ceph::Formatter &f, double default_per_byte) const;
+
+private:
+  /// exponentially weighted means and (co)variances of cost and seconds
+  struct fit_t {
+    uint64_t samples = 0;
+    double weight = 0;
+    double mean_cost = 0;
+    double mean_secs = 0;
+    double var_cost = 0;
+    double cov = 0;
+  };
+
+  std::optional<estimate_t> _get_estimate(const fit_t &fit,
+					  double default_per_byte) const;
+
+  mutable ceph::mutex lock = ceph::make_mutex("mClockCostModel::lock");
+  std::array<
+    fit_t,
+    static_cast<size_t>(op_scheduler_class::client) + 1> fits;
+  double decay;
+  uint64_t min_samples;
+};
+
+}
@@ -36,6 +36,9 @@ mClockScheduler::mClockScheduler(CephContext *cct,
   : cct(cct),
     num_shards(num_shards),
     is_rotational(is_rotational),
+    cost_model(
+      cct->_conf.get_val<uint64_t>("osd_mclock_cost_calibration_window"),
+      cct->_conf.get_val<uint64_t>("osd_mclock_cost_calibration_min_samples")),
     scheduler(
       std::bind(&mClockScheduler::ClientRegistry::get_info,
                 &client_registry,
@@ -45,9 +48,18 @@ mClockScheduler::mClockScheduler(CephContext *cct,
 {
   cct->_conf.add_observer(this);
   ceph_assert(num_shards > 0);
+  if (cct->_conf->osd_op_num_threads_per_shard) {
+    num_threads_per_shard = cct->_conf->osd_op_num_threads_per_shard;
+  } else if (is_rotational) {
+    num_threads_per_shard = cct->_conf->osd_op_num_threads_per_shard_hdd;
+  } else {
+    num_threads_per_shard = cct->_conf->osd_op_num_threads_per_shard_ssd;
+  }
+  num_threads_per_shard = std::max(num_threads_per_shard, 1u);
   set_max_osd_capacity();
   set_osd_mclock_cost_per_io();
   set_osd_mclock_cost_per_byte();
+  set_osd_mclock_cost_calibration();
   set_mclock_profile();
   enable_mclock_profile_settings();
   client_registry.update_from_config(cct->_conf);
@@ -141,27 +153,45 @@ void mClockScheduler::set_osd_mclock_cost_per_io()
 void mClockScheduler::set_osd_mclock_cost_per_byte()
 {
   std::chrono::seconds sec(1);
+  double cost_per_byte_usec;
   if (cct->_conf.get_val<double>("osd_mclock_cost_per_byte_usec")) {
-    osd_mclock_cost_per_byte =
+    cost_per_byte_usec =
       cct->_conf.get_val<double>("osd_mclock_cost_per_byte_usec");
+    osd_mclock_cost_per_byte = cost_per_byte_usec;
   } else {
     if (is_rotational) {
-      osd_mclock_cost_per_byte =
+      cost_per_byte_usec =
         cct->_conf.get_val<double>("osd_mclock_cost_per_byte_usec_hdd");
       // For HDDs, convert value to seconds
-      osd_mclock_cost_per_byte /= std::chrono::microseconds(sec).count();
-    } else {
       osd_mclock_cost_per_byte =
+        cost_per_byte_usec / std::chrono::microseconds(sec).count();
+    } else {
+      cost_per_byte_usec =
         cct->_conf.get_val<double>("osd_mclock_cost_per_byte_usec_ssd");
       // For SSDs, convert value to milliseconds
-      osd_mclock_cost_per_byte /= std::chrono::milliseconds(sec).count();
+      osd_mclock_cost_per_byte =
+        cost_per_byte_usec / std::chrono::milliseconds(sec).count();
     }
   }
+  // The cost model works in seconds whatever the device
+  osd_mclock_cost_per_byte_sec =
+    cost_per_byte_usec / std::chrono::microseconds(sec).count();
   dout(1) << __func__ << " osd_mclock_cost_per_byte: "
           << std::fixed << std::setprecision(7) << osd_mclock_cost_per_byte
           << dendl;
 }
 
+void mClockScheduler::set_osd_mclock_cost_calibration()
+{
+  cost_calibration = cct->_conf.get_val<bool>("osd_mclock_cost_calibration");
+  if (!cost_calibration) {
+    // start over from the configured costs when turned back on
+    cost_model.reset();
+  }
+  dout(1) << __func__ << " osd_mclock_cost_calibration: "
+          << cost_calibration << dendl;
+}
+
 void mClockScheduler::set_mclock_profile()
 {
   mclock_profile = cct->_conf.get_val<std::string>("osd_mclock_profile");
@@ -378,8 +408,22 @@ void mClockScheduler::set_profile_config()
     << "]" << dendl;
 }
 
-int mClockScheduler::calc_scaled_cost(int item_cost)
+int mClockScheduler::calc_scaled_cost(op_scheduler_class class_id,
+                                      int item_cost)
 {
+  if (cost_calibration) {
+    if (auto est = cost_model.get_estimate(class_id,
+                                           osd_mclock_cost_per_byte_sec);
+        est) {
+      // Express the learned cost in ios at the capacity the profile
+      // allocations were made for: an op which keeps the store busy as
+      // long as one io at max_osd_capacity costs 1, so the drift of the
+      // device from its benchmarked capacity is charged in the costs.
+      int scaled_cost = std::round(
+        est->predict(item_cost) * max_osd_capacity / num_threads_per_shard);
+      return std::max(scaled_cost, 1);
+    }
+  }
   // Calculate total scaled cost in secs
   int scaled_cost =
     std::round(osd_mclock_cost_per_io + (osd_mclock_cost_per_byte * item_cost));
@@ -394,6 +438,16 @@ void mClockScheduler::update_configuration()
   cct->_conf.apply_changes(nullptr);
 }
 
+void mClockScheduler::observe_cost(op_scheduler_class class_id,
+                                   int cost,
+                                   ceph::timespan elapsed)
+{
+  if (cost_calibration) {
+    cost_model.observe(class_id, std::max(cost, 0),
+                       std::chrono::duration<double>(elapsed).count());
+  }
+}
+
 void mClockScheduler::dump(ceph::Formatter &f) const
 {
   // Display queue sizes
@@ -414,6 +468,19 @@ void mClockScheduler::dump(ceph::Formatter &f) const
   f.open_object_section("mClockQueues");
   f.dump_string("queues", display_queues());
   f.close_section();
+
+  // Learned op costs and the capacity they imply
+  f.open_object_section("mClockCostModel");
+  f.dump_bool("enabled", cost_calibration);
+  f.dump_float("max_osd_capacity", max_osd_capacity);
+  if (auto est = cost_model.get_estimate(op_scheduler_class::client,
+                                         osd_mclock_cost_per_byte_sec); est) {
+    // iops of 4KiB client ops the shard would sustain at the learned cost
+    f.dump_float("calibrated_osd_capacity",
+                 num_threads_per_shard / est->predict(4096));
+  }
+  cost_model.dump(f, osd_mclock_cost_per_byte_sec);
+  f.close_section();
 }
 
 void mClockScheduler::enqueue(OpSchedulerItem&& item)
@@ -424,7 +491,7 @@ void mClockScheduler::enqueue(OpSchedulerItem&& item)
   if (op_scheduler_class::immediate == id.class_id) {
     immediate.push_front(std::move(item));
   } else {
-    int cost = calc_scaled_cost(item.get_cost());
+    int cost = calc_scaled_cost(id.class_id, item.get_cost());
     item.set_qos_cost(cost);
     dout(20) << __func__ << " " << id
              << " item_cost: " << item.get_cost()
@@ -508,6 +575,9 @@ const char** mClockScheduler::get_tracked_conf_keys() const
     "osd_mclock_max_capacity_iops_hdd",
     "osd_mclock_max_capacity_iops_ssd",
     "osd_mclock_profile",
+    "osd_mclock_cost_calibration",
+    "osd_mclock_cost_calibration_window",
+    "osd_mclock_cost_calibration_min_samples",
     NULL
   };
   return KEYS;
@@ -527,6 +597,15 @@ void mClockScheduler::handle_conf_change(
       changed.count("osd_mclock_cost_per_byte_usec_ssd")) {
     set_osd_mclock_cost_per_byte();
   }
+  if (changed.count("osd_mclock_cost_calibration")) {
+    set_osd_mclock_cost_calibration();
+  }
+  if (changed.count("osd_mclock_cost_calibration_window") ||
+      changed.count("osd_mclock_cost_calibration_min_samples")) {
+    cost_model.set_window(
+      conf.get_val<uint64_t>("osd_mclock_cost_calibration_window"),
+      conf.get_val<uint64_t>("osd_mclock_cost_calibration_min_samples"));
+  }
   if (changed.count("osd_mclock_max_capacity_iops_hdd") ||
       changed.count("osd_mclock_max_capacity_iops_ssd")) {
     set_max_osd_capacity();
@@ -15,6 +15,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <ostream>
 #include <map>
 #include <vector>
@@ -28,6 +29,7 @@
 #include "include/cmp.h"
 #include "common/ceph_context.h"
 #include "common/mClockPriorityQueue.h"
+#include "osd/scheduler/mClockCostModel.h"
 #include "osd/scheduler/OpSchedulerItem.h"
 
 
@@ -80,9 +82,14 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
   CephContext *cct;
   const uint32_t num_shards;
   bool is_rotational;
+  uint32_t num_threads_per_shard;
   double max_osd_capacity;
   double osd_mclock_cost_per_io;
   double osd_mclock_cost_per_byte;
+  // osd_mclock_cost_per_byte in seconds, for the cost model
+  double osd_mclock_cost_per_byte_sec;
+  std::atomic<bool> cost_calibration;
+  mClockCostModel cost_model;
   std::string mclock_profile = "high_client_ops";
   struct ClientAllocs {
     uint64_t res;
@@ -162,6 +169,9 @@ public:
   // Set the cost per byte for the osd
   void set_osd_mclock_cost_per_byte();
 
+  // Set whether the op costs are learned from their ObjectStore time
+  void set_osd_mclock_cost_calibration();
+
   // Set the mclock profile type to enable
   void set_mclock_profile();
 
@@ -184,7 +194,7 @@ public:
   void set_profile_config();
 
   // Calculate scale cost per item
-  int calc_scaled_cost(int cost);
+  int calc_scaled_cost(op_scheduler_class class_id, int cost);
 
   // Helper method to display mclock queues
   std::string display_queues() const;
@@ -203,6 +213,14 @@ public:
     return immediate.empty() && scheduler.empty();
   }
 
+  // Feed the ObjectStore time of an op to the cost model
+  void observe_cost(op_scheduler_class class_id, int cost,
+		    ceph::timespan elapsed) final;
+
+  bool observes_cost() const final {
+    return cost_calibration;
+  }
+
   // Formatted output of the queue
   void dump(ceph::Formatter &f) const final;
 
@@ -14,6 +14,8 @@
 #include "common/sctp_crc32.h"
 #include "common/crc32c_intel_baseline.h"
 #include "common/crc32c_aarch64.h"
+#include "common/csum_multibuf.h"
+#include "arch/intel.h"
 
 TEST(Crc32c, Small) {
   const char *a = "foo bar baz";
@@ -363,3 +365,46 @@ TEST(Crc32c, zeros_performance) {
 
 }
 
+
+TEST(Crc32c, MultiBuf) {
+  // every kernel must match the per-block baseline, including the
+  // leftover blocks that don't fill a whole group of lanes
+  std::vector<std::pair<const char*, ceph_csum_multibuf_func_t>> crc_funcs = {
+    {"crc32c", ceph_crc32c_multibuf_func},
+  };
+  std::vector<std::pair<const char*, ceph_csum_multibuf_func_t>> xxh_funcs = {
+    {"xxhash32", ceph_xxhash32_multibuf_func},
+  };
+#if defined(__x86_64__)
+  if (ceph_arch_intel_sse42)
+    crc_funcs.emplace_back("crc32c_sse42", ceph_crc32c_multibuf_sse42);
+  if (ceph_arch_intel_avx2)
+    xxh_funcs.emplace_back("xxhash32_avx2", ceph_xxhash32_multibuf_avx2);
+  if (ceph_arch_intel_avx512f)
+    xxh_funcs.emplace_back("xxhash32_avx512", ceph_xxhash32_multibuf_avx512);
+#endif
+  for (size_t block_size : {1, 15, 16, 512, 4096, 4100}) {
+    for (size_t n : {1, 3, 4, 7, 8, 9, 16, 17, 40}) {
+      std::vector<unsigned char> data(block_size * n);
+      for (auto& c : data)
+	c = rand();
+      std::vector<uint32_t> expected(n), actual(n);
+      for (uint32_t init : {0u, 0xffffffffu, 1234u}) {
+	ceph_crc32c_multibuf_baseline(init, data.data(), block_size, n,
+				      expected.data());
+	for (auto& [name, f] : crc_funcs) {
+	  f(init, data.data(), block_size, n, actual.data());
+	  ASSERT_EQ(expected, actual) << name << " block_size " << block_size
+				      << " n " << n;
+	}
+	ceph_xxhash32_multibuf_baseline(init, data.data(), block_size, n,
+					expected.data());
+	for (auto& [name, f] : xxh_funcs) {
+	  f(init, data.data(), block_size, n, actual.data());
+	  ASSERT_EQ(expected, actual) << name << " block_size " << block_size
+				      << " n " << n;
+	}
+      }
+    }
+  }
+}
@@ -0,0 +1,150 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "common/sharded_shared_cache.hpp"
+
+using Cache = ShardedSharedLRU<unsigned, int>;
+
+TEST(ShardedSharedLRU, lookup_or_create)
+{
+  Cache cache{nullptr, 8, 8, 4};
+  ASSERT_FALSE(cache.lookup(1));
+  auto one = cache.lookup_or_create(1);
+  ASSERT_TRUE(one);
+  *one = 42;
+  ASSERT_EQ(one, cache.lookup_or_create(1));
+  ASSERT_EQ(one, cache.lookup(1));
+  ASSERT_EQ(1, cache.get_count());
+  ASSERT_FALSE(cache.empty());
+}
+
+TEST(ShardedSharedLRU, live_values_survive_eviction)
+{
+  // one shard, so that the eviction order is deterministic
+  Cache cache{nullptr, 2, 2, 1};
+  auto held = cache.lookup_or_create(0);
+  *held = 42;
+  held.reset();
+  for (unsigned i = 1; i <= 2; ++i) {
+    cache.lookup_or_create(i);
+  }
+  // 0 was evicted and nobody holds it anymore
+  ASSERT_FALSE(cache.lookup(0));
+
+  held = cache.lookup_or_create(3);
+  *held = 43;
+  for (unsigned i = 4; i <= 10; ++i) {
+    cache.lookup_or_create(i);
+  }
+  ASSERT_EQ(2, cache.get_count());
+  // 3 was evicted as well, but it is still alive
+  auto found = cache.lookup(3);
+  ASSERT_EQ(held, found);
+  ASSERT_EQ(43, *found);
+}
+
+TEST(ShardedSharedLRU, second_chance)
+{
+  Cache cache{nullptr, 2, 2, 1};
+  cache.lookup_or_create(1);
+  cache.lookup_or_create(2);
+  // a hit spares 1 from the next eviction
+  cache.lookup(1);
+  cache.lookup_or_create(3);
+  std::pair<unsigned, Cache::VPtr> next;
+  std::vector<unsigned> alive;
+  while (cache.get_next(next.first, &next)) {
+    alive.push_back(next.first);
+  }
+  ASSERT_EQ((std::vector<unsigned>{1, 3}), alive);
+}
+
+TEST(ShardedSharedLRU, get_next_in_order)
+{
+  Cache cache{nullptr, 64, 64, 4};
+  for (unsigned i = 1; i <= 32; ++i) {
+    cache.lookup_or_create(i);
+  }
+  std::pair<unsigned, Cache::VPtr> next;
+  unsigned expected = 1;
+  while (cache.get_next(next.first, &next)) {
+    ASSERT_EQ(expected, next.first);
+    ASSERT_TRUE(next.second);
+    ++expected;
+  }
+  ASSERT_EQ(33u, expected);
+}
+
+TEST(ShardedSharedLRU, clear_range)
+{
+  Cache cache{nullptr, 64, 64, 4};
+  for (unsigned i = 1; i <= 10; ++i) {
+    cache.lookup_or_create(i);
+  }
+  auto five = cache.lookup(5);
+  cache.clear_range(3, 6);
+  ASSERT_EQ(6, cache.get_count());
+  ASSERT_FALSE(cache.lookup(3));
+  ASSERT_FALSE(cache.lookup(6));
+  // still alive, so still registered
+  ASSERT_EQ(five, cache.lookup(5));
+  cache.clear();
+  ASSERT_EQ(0, cache.get_count());
+  ASSERT_FALSE(cache.empty());
+  five.reset();
+  ASSERT_TRUE(cache.empty());
+}
+
+TEST(ShardedSharedLRU, capacity_adapts)
+{
+  Cache cache{nullptr, 4, 64, 1};
+  ASSERT_EQ(4u, cache.get_capacity());
+  // a working set larger than the cache keeps missing, so it grows
+  for (unsigned round = 0; round < 64; ++round) {
+    for (unsigned i = 0; i < 32; ++i) {
+      cache.lookup_or_create(i);
+    }
+  }
+  ASSERT_LT(4u, cache.get_capacity());
+  ASSERT_GE(64u, cache.get_capacity());
+  // and shrinks back once a small one keeps hitting
+  for (unsigned round = 0; round < 4096; ++round) {
+    for (unsigned i = 0; i < 2; ++i) {
+      cache.lookup_or_create(i);
+    }
+    // the occasional miss lets the shard reconsider its size
+    if (round % 128 == 0) {
+      cache.lookup(1000 + round);
+    }
+  }
+  ASSERT_EQ(4u, cache.get_capacity());
+}
+
+TEST(ShardedSharedLRU, concurrent)
+{
+  Cache cache{nullptr, 16, 256, 4};
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < 4; ++t) {
+    threads.emplace_back([&cache, t] {
+      for (unsigned i = 0; i < 10000; ++i) {
+	auto key = (i * 7 + t) % 128;
+	auto val = cache.lookup(key);
+	if (!val) {
+	  val = cache.lookup_or_create(key);
+	}
+	ASSERT_TRUE(val);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  std::pair<unsigned, Cache::VPtr> next;
+  while (cache.get_next(next.first, &next)) {
+    ASSERT_EQ(next.second, cache.lookup(next.first));
+  }
+}
@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+
+#include "common/TrackedOp.h"
+#include "global/global_context.h"
+
+namespace {
+
+class TestOp : public TrackedOp {
+public:
+  using Ref = boost::intrusive_ptr<TestOp>;
+
+  explicit TestOp(OpTracker *tracker)
+    : TrackedOp(tracker, ceph_clock_now()) {}
+
+  size_t num_events() const {
+    std::lock_guard l(lock);
+    return events.size();
+  }
+
+private:
+  void _dump_op_descriptor_unlocked(std::ostream& stream) const override {
+    stream << "test op";
+  }
+};
+
+// start n ops, mark two events on each and count the sampled ones
+int run_ops(OpTracker& tracker, int n)
+{
+  int sampled = 0;
+  for (int i = 0; i < n; ++i) {
+    TestOp::Ref op(new TestOp(&tracker));
+    op->tracking_start();
+    op->mark_event("queued");
+    op->mark_event("started");
+    if (op->is_sampled()) {
+      ++sampled;
+      EXPECT_EQ(3u, op->num_events());
+    } else {
+      // only initiated, done is added when the op completes
+      EXPECT_EQ(1u, op->num_events());
+    }
+  }
+  return sampled;
+}
+
+}
+
+TEST(OpTracker, sample_rate)
+{
+  OpTracker tracker(g_ceph_context, true, 4);
+  tracker.set_history_size_and_duration(20, 600);
+  tracker.set_history_slow_op_size_and_threshold(20, 600);
+
+  // every op by default
+  ASSERT_EQ(100, run_ops(tracker, 100));
+
+  // one in rate, out of any run of a multiple of rate ops
+  tracker.set_sample_rate(4);
+  ASSERT_EQ(25, run_ops(tracker, 100));
+  tracker.set_sample_rate(10);
+  ASSERT_EQ(10, run_ops(tracker, 100));
+
+  // 0 is taken as 1
+  tracker.set_sample_rate(0);
+  ASSERT_EQ(100, run_ops(tracker, 100));
+
+  tracker.on_shutdown();
+}
+
+TEST(OpTracker, unsampled_history)
+{
+  OpTracker tracker(g_ceph_context, true, 4);
+  tracker.set_history_size_and_duration(20, 600);
+  tracker.set_history_slow_op_size_and_threshold(20, 600);
+  tracker.set_sample_rate(1000000);
+
+  // the ops are numbered from 1, none of these is sampled
+  std::vector<TestOp::Ref> ops;
+  for (int i = 0; i < 3; ++i) {
+    ops.emplace_back(new TestOp(&tracker));
+    ops.back()->tracking_start();
+  }
+  for (auto& op : ops) {
+    ASSERT_FALSE(op->is_sampled());
+    // fast ops which were not sampled are not kept
+    ASSERT_FALSE(tracker.want_history_op(*op));
+  }
+  // but slow ones are, for their duration
+  tracker.set_history_slow_op_size_and_threshold(20, 0);
+  for (auto& op : ops) {
+    ASSERT_TRUE(tracker.want_history_op(*op));
+  }
+  ops.clear();
+
+  tracker.on_shutdown();
+}
+
+TEST(OpTracker, untracked)
+{
+  OpTracker tracker(g_ceph_context, false, 4);
+  tracker.set_sample_rate(4);
+  TestOp::Ref op(new TestOp(&tracker));
+  op->tracking_start();
+  op->mark_event("queued");
+  // nothing is recorded when tracking is off, sampled or not
+  ASSERT_EQ(0u, op->num_events());
+  op.reset();
+  tracker.on_shutdown();
+}
@@ -433,6 +433,112 @@ TEST(ZlibCompressor, zlib_isal_compatibility)
 }
 #endif
 
+static bufferlist make_dictionary_record(int i)
+{
+  // small, similar records which compress poorly on their own
+  std::stringstream ss;
+  ss << "{\"bucket\": \"photos-" << (i % 7) << "\", \"key\": \"img_"
+     << i * 7919 << ".jpg\", \"owner\": \"user" << (i % 13)
+     << "\", \"size\": " << i * 31 << ", \"storage_class\": \"STANDARD\""
+     << ", \"content_type\": \"image/jpeg\", \"etag\": \"" << std::hex
+     << i * 2654435761u << "\"}";
+  bufferlist bl;
+  bl.append(ss.str());
+  return bl;
+}
+
+TEST(ZstdCompressor, dictionary_round_trip)
+{
+  CompressorRef zstd = Compressor::create(g_ceph_context, "zstd");
+  ASSERT_TRUE(zstd);
+  ASSERT_TRUE(zstd->supports_dictionary());
+
+  std::vector<bufferlist> samples;
+  for (int i = 0; i < 2000; ++i) {
+    samples.push_back(make_dictionary_record(i));
+  }
+  bufferlist dict;
+  ASSERT_EQ(0, zstd->train_dictionary(samples, 16384, &dict));
+  ASSERT_GT(dict.length(), 0u);
+  ASSERT_LE(dict.length(), 16384u);
+  ASSERT_EQ(0, zstd->load_dictionary(7, dict));
+  EXPECT_TRUE(zstd->has_dictionary(7));
+  EXPECT_FALSE(zstd->has_dictionary(8));
+
+  bufferlist orig = make_dictionary_record(100000);
+  bufferlist plain;
+  std::optional<int32_t> compressor_message;
+  ASSERT_EQ(0, zstd->compress(orig, plain, compressor_message));
+  EXPECT_FALSE(compressor_message);
+
+  bufferlist with_dict;
+  compressor_message = 7;
+  ASSERT_EQ(0, zstd->compress(orig, with_dict, compressor_message));
+  ASSERT_TRUE(compressor_message);
+  EXPECT_EQ(7, *compressor_message);
+  EXPECT_LT(with_dict.length(), plain.length());
+  cout << "orig " << orig.length() << " compressed " << plain.length()
+       << " with dictionary " << with_dict.length() << std::endl;
+
+  bufferlist decompressed;
+  ASSERT_EQ(0, zstd->decompress(with_dict, decompressed, compressor_message));
+  EXPECT_TRUE(decompressed.contents_equal(orig));
+
+  // the dictionary is needed to decompress
+  bufferlist missing;
+  EXPECT_EQ(-ENOENT, zstd->decompress(with_dict, missing, 8));
+
+  // an unknown dictionary falls back to plain compression
+  bufferlist fallback;
+  compressor_message = 8;
+  ASSERT_EQ(0, zstd->compress(orig, fallback, compressor_message));
+  EXPECT_FALSE(compressor_message);
+  decompressed.clear();
+  ASSERT_EQ(0, zstd->decompress(fallback, decompressed, compressor_message));
+  EXPECT_TRUE(decompressed.contents_equal(orig));
+
+  zstd->unload_dictionary(7);
+  EXPECT_FALSE(zstd->has_dictionary(7));
+}
+
+TEST(ZstdCompressor, private_dictionaries)
+{
+  CompressorRef shared = Compressor::create(g_ceph_context, "zstd");
+  ASSERT_TRUE(shared);
+  EXPECT_EQ(shared, Compressor::create(g_ceph_context, "zstd"));
+  CompressorRef mine = shared->create_private();
+  ASSERT_TRUE(mine);
+  ASSERT_NE(shared, mine);
+
+  std::vector<bufferlist> samples;
+  for (int i = 0; i < 2000; ++i) {
+    samples.push_back(make_dictionary_record(i));
+  }
+  bufferlist dict;
+  ASSERT_EQ(0, mine->train_dictionary(samples, 16384, &dict));
+  ASSERT_EQ(0, mine->load_dictionary(3, dict));
+  EXPECT_TRUE(mine->has_dictionary(3));
+  // neither the shared instance nor another private one sees it
+  EXPECT_FALSE(shared->has_dictionary(3));
+  EXPECT_FALSE(shared->create_private()->has_dictionary(3));
+
+  bufferlist orig = make_dictionary_record(100000);
+  bufferlist with_dict;
+  std::optional<int32_t> compressor_message = 3;
+  ASSERT_EQ(0, mine->compress(orig, with_dict, compressor_message));
+  ASSERT_TRUE(compressor_message);
+  bufferlist decompressed;
+  EXPECT_EQ(-ENOENT, shared->decompress(with_dict, decompressed, 3));
+  ASSERT_EQ(0, mine->decompress(with_dict, decompressed, 3));
+  EXPECT_TRUE(decompressed.contents_equal(orig));
+
+  // compressors without dictionaries have no use for one of their own
+  CompressorRef snappy = Compressor::create(g_ceph_context, "snappy");
+  if (snappy) {
+    EXPECT_FALSE(snappy->create_private());
+  }
+}
+
 TEST(CompressionPlugin, all)
 {
   CompressorRef compressor;
@@ -243,6 +243,75 @@ TEST(ErasureCodeClay, encode_decode_aloof_nodes)
   }
 }
 
+TEST(ErasureCodeClay, decode_plan_cache)
+{
+  ErasureCodeClay clay(g_conf().get_val<std::string>("erasure_code_dir"));
+  ErasureCodeProfile profile;
+  profile["k"] = "3";
+  profile["m"] = "3";
+  profile["d"] = "4";
+  ASSERT_EQ(0, clay.init(profile, &cerr));
+  EXPECT_EQ(0u, clay.get_decode_plan_cache_stats().plans);
+
+  bufferlist in;
+  in.append(string(clay.get_chunk_size(1) * 3, 'X'));
+  set<int> want_to_encode = {0, 1, 2, 3, 4, 5};
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, clay.encode(want_to_encode, in, &encoded));
+  // encoding computes the parity with a layered decode plan
+  auto stats = clay.get_decode_plan_cache_stats();
+  EXPECT_EQ(1u, stats.misses);
+  EXPECT_EQ(1u, stats.plans);
+  unsigned length = encoded[0].length();
+  int sc_size = length/clay.sub_chunk_no;
+
+  // repair each chunk from d helpers, twice: the second round finds
+  // every plan in the cache and repairs the same bytes
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 6; i++) {
+      set<int> want_to_read = {i};
+      set<int> available = want_to_encode;
+      available.erase(i);
+      map<int, vector<pair<int,int>>> minimum;
+      ASSERT_EQ(0, clay.minimum_to_decode(want_to_read, available, &minimum));
+      map<int, bufferlist> helper;
+      for (auto& [chunk, ranges] : minimum) {
+	for (auto& [index, count] : ranges) {
+	  bufferlist temp;
+	  temp.substr_of(encoded[chunk], index*sc_size, count*sc_size);
+	  helper[chunk].append(temp);
+	}
+      }
+      map<int, bufferlist> decoded;
+      ASSERT_EQ(0, clay.decode(want_to_read, helper, &decoded, length));
+      EXPECT_EQ(0, memcmp(decoded[i].c_str(), encoded[i].c_str(), length));
+    }
+  }
+  stats = clay.get_decode_plan_cache_stats();
+  EXPECT_EQ(1u + 6u, stats.misses);
+  EXPECT_EQ(6u, stats.hits);
+  EXPECT_EQ(1u + 6u, stats.plans);
+
+  // the same with the cache disabled
+  g_conf().set_val_or_die("erasure_code_plan_cache_size", "0");
+  ErasureCodeClay uncached(g_conf().get_val<std::string>("erasure_code_dir"));
+  ASSERT_EQ(0, uncached.init(profile, &cerr));
+  g_conf().rm_val("erasure_code_plan_cache_size");
+  map<int, bufferlist> degraded = encoded;
+  degraded.erase(0);
+  degraded.erase(4);
+  for (int round = 0; round < 2; round++) {
+    map<int, bufferlist> decoded;
+    ASSERT_EQ(0, uncached._decode(set<int>{0, 4}, degraded, &decoded));
+    EXPECT_EQ(0, memcmp(decoded[0].c_str(), encoded[0].c_str(), length));
+    EXPECT_EQ(0, memcmp(decoded[4].c_str(), encoded[4].c_str(), length));
+  }
+  stats = uncached.get_decode_plan_cache_stats();
+  EXPECT_EQ(0u, stats.hits);
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(0u, stats.plans);
+}
+
 TEST(ErasureCodeClay, encode_decode_shortening_case)
 {
   ostringstream errors;
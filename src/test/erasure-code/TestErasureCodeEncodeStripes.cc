@@ -0,0 +1,136 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "acconfig.h"
+#include "erasure-code/ErasureCode.h"
+#include "erasure-code/ErasureCodePlugin.h"
+#include "global/global_context.h"
+#include "common/config_proxy.h"
+#include "gtest/gtest.h"
+
+using namespace std;
+
+// encode_stripes() must give the same chunks as encode() called on each
+// stripe, whichever plugin does the encoding
+struct EncodeStripesParam {
+  const char *plugin;
+  ErasureCodeProfile profile;
+};
+
+ostream& operator<<(ostream& out, const EncodeStripesParam& p)
+{
+  return out << p.plugin << " " << p.profile;
+}
+
+class ErasureCodeEncodeStripes
+  : public ::testing::TestWithParam<EncodeStripesParam> {
+public:
+  ErasureCodeInterfaceRef erasure_code;
+
+  void SetUp() override {
+    ErasureCodeProfile profile = GetParam().profile;
+    ASSERT_EQ(0, ErasureCodePluginRegistry::instance().factory(
+		GetParam().plugin,
+		g_conf().get_val<std::string>("erasure_code_dir"),
+		profile,
+		&erasure_code, &cerr));
+    ASSERT_TRUE(erasure_code);
+  }
+};
+
+TEST_P(ErasureCodeEncodeStripes, matches_encode)
+{
+  unsigned k = erasure_code->get_data_chunk_count();
+  unsigned n = erasure_code->get_chunk_count();
+  unsigned chunk_size = erasure_code->get_chunk_size(k * 4096);
+  unsigned stripe_width = k * chunk_size;
+  ASSERT_EQ(chunk_size, erasure_code->get_chunk_size(stripe_width));
+
+  const unsigned stripes = 5;
+  string payload;
+  for (unsigned i = 0; i < stripes * stripe_width; i++)
+    payload.push_back(rand());
+
+  // aligned, and misaligned and split at an odd offset
+  bufferlist aligned;
+  aligned.append(payload);
+  aligned.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  bufferlist misaligned;
+  {
+    bufferptr ptr(buffer::create_aligned(payload.length() + 1,
+					 ErasureCode::SIMD_ALIGN));
+    ptr.copy_in(1, payload.length(), payload.c_str());
+    misaligned.append(ptr, 1, 1000);
+    misaligned.append(ptr, 1001, payload.length() - 1000);
+  }
+  ASSERT_FALSE(misaligned.is_contiguous());
+
+  set<int> all;
+  for (unsigned i = 0; i < n; i++)
+    all.insert(i);
+  for (const set<int> &want : { all, set<int>{1, (int)n - 1} }) {
+    map<int, bufferlist> expected;
+    for (unsigned s = 0; s < stripes; s++) {
+      bufferlist stripe;
+      stripe.substr_of(aligned, s * stripe_width, stripe_width);
+      map<int, bufferlist> encoded;
+      ASSERT_EQ(0, erasure_code->encode(want, stripe, &encoded));
+      for (int i : want)
+	expected[i].claim_append(encoded[i]);
+    }
+    for (bufferlist *in : { &aligned, &misaligned }) {
+      map<int, bufferlist> encoded;
+      ASSERT_EQ(0, erasure_code->encode_stripes(want, *in, stripe_width,
+						&encoded));
+      ASSERT_EQ(want.size(), encoded.size());
+      for (int i : want) {
+	ASSERT_EQ(stripes * chunk_size, encoded[i].length());
+	ASSERT_TRUE(expected[i].contents_equal(encoded[i])) << "chunk " << i;
+      }
+    }
+  }
+
+  map<int, bufferlist> encoded;
+  bufferlist partial;
+  partial.substr_of(aligned, 0, stripe_width + 1);
+  EXPECT_EQ(-EINVAL, erasure_code->encode_stripes(set<int>{0}, partial,
+						  stripe_width, &encoded));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+  Plugins,
+  ErasureCodeEncodeStripes,
+  ::testing::Values(
+    EncodeStripesParam{"jerasure", {{"technique", "reed_sol_van"},
+				    {"k", "4"}, {"m", "2"}}},
+    EncodeStripesParam{"jerasure", {{"technique", "cauchy_good"},
+				    {"k", "4"}, {"m", "2"},
+				    {"packetsize", "8"}}},
+#ifdef WITH_EC_ISA_PLUGIN
+    EncodeStripesParam{"isa", {{"technique", "reed_sol_van"},
+			       {"k", "4"}, {"m", "2"}}},
+#endif
+    EncodeStripesParam{"clay", {{"k", "4"}, {"m", "2"}}},
+    EncodeStripesParam{"lrc", {{"k", "4"}, {"m", "2"}, {"l", "3"}}},
+    EncodeStripesParam{"shec", {{"k", "4"}, {"m", "3"}, {"c", "2"}}}));
+
+/*
+ * Local Variables:
+ * compile-command: "cd ../../../build ; make -j4 &&
+ *   make unittest_erasure_code_encode_stripes &&
+ *   valgrind --tool=memcheck ./bin/unittest_erasure_code_encode_stripes \
+ *      --gtest_filter=*.* --log-to-stderr=true --debug-osd=20"
+ * End:
+ */
@@ -0,0 +1,117 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph distributed storage system
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <random>
+#include <vector>
+
+#include "erasure-code/gf_kernels.h"
+#include "gtest/gtest.h"
+
+using std::vector;
+
+static vector<uint8_t> random_bytes(std::mt19937 &rng, size_t len)
+{
+  vector<uint8_t> v(len);
+  for (auto &b : v)
+    b = rng();
+  return v;
+}
+
+TEST(GfKernels, mul)
+{
+  // the field of jerasure w=8 and isa-l
+  EXPECT_EQ(0x1d, ceph_gf_mul(2, 0x80));
+  EXPECT_EQ(0, ceph_gf_mul(0, 0x53));
+  EXPECT_EQ(0x53, ceph_gf_mul(1, 0x53));
+  for (int a = 1; a < 256; ++a) {
+    int inverses = 0;
+    for (int b = 1; b < 256; ++b) {
+      EXPECT_EQ(ceph_gf_mul(a, b), ceph_gf_mul(b, a));
+      if (ceph_gf_mul(a, b) == 1)
+	++inverses;
+    }
+    EXPECT_EQ(1, inverses) << a;
+  }
+}
+
+TEST(GfKernels, regions)
+{
+  std::mt19937 rng(1234);
+  const ceph_gf_kernel *baseline = ceph_gf_kernels()[0];
+  ASSERT_STREQ("baseline", baseline->name);
+
+  for (auto k = ceph_gf_kernels(); *k; ++k) {
+    SCOPED_TRACE((*k)->name);
+    // odd offsets and lengths to cover unaligned heads and the tails
+    for (size_t len : {0, 1, 15, 64, 255, 1000, 4096, 65537}) {
+      for (size_t off : {0, 3}) {
+	vector<uint8_t> src = random_bytes(rng, len + off);
+	vector<uint8_t> dst = random_bytes(rng, len + off);
+
+	vector<uint8_t> expected = dst;
+	baseline->xor_region(src.data() + off, expected.data() + off, len);
+	vector<uint8_t> got = dst;
+	(*k)->xor_region(src.data() + off, got.data() + off, len);
+	ASSERT_EQ(expected, got) << "xor len " << len;
+
+	for (int c : {0, 1, 2, 0x1d, 0x8e, 0xff}) {
+	  for (int add : {0, 1}) {
+	    expected = dst;
+	    for (size_t i = 0; i < len; ++i) {
+	      uint8_t p = ceph_gf_mul(c, src[off + i]);
+	      expected[off + i] = add ? (expected[off + i] ^ p) : p;
+	    }
+	    got = dst;
+	    (*k)->mul_region(c, src.data() + off, got.data() + off, len, add);
+	    ASSERT_EQ(expected, got)
+	      << "mul c " << c << " add " << add << " len " << len;
+	  }
+	}
+      }
+    }
+  }
+}
+
+TEST(GfKernels, dot_prod)
+{
+  std::mt19937 rng(4321);
+  const int n = 6;
+  const size_t len = 3 * 8192 + 77;
+  vector<vector<uint8_t>> src;
+  vector<const uint8_t*> srcp;
+  for (int i = 0; i < n; ++i) {
+    src.push_back(random_bytes(rng, len));
+    srcp.push_back(src.back().data());
+  }
+  uint8_t coeffs[n] = {1, 0, 7, 0xaa, 1, 0x42};
+
+  vector<uint8_t> expected(len, 0);
+  for (size_t j = 0; j < len; ++j) {
+    for (int i = 0; i < n; ++i)
+      expected[j] ^= ceph_gf_mul(coeffs[i], src[i][j]);
+  }
+  vector<uint8_t> got = random_bytes(rng, len);
+  ceph_gf_dot_prod(coeffs, n, srcp.data(), got.data(), len);
+  ASSERT_EQ(expected, got);
+
+  ceph_gf_dot_prod(coeffs, 0, srcp.data(), got.data(), len);
+  ASSERT_EQ(vector<uint8_t>(len, 0), got);
+}
+
+/*
+ * Local Variables:
+ * compile-command: "cd ../.. ;
+ *   make -j4 unittest_erasure_code_gf_kernels &&
+ *   valgrind --tool=memcheck ./unittest_erasure_code_gf_kernels \
+ *      --gtest_filter=*.* --log-to-stderr=true --debug-osd=20"
+ * End:
+ */
@@ -876,6 +876,65 @@ TEST_F(IsaErasureCodeTest, isa_xor_codec)
   EXPECT_EQ(5, cnt_cf);
 }
 
+TEST_F(IsaErasureCodeTest, parity_delta)
+{
+  // m=1 uses the xor codec, the others the update tables
+  const char *ms[] = { "1", "2", "3" };
+  for (int matrix : { ErasureCodeIsa::kVandermonde, ErasureCodeIsa::kCauchy }) {
+    for (const char *m : ms) {
+      ErasureCodeIsaDefault Isa(tcache, matrix);
+      ErasureCodeProfile profile;
+      profile["k"] = "4";
+      profile["m"] = m;
+      ASSERT_EQ(0, Isa.init(profile, &cerr));
+      ASSERT_TRUE(Isa.supports_parity_delta());
+
+      const int k = Isa.get_data_chunk_count();
+      const int n = Isa.get_chunk_count();
+      set<int> want_to_encode;
+      for (int i = 0; i < n; i++)
+        want_to_encode.insert(i);
+
+      unsigned object_size = Isa.get_alignment() * 8;
+      string payload(object_size, 'X');
+      for (unsigned i = 0; i < object_size; i++)
+        payload[i] = rand();
+      bufferlist in;
+      in.append(payload);
+      map<int, bufferlist> encoded;
+      ASSERT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+      unsigned length = encoded[0].length();
+
+      // overwrite chunks 1 and 2
+      map<int, bufferlist> deltas;
+      for (int i = 1; i <= 2; i++) {
+        string update(length, 'Y');
+        for (unsigned j = 0; j < length; j++)
+          update[j] = rand();
+        bufferlist new_data;
+        new_data.append(update);
+        ASSERT_EQ(0, Isa.encode_delta(encoded[i], new_data, &deltas[i]));
+        payload.replace(i * length, length, update);
+      }
+      map<int, bufferlist> parity;
+      for (int i = k; i < n; i++) {
+        bufferptr p(buffer::create_aligned(length, EC_ISA_ADDRESS_ALIGNMENT));
+        memcpy(p.c_str(), encoded[i].c_str(), length);
+        parity[i].push_back(p);
+      }
+      EXPECT_EQ(0, Isa.apply_delta(deltas, &parity));
+
+      bufferlist new_in;
+      new_in.append(payload);
+      map<int, bufferlist> reencoded;
+      ASSERT_EQ(0, Isa.encode(want_to_encode, new_in, &reencoded));
+      for (int i = k; i < n; i++)
+        EXPECT_TRUE(parity[i].contents_equal(reencoded[i]))
+          << "m=" << m << " chunk " << i;
+    }
+  }
+}
+
 TEST_F(IsaErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
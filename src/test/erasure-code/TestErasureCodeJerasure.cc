@@ -228,6 +228,65 @@ TYPED_TEST(ErasureCodeTest, minimum_to_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, encode_stripes)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+  unsigned chunk_size = jerasure.get_chunk_size(4 * 4096);
+  unsigned stripe_width = 4 * chunk_size;
+  ASSERT_EQ(chunk_size, jerasure.get_chunk_size(stripe_width));
+
+  const unsigned stripes = 5;
+  string payload;
+  for (unsigned i = 0; i < stripes * stripe_width; i++)
+    payload.push_back(rand());
+
+  // aligned, and misaligned and split at an odd offset
+  bufferlist aligned;
+  aligned.append(payload);
+  aligned.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+  bufferlist misaligned;
+  {
+    bufferptr ptr(buffer::create_aligned(payload.length() + 1,
+					 ErasureCode::SIMD_ALIGN));
+    ptr.copy_in(1, payload.length(), payload.c_str());
+    misaligned.append(ptr, 1, 1000);
+    misaligned.append(ptr, 1001, payload.length() - 1000);
+  }
+  ASSERT_FALSE(misaligned.is_contiguous());
+
+  for (const set<int> &want : { set<int>{0, 1, 2, 3, 4, 5}, set<int>{1, 5} }) {
+    map<int, bufferlist> expected;
+    for (unsigned s = 0; s < stripes; s++) {
+      bufferlist stripe;
+      stripe.substr_of(aligned, s * stripe_width, stripe_width);
+      map<int, bufferlist> encoded;
+      ASSERT_EQ(0, jerasure.encode(want, stripe, &encoded));
+      for (int i : want)
+	expected[i].claim_append(encoded[i]);
+    }
+    for (bufferlist *in : { &aligned, &misaligned }) {
+      map<int, bufferlist> encoded;
+      ASSERT_EQ(0, jerasure.encode_stripes(want, *in, stripe_width, &encoded));
+      ASSERT_EQ(want.size(), encoded.size());
+      for (int i : want) {
+	ASSERT_EQ(stripes * chunk_size, encoded[i].length());
+	ASSERT_TRUE(expected[i].contents_equal(encoded[i])) << "chunk " << i;
+      }
+    }
+  }
+
+  map<int, bufferlist> encoded;
+  bufferlist partial;
+  partial.substr_of(aligned, 0, stripe_width + 1);
+  EXPECT_EQ(-EINVAL, jerasure.encode_stripes(set<int>{0}, partial,
+					     stripe_width, &encoded));
+}
+
 TEST(ErasureCodeTest, encode)
 {
   ErasureCodeJerasureReedSolomonVandermonde jerasure;
@@ -278,6 +337,76 @@ TEST(ErasureCodeTest, encode)
   }
 }
 
+template <typename T>
+void check_parity_delta(const char *k, const char *m, const char *w)
+{
+  T jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = k;
+  profile["m"] = m;
+  profile["w"] = w;
+  ASSERT_EQ(0, jerasure.init(profile, &cerr));
+  ASSERT_TRUE(jerasure.supports_parity_delta());
+
+  unsigned chunk_count = jerasure.get_chunk_count();
+  unsigned data_chunk_count = jerasure.get_data_chunk_count();
+  unsigned object_size = jerasure.get_alignment() * 4;
+  set<int> want_to_encode;
+  for (unsigned i = 0; i < chunk_count; ++i)
+    want_to_encode.insert(i);
+
+  string payload(object_size, 'X');
+  for (unsigned i = 0; i < object_size; ++i)
+    payload[i] = rand();
+  bufferlist in;
+  in.append(payload);
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+  unsigned length = encoded[0].length();
+
+  // overwrite the first and the last data chunk
+  map<int, bufferlist> deltas;
+  for (unsigned i : { 0u, data_chunk_count - 1 }) {
+    string update(length, 'Y');
+    for (unsigned j = 0; j < length; ++j)
+      update[j] = rand();
+    bufferlist new_data;
+    new_data.append(update);
+    ASSERT_EQ(0, jerasure.encode_delta(encoded[i], new_data, &deltas[i]));
+    payload.replace(i * length, length, update);
+  }
+  map<int, bufferlist> parity;
+  for (unsigned i = data_chunk_count; i < chunk_count; ++i)
+    parity[i].append(encoded[i].c_str(), length);
+  EXPECT_EQ(0, jerasure.apply_delta(deltas, &parity));
+
+  bufferlist new_in;
+  new_in.append(payload);
+  map<int, bufferlist> reencoded;
+  ASSERT_EQ(0, jerasure.encode(want_to_encode, new_in, &reencoded));
+  for (unsigned i = data_chunk_count; i < chunk_count; ++i) {
+    EXPECT_EQ(length, parity[i].length());
+    EXPECT_TRUE(parity[i].contents_equal(reencoded[i])) << "chunk " << i;
+  }
+}
+
+TEST(ErasureCodeTest, parity_delta)
+{
+  for (const char *w : { "8", "16", "32" }) {
+    check_parity_delta<ErasureCodeJerasureReedSolomonVandermonde>("4", "3", w);
+    check_parity_delta<ErasureCodeJerasureReedSolomonRAID6>("4", "2", w);
+  }
+
+  ErasureCodeJerasureCauchyGood cauchy;
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  cauchy.init(profile, &cerr);
+  EXPECT_FALSE(cauchy.supports_parity_delta());
+  map<int, bufferlist> deltas, parity;
+  EXPECT_EQ(-EOPNOTSUPP, cauchy.apply_delta(deltas, &parity));
+}
+
 TEST(ErasureCodeTest, create_rule)
 {
   std::unique_ptr<CrushWrapper> c = std::make_unique<CrushWrapper>();
@@ -915,6 +915,62 @@ TEST(ErasureCodeLrc, encode_decode_2)
   }
 }
 
+TEST(ErasureCodeLrc, decode_plan_cache)
+{
+  ErasureCodeLrc lrc(g_conf().get_val<std::string>("erasure_code_dir"));
+  ErasureCodeProfile profile;
+  profile["mapping"] =
+    "__DD__DD";
+  const char *description_string =
+    "[ "
+    "  [ \"_cDD_cDD\", \"\" ]," // global layer
+    "  [ \"c_DD____\", \"\" ]," // first local layer
+    "  [ \"____cDDD\", \"\" ]," // second local layer
+    "]";
+  profile["layers"] = description_string;
+  ASSERT_EQ(0, lrc.init(profile, &cerr));
+  unsigned int chunk_size = lrc.get_chunk_size(1);
+  set<int> want_to_encode = {0, 1, 2, 3, 4, 5, 6, 7};
+  bufferlist in;
+  in.append(string(chunk_size * lrc.get_data_chunk_count(), 'X'));
+  map<int, bufferlist> encoded;
+  ASSERT_EQ(0, lrc.encode(want_to_encode, in, &encoded));
+
+  set<int> want_to_read = {3, 6, 7};
+  set<int> available_chunks = {0, 1, 2, 4, 5};
+  map<int, bufferlist> chunks = encoded;
+  chunks.erase(3);
+  chunks.erase(6);
+  chunks.erase(7);
+  set<int> first_minimum;
+  for (int round = 0; round < 3; round++) {
+    set<int> minimum;
+    EXPECT_EQ(0, lrc._minimum_to_decode(want_to_read, available_chunks, &minimum));
+    if (round == 0)
+      first_minimum = minimum;
+    EXPECT_EQ(first_minimum, minimum);
+    map<int, bufferlist> decoded;
+    EXPECT_EQ(0, lrc._decode(want_to_read, chunks, &decoded));
+    for (auto i : want_to_read)
+      EXPECT_TRUE(decoded[i].contents_equal(encoded[i]));
+  }
+  auto stats = lrc.get_decode_plan_cache_stats();
+  EXPECT_EQ(2u, stats.misses);
+  EXPECT_EQ(4u, stats.hits);
+  EXPECT_EQ(2u, stats.plans);
+
+  // the first local layer recovers 3 but nothing can recover 6 and 7,
+  // that is remembered too
+  chunks.erase(1);
+  for (int round = 0; round < 2; round++) {
+    map<int, bufferlist> decoded;
+    EXPECT_EQ(-EIO, lrc._decode(want_to_read, chunks, &decoded));
+  }
+  stats = lrc.get_decode_plan_cache_stats();
+  EXPECT_EQ(3u, stats.misses);
+  EXPECT_EQ(5u, stats.hits);
+}
+
 /*
  * Local Variables:
  * compile-command: "cd ../.. ;
@@ -33,12 +33,14 @@
 #include "include/utime.h"
 #include "erasure-code/ErasureCodePlugin.h"
 #include "erasure-code/ErasureCode.h"
+#include "erasure-code/gf_kernels.h"
 #include "ceph_erasure_code_benchmark.h"
 
 using std::endl;
 using std::cerr;
 using std::cout;
 using std::map;
+using std::pair;
 using std::set;
 using std::string;
 using std::stringstream;
@@ -59,7 +61,13 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     ("plugin,p", po::value<string>()->default_value("jerasure"),
      "erasure code plugin name")
     ("workload,w", po::value<string>()->default_value("encode"),
-     "run either encode or decode")
+     "run either encode, decode, recover (rebuild one lost chunk at a "
+     "time from what minimum_to_decode asks for, the way recovery does) "
+     "or kernels (the GF(2^8) region kernels the plugins share, on k data "
+     "and m coding chunks)")
+    ("chunk-size,c", po::value<vector<int> >(),
+     "chunk size for the kernels workload (repeat for more than one, "
+     "defaults to 4K, 64K and 1M)")
     ("erasures,e", po::value<int>()->default_value(1),
      "number of erasures when decoding")
     ("erased", po::value<vector<int> >(),
@@ -130,6 +138,10 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     exhaustive_erasures = false;
   if (vm.count("erased") > 0)
     erased = vm["erased"].as<vector<int> >();
+  if (vm.count("chunk-size") > 0)
+    chunk_sizes = vm["chunk-size"].as<vector<int> >();
+  else
+    chunk_sizes = {4096, 64 * 1024, 1024 * 1024};
   
   try {
     k = stoi(profile["k"]);
@@ -158,6 +170,10 @@ int ErasureCodeBench::run() {
 
   if (workload == "encode")
     return encode();
+  else if (workload == "kernels")
+    return kernels();
+  else if (workload == "recover")
+    return recover();
   else
     return decode();
 }
@@ -325,6 +341,145 @@ int ErasureCodeBench::decode()
   return 0;
 }
 
+/*
+ * Rebuild one chunk per iteration, cycling through all of them (or
+ * the --erased ones), reading only the chunks and sub-chunks
+ * minimum_to_decode asks for.  This is what recovery of an object
+ * does and what the plugins cache decode plans for: with -v the
+ * plan cache counters are displayed, run with
+ * --erasure_code_plan_cache_size 0 to compare without it.
+ */
+int ErasureCodeBench::recover()
+{
+  ErasureCodePluginRegistry &instance = ErasureCodePluginRegistry::instance();
+  ErasureCodeInterfaceRef erasure_code;
+  stringstream messages;
+  int code = instance.factory(plugin,
+			      g_conf().get_val<std::string>("erasure_code_dir"),
+			      profile, &erasure_code, &messages);
+  if (code) {
+    cerr << messages.str() << endl;
+    return code;
+  }
+
+  bufferlist in;
+  in.append(string(in_size, 'X'));
+  in.rebuild_aligned(ErasureCode::SIMD_ALIGN);
+
+  set<int> want_to_encode;
+  for (int i = 0; i < k + m; i++) {
+    want_to_encode.insert(i);
+  }
+
+  map<int,bufferlist> encoded;
+  code = erasure_code->encode(want_to_encode, in, &encoded);
+  if (code)
+    return code;
+  unsigned chunk_size = encoded.begin()->second.length();
+  unsigned sub_chunk_size = chunk_size / erasure_code->get_sub_chunk_count();
+
+  vector<int> lost = erased;
+  if (lost.empty())
+    lost.assign(want_to_encode.begin(), want_to_encode.end());
+
+  utime_t begin_time = ceph_clock_now();
+  for (int i = 0; i < max_iterations; i++) {
+    int chunk = lost[i % lost.size()];
+    set<int> want_to_read = {chunk};
+    set<int> available = want_to_encode;
+    available.erase(chunk);
+    map<int, vector<pair<int, int>>> minimum;
+    code = erasure_code->minimum_to_decode(want_to_read, available, &minimum);
+    if (code)
+      return code;
+    map<int,bufferlist> chunks;
+    for (auto& [shard, sub_chunks] : minimum) {
+      for (auto& [index, count] : sub_chunks) {
+	bufferlist bl;
+	bl.substr_of(encoded[shard], index * sub_chunk_size,
+		     count * sub_chunk_size);
+	chunks[shard].claim_append(bl);
+      }
+    }
+    map<int,bufferlist> decoded;
+    code = erasure_code->decode(want_to_read, chunks, &decoded, chunk_size);
+    if (code)
+      return code;
+    if (!decoded[chunk].contents_equal(encoded[chunk])) {
+      cerr << "chunk " << chunk << " incorrectly recovered" << endl;
+      return -1;
+    }
+  }
+  utime_t end_time = ceph_clock_now();
+  cout << (end_time - begin_time) << "\t" << (max_iterations * (in_size / 1024)) << endl;
+  if (verbose) {
+    ErasureCode *ec = dynamic_cast<ErasureCode*>(erasure_code.get());
+    if (ec) {
+      ErasureCodePlanCacheStats stats = ec->get_decode_plan_cache_stats();
+      cout << "decode plans " << stats.plans << " hits " << stats.hits
+	   << " misses " << stats.misses << endl;
+    }
+  }
+  return 0;
+}
+
+/*
+ * Run every GF kernel this CPU supports over k data chunks, computing
+ * m coding chunks with a dot product each (what a Reed-Solomon encode
+ * with w=8 does) and, separately, their XOR (the m=1 case).  Prints
+ * one line per kernel and chunk size:
+ *
+ *   kernel  chunk_size  dot_prod GB/s  xor GB/s
+ *
+ * where GB/s is data chunk bytes consumed per second.
+ */
+int ErasureCodeBench::kernels()
+{
+  for (auto kernel = ceph_gf_kernels(); *kernel; ++kernel) {
+    for (int chunk_size : chunk_sizes) {
+      if (chunk_size <= 0) {
+	cerr << "chunk size " << chunk_size << " must be > 0" << endl;
+	return -EINVAL;
+      }
+      vector<vector<uint8_t>> data(k, vector<uint8_t>(chunk_size));
+      vector<const uint8_t*> src;
+      for (int j = 0; j < k; j++) {
+	for (int b = 0; b < chunk_size; b++)
+	  data[j][b] = rand();
+	src.push_back(data[j].data());
+      }
+      vector<uint8_t> coding(chunk_size);
+      // anything but 0 and 1, which aren't multiplies
+      vector<uint8_t> coeffs(k * std::max(m, 1));
+      for (unsigned j = 0; j < coeffs.size(); j++)
+	coeffs[j] = 2 + j % 254;
+
+      utime_t begin_time = ceph_clock_now();
+      for (int i = 0; i < max_iterations; i++) {
+	for (int r = 0; r < m; r++) {
+	  ceph_gf_kernel_dot_prod(*kernel, &coeffs[r * k], k, src.data(),
+				  coding.data(), chunk_size);
+	}
+      }
+      double dot_prod_secs = ceph_clock_now() - begin_time;
+
+      begin_time = ceph_clock_now();
+      for (int i = 0; i < max_iterations; i++) {
+	memcpy(coding.data(), src[0], chunk_size);
+	for (int j = 1; j < k; j++)
+	  (*kernel)->xor_region(src[j], coding.data(), chunk_size);
+      }
+      double xor_secs = ceph_clock_now() - begin_time;
+
+      double bytes = (double)max_iterations * k * chunk_size;
+      cout << (*kernel)->name << "\t" << chunk_size << "\t"
+	   << (m && dot_prod_secs > 0 ? bytes / dot_prod_secs / 1e9 : 0) << "\t"
+	   << (xor_secs > 0 ? bytes / xor_secs / 1e9 : 0) << endl;
+    }
+  }
+  return 0;
+}
+
 int main(int argc, char** argv) {
   ErasureCodeBench ecbench;
   try {
@@ -41,6 +41,7 @@ class ErasureCodeBench {
 
   bool exhaustive_erasures;
   std::vector<int> erased;
+  std::vector<int> chunk_sizes;
   std::string workload;
 
   ceph::ErasureCodeProfile profile;
@@ -56,7 +57,9 @@ public:
 		      unsigned want_erasures,
 		      ErasureCodeInterfaceRef erasure_code);
   int decode();
+  int recover();
   int encode();
+  int kernels();
 };
 
 #endif
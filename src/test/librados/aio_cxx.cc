@@ -1,8 +1,10 @@
 #include <errno.h>
 #include <fcntl.h>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 #include <boost/scoped_ptr.hpp>
 
 #include "gtest/gtest.h"
@@ -1555,6 +1557,85 @@ TEST(LibRadosAioEC, RoundTripSparseReadPP) {
   assert_eq_sparse(bl1, extents, bl2);
 }
 
+TEST(LibRadosAioEC, CoalescedReadsPP) {
+  AioTestDataECPP test_data;
+  ASSERT_EQ("", test_data.init());
+  // no two nearby bytes alike, so a read of the wrong extent shows
+  char buf[8192];
+  for (unsigned i = 0; i < sizeof(buf); ++i) {
+    buf[i] = (char)(i % 251);
+  }
+  bufferlist bl;
+  bl.append(buf, sizeof(buf));
+  ASSERT_EQ(0, test_data.m_ioctx.write_full("foo", bl));
+
+  struct read_t {
+    uint64_t off;
+    uint64_t len;
+    bool cmp;          // a cmpext which mismatches at byte 100
+    std::unique_ptr<AioCompletion> c;
+    bufferlist bl;
+  };
+  // identical, overlapping and adjacent extents all in flight at once.
+  // The cmpext reads the same extent as the first read and fails.
+  std::vector<read_t> reads;
+  reads.push_back({0, 4096, false});
+  reads.push_back({0, 4096, false});
+  reads.push_back({0, 4096, true});
+  reads.push_back({2048, 4096, false});
+  reads.push_back({4096, 4096, false});
+  reads.push_back({0, 4096, false});
+
+  ceph::mutex lock = ceph::make_mutex("CoalescedReadsPP");
+  std::vector<size_t> completed;
+  struct cb_arg_t {
+    size_t i;
+    ceph::mutex *lock;
+    std::vector<size_t> *completed;
+  };
+  std::vector<cb_arg_t> args;
+  for (size_t i = 0; i < reads.size(); ++i) {
+    args.push_back({i, &lock, &completed});
+  }
+  for (size_t i = 0; i < reads.size(); ++i) {
+    auto& r = reads[i];
+    r.c.reset(Rados::aio_create_completion(
+      &args[i], [](completion_t, void *arg) {
+	auto a = static_cast<cb_arg_t*>(arg);
+	std::lock_guard l(*a->lock);
+	a->completed->push_back(a->i);
+      }));
+    if (r.cmp) {
+      r.bl.append(buf + r.off, r.len);
+      r.bl.c_str()[100] ^= 0xff;
+      ASSERT_EQ(0, test_data.m_ioctx.aio_cmpext("foo", r.c.get(), r.off,
+						r.bl));
+    } else {
+      ASSERT_EQ(0, test_data.m_ioctx.aio_read("foo", r.c.get(), &r.bl,
+					      r.len, r.off));
+    }
+  }
+  {
+    TestAlarm alarm;
+    for (auto& r : reads) {
+      ASSERT_EQ(0, r.c->wait_for_complete_and_cb());
+    }
+  }
+
+  std::vector<size_t> in_order(reads.size());
+  std::iota(in_order.begin(), in_order.end(), 0);
+  ASSERT_EQ(in_order, completed);
+  for (auto& r : reads) {
+    if (r.cmp) {
+      ASSERT_EQ(-MAX_ERRNO - 100, r.c->get_return_value());
+    } else {
+      ASSERT_EQ((int)r.len, r.c->get_return_value());
+      ASSERT_EQ(r.len, r.bl.length());
+      ASSERT_EQ(0, memcmp(buf + r.off, r.bl.c_str(), r.len));
+    }
+  }
+}
+
 TEST(LibRadosAioEC, RoundTripAppendPP) {
   AioTestDataECPP test_data;
   ASSERT_EQ("", test_data.init());
@@ -635,6 +635,37 @@ TEST_F(LibRadosIoECPP, SparseReadOpPP) {
   }
 }
 
+TEST_F(LibRadosIoECPP, UnalignedReadPP) {
+  // three stripes, no two nearby bytes alike
+  std::string buf(3 * alignment, 0);
+  for (unsigned i = 0; i < buf.size(); ++i) {
+    buf[i] = (char)(i % 251);
+  }
+  bufferlist bl;
+  bl.append(buf);
+  ASSERT_EQ(0, ioctx.write_full("foo", bl));
+
+  // within a stripe, into the next one ending before, in and past the
+  // chunk the read started in, and past the end of the object
+  const std::pair<uint64_t, uint64_t> extents[] = {
+    {1, 10},
+    {alignment - 1, 2},
+    {2, alignment - 1},
+    {alignment / 2, alignment - 1},
+    {alignment + 3, alignment},
+    {alignment - 3, alignment + 7},
+    {2 * alignment + 5, alignment},
+  };
+  for (auto& [off, len] : extents) {
+    bufferlist read_bl;
+    int expected = std::min<uint64_t>(len, buf.size() - off);
+    ASSERT_EQ(expected, ioctx.read("foo", read_bl, len, off))
+      << off << "~" << len;
+    ASSERT_EQ(buf.substr(off, expected), read_bl.to_str())
+      << off << "~" << len;
+  }
+}
+
 TEST_F(LibRadosIoECPP, RoundTripPP) {
   char buf[128];
   Rados cluster;
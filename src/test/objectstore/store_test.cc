@@ -1264,6 +1264,14 @@ TEST_P(StoreTest, CompressionTest) {
   SetVal(g_conf(), "bluestore_compression_mode", "aggressive");
   g_ceph_context->_conf.apply_changes(nullptr);
   doCompressionTest();
+
+  // independently compressed frames, partial reads only decompress part
+  // of a blob
+  SetVal(g_conf(), "bluestore_compression_frame_size", "16384");
+  g_ceph_context->_conf.apply_changes(nullptr);
+  doCompressionTest();
+  SetVal(g_conf(), "bluestore_compression_frame_size", "0");
+  g_ceph_context->_conf.apply_changes(nullptr);
 }
 
 TEST_P(StoreTest, SimpleObjectTest) {
@@ -6832,6 +6840,274 @@ TEST_P(StoreTest, BluestoreOnOffCSumTest) {
     ASSERT_EQ(r, 0);
   }
 }
+
+TEST_P(StoreTest, BluestoreCSumCachedReadTest) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_csum_type", "crc32c");
+  SetVal(g_conf(), "bluestore_default_buffered_read", "true");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  bufferlist orig;
+  orig.append(std::string(65536, 'a'));
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl = orig;
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  auto remount = [&]() {
+    ch.reset();
+    ASSERT_EQ(0, store->umount());
+    ASSERT_EQ(0, store->mount());
+    ch = store->open_collection(cid);
+  };
+  remount();
+
+  const PerfCounters* logger = store->get_perf_counters();
+  bufferlist in;
+  r = store->read(ch, hoid, 0, orig.length(), in);
+  ASSERT_EQ((int)orig.length(), r);
+  ASSERT_TRUE(bl_eq(orig, in));
+  uint64_t verified = logger->get(l_bluestore_csum_verified_bytes);
+  uint64_t skipped = logger->get(l_bluestore_csum_skipped_bytes);
+  ASSERT_GE(verified, orig.length());
+
+  // served from cache, not checked again
+  in.clear();
+  r = store->read(ch, hoid, 0, orig.length(), in);
+  ASSERT_EQ((int)orig.length(), r);
+  ASSERT_TRUE(bl_eq(orig, in));
+  ASSERT_EQ(verified, logger->get(l_bluestore_csum_verified_bytes));
+  ASSERT_EQ(skipped + orig.length(),
+	    logger->get(l_bluestore_csum_skipped_bytes));
+
+  // data cached while checking was off must not be trusted afterwards
+  remount();
+  logger = store->get_perf_counters();
+  SetVal(g_conf(), "bluestore_ignore_data_csum", "true");
+  g_conf().apply_changes(nullptr);
+  in.clear();
+  r = store->read(ch, hoid, 0, orig.length(), in);
+  ASSERT_EQ((int)orig.length(), r);
+  SetVal(g_conf(), "bluestore_ignore_data_csum", "false");
+  g_conf().apply_changes(nullptr);
+  verified = logger->get(l_bluestore_csum_verified_bytes);
+  in.clear();
+  r = store->read(ch, hoid, 0, orig.length(), in);
+  ASSERT_EQ((int)orig.length(), r);
+  ASSERT_TRUE(bl_eq(orig, in));
+  ASSERT_EQ(verified + orig.length(),
+	    logger->get(l_bluestore_csum_verified_bytes));
+
+  // a failed check doesn't count as verified
+  remount();
+  logger = store->get_perf_counters();
+  verified = logger->get(l_bluestore_csum_verified_bytes);
+  SetVal(g_conf(), "bluestore_debug_inject_csum_err_probability", "1");
+  g_conf().apply_changes(nullptr);
+  in.clear();
+  r = store->read(ch, hoid, 0, orig.length(), in);
+  ASSERT_EQ(-EIO, r);
+  ASSERT_EQ(verified, logger->get(l_bluestore_csum_verified_bytes));
+  SetVal(g_conf(), "bluestore_debug_inject_csum_err_probability", "0");
+  g_conf().apply_changes(nullptr);
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTest, BluestoreCompressionDictTest) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_compression_algorithm", "zstd");
+  SetVal(g_conf(), "bluestore_compression_mode", "force");
+  SetVal(g_conf(), "bluestore_compression_dict_train_bytes", "65536");
+  SetVal(g_conf(), "bluestore_compression_dict_size", "8192");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid(spg_t(pg_t(0, 1), shard_id_t::NO_SHARD));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // small objects of similar records, which is what dictionaries are for
+  auto make_data = [](int n) {
+    bufferlist bl;
+    for (int i = 0; bl.length() < 8192; ++i) {
+      std::stringstream ss;
+      ss << "{\"bucket\": \"photos-" << (n % 7) << "\", \"key\": \"img_"
+	 << (n * 131 + i) * 7919 << ".jpg\", \"owner\": \"user" << (i % 13)
+	 << "\", \"size\": " << i * 31 << "}\n";
+      bl.append(ss.str());
+    }
+    return bl;
+  };
+  auto make_oid = [](int n) {
+    return ghobject_t(hobject_t(sobject_t("Object " + stringify(n),
+					  CEPH_NOSNAP)));
+  };
+  int num = 0;
+  auto write = [&]() {
+    ObjectStore::Transaction t;
+    bufferlist bl = make_data(num);
+    t.write(cid, make_oid(num), 0, bl.length(), bl);
+    ++num;
+    return queue_transaction(store, ch, std::move(t));
+  };
+  auto remove = [&](int from, int to) {
+    ObjectStore::Transaction t;
+    for (int n = from; n < to; ++n) {
+      t.remove(cid, make_oid(n));
+    }
+    return queue_transaction(store, ch, std::move(t));
+  };
+  // keep writing until the dictionary trained in the background is in use
+  auto write_until_trained = [&](uint64_t trained) {
+    const PerfCounters* logger = store->get_perf_counters();
+    while (logger->get(l_bluestore_compress_dict_trained) == trained) {
+      ASSERT_LT(num, 10000);
+      ASSERT_EQ(0, write());
+      if (num % 16 == 0) {
+	usleep(10000);
+      }
+    }
+  };
+
+  write_until_trained(0);
+  const PerfCounters* logger = store->get_perf_counters();
+  // the dictionary may be in use before the trained counter says so, but
+  // once it is every later object is compressed with it
+  uint64_t dict_count = logger->get(l_bluestore_compress_dict_count);
+  ASSERT_LE(dict_count, (uint64_t)num);
+  int first_dict = num - dict_count;
+  for (int i = 0; i < 16; ++i) {
+    ASSERT_EQ(0, write());
+  }
+  ASSERT_EQ(dict_count + 16, logger->get(l_bluestore_compress_dict_count));
+
+  ch.reset();
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+  ch = store->open_collection(cid);
+  for (int n = 0; n < num; ++n) {
+    bufferlist in;
+    r = store->read(ch, make_oid(n), 0, 8192 * 2, in);
+    ASSERT_LT(0, r);
+    ASSERT_TRUE(bl_eq(make_data(n), in));
+  }
+
+  // once a new version is in use, the old one goes away with its data
+  SetVal(g_conf(), "bluestore_compression_dict_retrain_bytes", "8192");
+  g_conf().apply_changes(nullptr);
+  logger = store->get_perf_counters();
+  write_until_trained(logger->get(l_bluestore_compress_dict_trained));
+  ASSERT_EQ(0u, logger->get(l_bluestore_compress_dict_pruned));
+  ASSERT_EQ(0, remove(first_dict, num));
+  for (int i = 0; logger->get(l_bluestore_compress_dict_pruned) == 0; ++i) {
+    ASSERT_LT(i, 1000);
+    usleep(10000);
+  }
+  ASSERT_EQ(1u, logger->get(l_bluestore_compress_dict_pruned));
+
+  {
+    ObjectStore::Transaction t;
+    for (int n = 0; n < first_dict; ++n) {
+      t.remove(cid, make_oid(n));
+    }
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
+
+TEST_P(StoreTest, BluestoreCompressedPartialReadTest) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_compression_algorithm", "snappy");
+  SetVal(g_conf(), "bluestore_compression_mode", "force");
+  SetVal(g_conf(), "bluestore_compression_max_blob_size", "262144");
+  SetVal(g_conf(), "bluestore_compression_frame_size", "16384");
+  g_conf().apply_changes(nullptr);
+
+  int r;
+  coll_t cid;
+  ghobject_t hoid(hobject_t(sobject_t("Object 1", CEPH_NOSNAP)));
+  auto ch = store->create_new_collection(cid);
+  {
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  std::string data;
+  data.resize(262144);
+  for (size_t i = 0; i < data.size(); i++)
+    data[i] = i / 256;
+  {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(data);
+    t.write(cid, hoid, 0, bl.length(), bl);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+  // make sure the read isn't served from the buffer cache
+  ch.reset();
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+  ch = store->open_collection(cid);
+
+  const PerfCounters* logger = store->get_perf_counters();
+  uint64_t skipped = logger->get(l_bluestore_decompress_skipped_frames);
+  {
+    // 4K out of the middle of the single 256K blob, i.e. of frame 8 out of 16
+    bufferlist in, expected;
+    r = store->read(ch, hoid, 135168, 4096, in);
+    ASSERT_EQ(4096, r);
+    expected.append(data.substr(135168, 4096));
+    ASSERT_TRUE(bl_eq(expected, in));
+  }
+  ASSERT_EQ(skipped + 15, logger->get(l_bluestore_decompress_skipped_frames));
+  {
+    // straddling two frames
+    bufferlist in, expected;
+    r = store->read(ch, hoid, 32768 - 100, 200, in);
+    ASSERT_EQ(200, r);
+    expected.append(data.substr(32768 - 100, 200));
+    ASSERT_TRUE(bl_eq(expected, in));
+  }
+  ASSERT_EQ(skipped + 15 + 14,
+	    logger->get(l_bluestore_decompress_skipped_frames));
+
+  {
+    ObjectStore::Transaction t;
+    t.remove(cid, hoid);
+    t.remove_collection(cid);
+    r = queue_transaction(store, ch, std::move(t));
+    ASSERT_EQ(r, 0);
+  }
+}
 #endif
 
 INSTANTIATE_TEST_SUITE_P(
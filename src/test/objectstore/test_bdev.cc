@@ -91,6 +91,99 @@ TEST(KernelDevice, Ticket45337) {
   b->close();
 }
 
+#if defined(HAVE_NVME_EMU)
+static std::unique_ptr<BlockDevice> open_bdev(const string& type,
+					      const string& path)
+{
+  g_ceph_context->_conf.set_val_or_die("bdev_type", type);
+  std::unique_ptr<BlockDevice> b(
+    BlockDevice::create(g_ceph_context, path, NULL, NULL,
+      [](void* handle, void* aio) {}, NULL));
+  g_ceph_context->_conf.set_val_or_die("bdev_type", "");
+  int r = b->open(path);
+  if (r < 0) {
+    std::cerr << "open " << path << " as " << type << " failed: "
+	      << cpp_strerror(r) << std::endl;
+    return nullptr;
+  }
+  return b;
+}
+
+// Write a random pattern through one backend and read it back through
+// both; the emulated userspace path has to see exactly what the kernel
+// path sees and vice versa.
+TEST(NVMeEmuDevice, Parity) {
+  uint64_t size = 1048576ull * 64;
+  TempBdev bdev{ size };
+  const uint64_t block_size = 4096;
+
+  for (auto writer : { "aio", "nvme_emu" }) {
+    SCOPED_TRACE(writer);
+    string expected(size, 0);
+    {
+      auto b = open_bdev(writer, bdev.path);
+      ASSERT_TRUE(b);
+      ASSERT_EQ(b->get_block_size(), block_size);
+      IOContext ioc(g_ceph_context, NULL);
+      for (unsigned i = 0; i < 200; ++i) {
+	// up to 1M so that the emulator has to split the command
+	uint64_t len = block_size * (1 + rand() % 256);
+	uint64_t off = block_size * (rand() % ((size - len) / block_size));
+	bufferlist bl;
+	bufferptr bp(len);
+	for (uint64_t j = 0; j < len; ++j) {
+	  bp[j] = rand();
+	}
+	memcpy(&expected[off], bp.c_str(), len);
+	bl.append(bp);
+	if (i % 2) {
+	  ASSERT_EQ(b->write(off, bl, false), 0);
+	} else {
+	  ASSERT_EQ(b->aio_write(off, bl, &ioc, false), 0);
+	  b->aio_submit(&ioc);
+	  ioc.aio_wait();
+	}
+      }
+      ASSERT_EQ(b->flush(), 0);
+      b->close();
+    }
+
+    for (auto reader : { "aio", "nvme_emu" }) {
+      SCOPED_TRACE(reader);
+      auto b = open_bdev(reader, bdev.path);
+      ASSERT_TRUE(b);
+      IOContext ioc(g_ceph_context, NULL);
+
+      bufferlist bl;
+      ASSERT_EQ(b->read(0, size, &bl, &ioc, false), 0);
+      ASSERT_EQ(bl.length(), size);
+      ASSERT_TRUE(bl.contents_equal(expected.c_str(), size));
+
+      std::vector<std::pair<uint64_t, bufferlist>> aios(16);
+      for (auto& [off, abl] : aios) {
+	uint64_t len = block_size * (1 + rand() % 64);
+	off = block_size * (rand() % ((size - len) / block_size));
+	ASSERT_EQ(b->aio_read(off, len, &abl, &ioc), 0);
+      }
+      b->aio_submit(&ioc);
+      ioc.aio_wait();
+      for (auto& [off, abl] : aios) {
+	ASSERT_TRUE(abl.contents_equal(&expected[off], abl.length()));
+      }
+
+      for (unsigned i = 0; i < 100; ++i) {
+	uint64_t len = 1 + rand() % (300 * 1024);
+	uint64_t off = rand() % (size - len);
+	std::vector<char> buf(len);
+	ASSERT_EQ(b->read_random(off, len, buf.data(), false), 0);
+	ASSERT_EQ(memcmp(buf.data(), &expected[off], len), 0);
+      }
+      b->close();
+    }
+  }
+}
+#endif
+
 int main(int argc, char **argv) {
   auto args = argv_to_vec(argc, argv);
   map<string,string> defaults = {
@@ -382,6 +382,51 @@ TEST(bluestore_blob_t, calc_csum)
   }
 }
 
+TEST(bluestore_blob_t, calc_csum_fragmented)
+{
+  // the multi-buffer path only covers blocks that are contiguous in one
+  // segment; results must not depend on how the data is split up.
+  bufferptr bp(65536);
+  for (char *a = bp.c_str(); a < bp.c_str() + bp.length(); ++a)
+    *a = rand();
+  bufferlist contig;
+  contig.append(bp);
+  bufferlist frag;
+  for (unsigned off = 0, len = 1; off < bp.length(); off += len, len += 777) {
+    len = std::min<unsigned>(len, bp.length() - off);
+    frag.append(bufferptr(bp, off, len));
+  }
+  ASSERT_TRUE(contig.contents_equal(frag));
+
+  for (unsigned csum_type = Checksummer::CSUM_NONE + 1;
+       csum_type < Checksummer::CSUM_MAX;
+       ++csum_type) {
+    for (unsigned order : {9, 12}) {
+      bluestore_blob_t a, b;
+      a.init_csum(csum_type, order, contig.length());
+      b.init_csum(csum_type, order, contig.length());
+      a.calc_csum(0, contig);
+      b.calc_csum(0, frag);
+      ASSERT_EQ(a.csum_data.length(), b.csum_data.length());
+      ASSERT_EQ(0, memcmp(a.csum_data.c_str(), b.csum_data.c_str(),
+			  a.csum_data.length()))
+	<< Checksummer::get_csum_type_string(csum_type) << " order " << order;
+
+      int bad_off;
+      uint64_t bad_csum;
+      ASSERT_EQ(0, a.verify_csum(0, frag, &bad_off, &bad_csum));
+      ASSERT_EQ(-1, bad_off);
+
+      // corrupt one block in the middle of a contiguous run
+      bufferlist bad;
+      bad.append(contig.c_str(), contig.length());
+      bad.c_str()[(5 << order) + 3] ^= 1;
+      ASSERT_EQ(-1, a.verify_csum(0, bad, &bad_off, &bad_csum));
+      ASSERT_EQ(5 << order, bad_off);
+    }
+  }
+}
+
 TEST(bluestore_blob_t, csum_bench)
 {
   bufferlist bl;
@@ -393,18 +438,21 @@ TEST(bluestore_blob_t, csum_bench)
   for (unsigned csum_type = 1;
        csum_type < Checksummer::CSUM_MAX;
        ++csum_type) {
-    bluestore_blob_t b;
-    b.init_csum(csum_type, 12, bl.length());
-    ceph::mono_clock::time_point start = ceph::mono_clock::now();
-    for (int i = 0; i<count; ++i) {
-      b.calc_csum(0, bl);
+    for (unsigned order = 12; order <= 16; ++order) {
+      bluestore_blob_t b;
+      b.init_csum(csum_type, order, bl.length());
+      ceph::mono_clock::time_point start = ceph::mono_clock::now();
+      for (int i = 0; i<count; ++i) {
+	b.calc_csum(0, bl);
+      }
+      ceph::mono_clock::time_point end = ceph::mono_clock::now();
+      auto dur = std::chrono::duration_cast<ceph::timespan>(end - start);
+      double mbsec = (double)count * (double)bl.length() / 1000000.0 / (double)dur.count() * 1000000000.0;
+      cout << "csum_type " << Checksummer::get_csum_type_string(csum_type)
+	   << ", chunk " << (1u << order)
+	   << ", " << dur << " seconds, "
+	   << mbsec << " MB/sec" << std::endl;
     }
-    ceph::mono_clock::time_point end = ceph::mono_clock::now();
-    auto dur = std::chrono::duration_cast<ceph::timespan>(end - start);
-    double mbsec = (double)count * (double)bl.length() / 1000000.0 / (double)dur.count() * 1000000000.0;
-    cout << "csum_type " << Checksummer::get_csum_type_string(csum_type)
-	 << ", " << dur << " seconds, "
-	 << mbsec << " MB/sec" << std::endl;
   }
 }
 
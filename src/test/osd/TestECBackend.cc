@@ -17,6 +17,7 @@
 #include <errno.h>
 #include <signal.h>
 #include "osd/ECBackend.h"
+#include "test/erasure-code/ErasureCodeExample.h"
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -60,3 +61,131 @@ TEST(ECUtil, stripe_info_t)
             make_pair((uint64_t)0, 2*swidth));
 }
 
+
+TEST(ECUtil, offset_len_to_chunks)
+{
+  // 4 chunks of 1024
+  ECUtil::stripe_info_t s(4, 4096);
+  auto chunks = [&](uint64_t off, uint64_t len) {
+    set<int> c;
+    s.offset_len_to_chunks(make_pair(off, len), &c);
+    return c;
+  };
+  ASSERT_EQ(chunks(0, 0), set<int>());
+  ASSERT_EQ(chunks(0, 1), set<int>({0}));
+  ASSERT_EQ(chunks(1024, 1024), set<int>({1}));
+  ASSERT_EQ(chunks(4096 + 1000, 100), set<int>({0, 1}));
+  ASSERT_EQ(chunks(3000, 2000), set<int>({0, 2, 3}));
+  ASSERT_EQ(chunks(3000, 4000), set<int>({0, 1, 2, 3}));
+  // crosses into the next stripe at or past the chunk it started in
+  ASSERT_EQ(chunks(1, 4096), set<int>({0, 1, 2, 3}));
+  ASSERT_EQ(chunks(1500, 3700), set<int>({0, 1, 2, 3}));
+  ASSERT_EQ(chunks(4096 + 2048, 4095), set<int>({0, 1, 2, 3}));
+  ASSERT_EQ(chunks(8192, 4096), set<int>({0, 1, 2, 3}));
+}
+
+TEST(ECUtil, decode_partial)
+{
+  // k=2 m=1, chunk size 4
+  ECUtil::stripe_info_t s(2, 8);
+  ErasureCodeInterfaceRef ec_impl(new ErasureCodeExample());
+
+  // two stripes of "abcdefghijklmnop", shard 2 is shard 0 ^ shard 1
+  const string data = "abcdefghijklmnop";
+  map<int, bufferlist> encoded;
+  encoded[0].append(data.substr(0, 4) + data.substr(8, 4));
+  encoded[1].append(data.substr(4, 4) + data.substr(12, 4));
+  string parity(8, 0);
+  for (unsigned i = 0; i < 8; ++i) {
+    parity[i] = encoded[0][i] ^ encoded[1][i];
+  }
+  encoded[2].append(parity);
+
+  auto decode = [&](set<int> shards, uint64_t off, uint64_t len) {
+    map<int, bufferlist> to_decode;
+    for (auto i : shards) {
+      to_decode[i] = encoded[i];
+    }
+    bufferlist out;
+    EXPECT_EQ(ECUtil::decode(s, ec_impl, to_decode, off, len, &out), 0);
+    return out.to_str();
+  };
+  ASSERT_EQ(decode({0, 1, 2}, 5, 6), "fghijk");
+  // a missing data chunk gets decoded
+  ASSERT_EQ(decode({0, 2}, 5, 6), "fghijk");
+  // only the chunk actually read
+  ASSERT_EQ(decode({1}, 12, 3), "mno");
+  ASSERT_EQ(decode({0}, 8, 4), "ijkl");
+  // cut short at the end of the data
+  ASSERT_EQ(decode({1, 2}, 14, 100), "op");
+  ASSERT_EQ(decode({0, 1}, 16, 4), "");
+  // into the next stripe, ending in the chunk it started in
+  ASSERT_EQ(decode({0, 1}, 2, 7), "cdefghi");
+  ASSERT_EQ(decode({0, 2}, 2, 7), "cdefghi");
+  ASSERT_EQ(decode({1, 2}, 2, 7), "cdefghi");
+}
+
+TEST(ECBackend, pipeline_per_object_order)
+{
+  const hobject_t a(object_t("a"), "", CEPH_NOSNAP, 0, 1, "");
+  const hobject_t b(object_t("b"), "", CEPH_NOSNAP, 0, 1, "");
+
+  map<ceph_tid_t, ECBackend::Op> ops;
+  auto make_op = [&](ceph_tid_t tid, const hobject_t &hoid, bool rmw) {
+    ECBackend::Op &op = ops[tid];
+    op.tid = tid;
+    op.hoid = hoid;
+    op.plan.hash_infos[hoid];
+    op.plan.will_write[hoid].insert(0, 4096);
+    if (rmw) {
+      op.plan.to_read[hoid].insert(0, 4096);
+    }
+    return &op;
+  };
+
+  ECBackend::pipeline_state_t state;
+  ECBackend::op_list waiting_state;
+
+  // a clone of a in flight invalidates the cache for a only
+  ECBackend::Op *clone = make_op(1, a, false);
+  clone->plan.invalidates_cache = true;
+  state.start(*clone);
+
+  // interleaved rmws and a full object write
+  waiting_state.push_back(*make_op(2, a, true));
+  waiting_state.push_back(*make_op(3, b, true));
+  waiting_state.push_back(*make_op(4, a, false));
+  waiting_state.push_back(*make_op(5, b, true));
+
+  map<hobject_t, vector<ceph_tid_t>> started;
+  vector<ceph_tid_t> all;
+  auto drain = [&]() {
+    while (ECBackend::Op *op = state.next_ready(waiting_state)) {
+      waiting_state.erase(waiting_state.iterator_to(*op));
+      if (!state.caching_enabled(*op)) {
+	op->using_cache = false;
+      }
+      state.start(*op);
+      started[op->hoid].push_back(op->tid);
+      all.push_back(op->tid);
+    }
+  };
+
+  // the writes to b get past the rmw on a blocked behind the clone, but
+  // the full write to a doesn't get past that rmw
+  drain();
+  ASSERT_EQ(all, vector<ceph_tid_t>({3, 5}));
+  ASSERT_EQ(waiting_state.front().tid, 2u);
+
+  state.finish(*clone);
+  drain();
+  ASSERT_TRUE(waiting_state.empty());
+  ASSERT_EQ(all, vector<ceph_tid_t>({3, 5, 2, 4}));
+  ASSERT_EQ(started[a], vector<ceph_tid_t>({2, 4}));
+  ASSERT_EQ(started[b], vector<ceph_tid_t>({3, 5}));
+
+  for (auto tid : all) {
+    state.finish(ops[tid]);
+  }
+  ASSERT_TRUE(state.is_empty());
+}
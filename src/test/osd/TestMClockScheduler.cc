@@ -1,6 +1,7 @@
 // -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
 
 #include <chrono>
+#include <random>
 
 #include "gtest/gtest.h"
 
@@ -8,6 +9,7 @@
 #include "global/global_init.h"
 #include "common/common_init.h"
 
+#include "osd/scheduler/mClockCostModel.h"
 #include "osd/scheduler/mClockScheduler.h"
 #include "osd/scheduler/OpSchedulerItem.h"
 
@@ -169,3 +171,224 @@ TEST_F(mClockSchedulerTest, TestMultiClientOrderedEnqueueDequeue) {
   }
   ASSERT_TRUE(q.empty());
 }
+
+namespace {
+
+// a device which takes per_io + per_byte * bytes seconds for an op, give
+// or take a few percent
+struct SimulatedDevice {
+  double per_io;
+  double per_byte;
+  std::mt19937 rng{42};
+  std::uniform_int_distribution<uint64_t> sizes{4096, 4 << 20};
+  std::normal_distribution<double> noise{1.0, 0.03};
+
+  void run(mClockCostModel &model, op_scheduler_class c, unsigned ops) {
+    for (unsigned i = 0; i < ops; ++i) {
+      auto bytes = sizes(rng);
+      model.observe(c, bytes, (per_io + per_byte * bytes) * noise(rng));
+    }
+  }
+};
+
+}
+
+TEST(mClockCostModel, LearnsCost) {
+  mClockCostModel model(1000, 100);
+  SimulatedDevice device{100e-6, 0.01e-6};
+  const double default_per_byte = 0.005e-6;
+
+  device.run(model, op_scheduler_class::client, 99);
+  ASSERT_FALSE(model.get_estimate(op_scheduler_class::client,
+				  default_per_byte));
+  device.run(model, op_scheduler_class::client, 1000);
+  auto est = model.get_estimate(op_scheduler_class::client, default_per_byte);
+  ASSERT_TRUE(est);
+  EXPECT_NEAR(device.per_byte, est->per_byte, device.per_byte * 0.05);
+  const double expected = device.per_io + device.per_byte * (1 << 20);
+  EXPECT_NEAR(expected, est->predict(1 << 20), expected * 0.05);
+  // the other classes have not seen any ops
+  ASSERT_FALSE(model.get_estimate(op_scheduler_class::background_recovery,
+				  default_per_byte));
+}
+
+TEST(mClockCostModel, FollowsDevice) {
+  mClockCostModel model(1000, 100);
+  SimulatedDevice device{100e-6, 0.01e-6};
+  device.run(model, op_scheduler_class::background_recovery, 2000);
+  auto before = model.get_estimate(op_scheduler_class::background_recovery, 0);
+  ASSERT_TRUE(before);
+
+  // garbage collection kicks in, and everything takes three times as long
+  device.per_io *= 3;
+  device.per_byte *= 3;
+  device.run(model, op_scheduler_class::background_recovery, 5000);
+  auto after = model.get_estimate(op_scheduler_class::background_recovery, 0);
+  ASSERT_TRUE(after);
+  EXPECT_NEAR(3.0, after->predict(1 << 20) / before->predict(1 << 20), 0.3);
+
+  model.reset();
+  ASSERT_FALSE(model.get_estimate(op_scheduler_class::background_recovery, 0));
+}
+
+TEST(mClockCostModel, SameSizedOps) {
+  mClockCostModel model(1000, 100);
+  for (unsigned i = 0; i < 200; ++i) {
+    model.observe(op_scheduler_class::client, 4096, 200e-6);
+  }
+  // cannot tell the per io cost from the per byte one, take the default
+  auto est = model.get_estimate(op_scheduler_class::client, 0.01e-6);
+  ASSERT_TRUE(est);
+  EXPECT_DOUBLE_EQ(0.01e-6, est->per_byte);
+  EXPECT_NEAR(200e-6, est->predict(4096), 1e-9);
+}
+
+TEST_F(mClockSchedulerTest, TestCalibratedCost) {
+  // the configured costs round to a single io
+  ASSERT_EQ(1, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+
+  auto &conf = g_ceph_context->_conf;
+  conf.set_val_or_die("osd_mclock_cost_calibration", "true");
+  q.set_osd_mclock_cost_calibration();
+  const double capacity =
+    conf.get_val<double>("osd_mclock_max_capacity_iops_ssd") / num_shards;
+  const unsigned threads = conf->osd_op_num_threads_per_shard ?
+    conf->osd_op_num_threads_per_shard :
+    conf->osd_op_num_threads_per_shard_ssd;
+  const auto min_samples =
+    conf.get_val<uint64_t>("osd_mclock_cost_calibration_min_samples");
+  // the device only manages a quarter of its benchmarked capacity
+  const auto elapsed = std::chrono::duration_cast<ceph::timespan>(
+    std::chrono::duration<double>(4 * threads / capacity));
+  for (uint64_t i = 0; i < min_samples; ++i) {
+    q.observe_cost(op_scheduler_class::client, 4096, elapsed);
+  }
+  ASSERT_EQ(4, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+  // which the other classes do not know about yet
+  ASSERT_EQ(1, q.calc_scaled_cost(op_scheduler_class::background_recovery,
+				  4096));
+  conf.rm_val("osd_mclock_cost_calibration");
+}
+
+TEST_F(mClockSchedulerTest, TestUncalibratedCost) {
+  auto &conf = g_ceph_context->_conf;
+  const auto min_samples =
+    conf.get_val<uint64_t>("osd_mclock_cost_calibration_min_samples");
+  const auto slow = std::chrono::duration_cast<ceph::timespan>(
+    std::chrono::seconds(1));
+  const int configured = q.calc_scaled_cost(op_scheduler_class::client, 4096);
+
+  // off by default: the samples are not even kept
+  for (uint64_t i = 0; i < min_samples; ++i) {
+    q.observe_cost(op_scheduler_class::client, 4096, slow);
+  }
+  ASSERT_EQ(configured, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+
+  // on, but short of min_samples
+  conf.set_val_or_die("osd_mclock_cost_calibration", "true");
+  q.set_osd_mclock_cost_calibration();
+  for (uint64_t i = 0; i + 1 < min_samples; ++i) {
+    q.observe_cost(op_scheduler_class::client, 4096, slow);
+  }
+  ASSERT_EQ(configured, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+  q.observe_cost(op_scheduler_class::client, 4096, slow);
+  ASSERT_LT(configured, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+  conf.rm_val("osd_mclock_cost_calibration");
+  q.set_osd_mclock_cost_calibration();
+}
+
+TEST_F(mClockSchedulerTest, TestCalibratedCostPerByteFallback) {
+  auto &conf = g_ceph_context->_conf;
+  conf.set_val_or_die("osd_mclock_cost_calibration", "true");
+  q.set_osd_mclock_cost_calibration();
+  // 1us per byte, whatever the device
+  conf.set_val_or_die("osd_mclock_cost_per_byte_usec", "1");
+  q.set_osd_mclock_cost_per_byte();
+
+  const double capacity =
+    conf.get_val<double>("osd_mclock_max_capacity_iops_ssd") / num_shards;
+  const unsigned threads = conf->osd_op_num_threads_per_shard ?
+    conf->osd_op_num_threads_per_shard :
+    conf->osd_op_num_threads_per_shard_ssd;
+  const auto min_samples =
+    conf.get_val<uint64_t>("osd_mclock_cost_calibration_min_samples");
+  // ops of a single size can't tell the cost per byte, the configured
+  // one is used, in seconds
+  const double secs = 0.01;
+  for (uint64_t i = 0; i < min_samples; ++i) {
+    q.observe_cost(op_scheduler_class::client, 4096,
+		   std::chrono::duration_cast<ceph::timespan>(
+		     std::chrono::duration<double>(secs)));
+  }
+  const int cost = 1 << 20;
+  const double predicted = secs + 1e-6 * (cost - 4096);
+  ASSERT_NEAR(predicted * capacity / threads,
+	      q.calc_scaled_cost(op_scheduler_class::client, cost),
+	      1);
+  conf.rm_val("osd_mclock_cost_per_byte_usec");
+  q.set_osd_mclock_cost_per_byte();
+  conf.rm_val("osd_mclock_cost_calibration");
+  q.set_osd_mclock_cost_calibration();
+}
+
+TEST_F(mClockSchedulerTest, TestStoreCostSamples) {
+  auto &conf = g_ceph_context->_conf;
+  // nobody to gather samples for
+  ASSERT_FALSE(q.observes_cost());
+  conf.set_val_or_die("osd_mclock_cost_calibration", "true");
+  q.set_osd_mclock_cost_calibration();
+  ASSERT_TRUE(q.observes_cost());
+
+  const double capacity =
+    conf.get_val<double>("osd_mclock_max_capacity_iops_ssd") / num_shards;
+  const unsigned threads = conf->osd_op_num_threads_per_shard ?
+    conf->osd_op_num_threads_per_shard :
+    conf->osd_op_num_threads_per_shard_ssd;
+  const auto min_samples =
+    conf.get_val<uint64_t>("osd_mclock_cost_calibration_min_samples");
+  // the time of one io at the benchmarked capacity
+  auto ios = [&](double n) {
+    return std::chrono::duration_cast<ceph::timespan>(
+      std::chrono::duration<double>(n * threads / capacity));
+  };
+  auto run = [&](op_scheduler_class class_id, ceph::timespan read,
+		 bool write) -> Context* {
+    OpStoreCost::RunningGuard running(
+      std::make_shared<OpStoreCost>(&q, class_id, 4096));
+    if (read.count()) {
+      OpStoreCost::get_running()->add(read);
+    }
+    return write ? OpStoreCost::commit_timer() : nullptr;
+  };
+
+  // recovery reads take twice the benchmarked time, client ops read
+  // three times it and write, best effort ops never get to the store
+  for (uint64_t i = 0; i + 1 < min_samples; ++i) {
+    ASSERT_EQ(nullptr, run(op_scheduler_class::background_recovery, ios(2),
+			   false));
+    Context *commit = run(op_scheduler_class::client, ios(3), true);
+    ASSERT_NE(nullptr, commit);
+    commit->complete(0);
+    ASSERT_EQ(nullptr, run(op_scheduler_class::background_best_effort,
+			   ceph::timespan::zero(), false));
+  }
+  ASSERT_EQ(nullptr, run(op_scheduler_class::background_recovery, ios(2),
+			 false));
+  ASSERT_EQ(2, q.calc_scaled_cost(op_scheduler_class::background_recovery,
+				  4096));
+
+  // the last client op is only sampled once its transaction commits
+  Context *commit = run(op_scheduler_class::client, ios(3), true);
+  ASSERT_EQ(1, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+  commit->complete(0);
+  ASSERT_EQ(3, q.calc_scaled_cost(op_scheduler_class::client, 4096));
+
+  ASSERT_EQ(1, q.calc_scaled_cost(op_scheduler_class::background_best_effort,
+				  4096));
+  // nothing is running outside of the shard worker
+  ASSERT_FALSE(OpStoreCost::get_running());
+  ASSERT_EQ(nullptr, OpStoreCost::commit_timer());
+
+  conf.rm_val("osd_mclock_cost_calibration");
+  q.set_osd_mclock_cost_calibration();
+}
@@ -411,6 +411,63 @@ TEST_F(OSDMapTest, CleanTemps) {
 	      !pending_inc.new_primary_temp.count(pgb));
 }
 
+TEST_F(OSDMapTest, CopyOnWrite) {
+  set_up_map();
+  const uint64_t features =
+    CEPH_FEATURES_SUPPORTED_DEFAULT | CEPH_FEATURE_RESERVED;
+  bufferlist orig_bl;
+  osdmap.encode(orig_bl, features);
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  vector<int> up_osds, acting_osds;
+  int up_primary, acting_primary;
+  osdmap.pg_to_up_acting_osds(pgid, &up_osds, &up_primary,
+			      &acting_osds, &acting_primary);
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.fsid = osdmap.get_fsid();
+  inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>(
+    up_osds.rbegin(), up_osds.rend());
+  inc.new_primary_temp[pgid] = up_osds.back();
+  inc.new_pg_upmap[pgid] = mempool::osdmap::vector<int32_t>(
+    up_osds.rbegin(), up_osds.rend());
+  inc.new_primary_affinity[0] = 0;
+  inc.new_state[1] = CEPH_OSD_UP;
+
+  OSDMap cow;
+  cow.cow_copy_from(osdmap);
+  ASSERT_EQ(0, cow.apply_incremental(inc));
+  OSDMap decoded;
+  decoded.decode(orig_bl);
+  ASSERT_EQ(0, decoded.apply_incremental(inc));
+
+  // the copy ends up where a decoded map would, and the previous epoch
+  // stays as it was
+  bufferlist bl, cow_bl, decoded_bl;
+  osdmap.encode(bl, features);
+  ASSERT_TRUE(bl.contents_equal(orig_bl));
+  cow.encode(cow_bl, features);
+  decoded.encode(decoded_bl, features);
+  ASSERT_TRUE(cow_bl.contents_equal(decoded_bl));
+  ASSERT_FALSE(cow_bl.contents_equal(orig_bl));
+  // crush was left alone, so it is still shared
+  ASSERT_EQ(osdmap.crush, cow.crush);
+
+  // a full map decoded over a copy does not leak into the maps it shares
+  // its containers with
+  OSDMap next;
+  next.cow_copy_from(cow);
+  OSDMap::Incremental full(cow.get_epoch() + 1);
+  full.fsid = cow.get_fsid();
+  full.fullmap = orig_bl;
+  ASSERT_EQ(0, next.apply_incremental(full));
+  bl.clear();
+  cow.encode(bl, features);
+  ASSERT_TRUE(bl.contents_equal(cow_bl));
+  bl.clear();
+  osdmap.encode(bl, features);
+  ASSERT_TRUE(bl.contents_equal(orig_bl));
+}
+
 TEST_F(OSDMapTest, KeepsNecessaryTemps) {
   set_up_map();
 
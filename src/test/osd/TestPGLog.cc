@@ -274,7 +274,7 @@ public:
     }
   }
 
-  void test_merge_log(const TestCase &tcase) {
+  void test_merge_log(const TestCase &tcase, LogHandler *handler = nullptr) {
     clear();
     log = tcase.get_fulldiv();
     pg_info_t info = tcase.get_divinfo();
@@ -286,7 +286,8 @@ public:
     olog = tcase.get_fullauth();
     pg_info_t oinfo = tcase.get_authinfo();
 
-    LogHandler h;
+    LogHandler local_handler;
+    LogHandler &h = handler ? *handler : local_handler;
     bool dirty_info = false;
     bool dirty_big_info = false;
     merge_log(
@@ -2019,6 +2020,69 @@ TEST_F(PGLogTest, merge_log_prior_version_have) {
   run_test_case(t);
 }
 
+TEST_F(PGLogTest, merge_log_divergent_regions) {
+  TestCase t;
+  t.base.push_back(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(8, 80)));
+
+  // divergent writes which recorded what they changed keep the object
+  auto e = mk_ple_mod(mk_obj(1), mk_evt(10, 101), mk_evt(10, 100));
+  e.clean_regions.mark_data_region_dirty(0, 4096);
+  t.div.push_back(e);
+  e = mk_ple_mod(mk_obj(1), mk_evt(10, 102), mk_evt(10, 101));
+  e.clean_regions.mark_data_region_dirty(65536, 4096);
+  t.div.push_back(e);
+
+  t.final.add(mk_obj(1), mk_evt(10, 100), mk_evt(0, 0), false);
+
+  t.setup();
+  set_keep_divergent_regions(true);
+  LogHandler h;
+  test_merge_log(t, &h);
+  EXPECT_EQ(0u, h.removed.count(mk_obj(1)));
+  interval_set<uint64_t> dirty;
+  dirty.insert(0, 4096);
+  dirty.insert(65536, 4096);
+  const auto& item = missing.get_items().at(mk_obj(1));
+  EXPECT_EQ(dirty, item.clean_regions.get_dirty_regions());
+  EXPECT_TRUE(item.clean_regions.object_is_exist());
+  EXPECT_FALSE(item.clean_regions.omap_is_dirty());
+  test_proc_replica_log(t);
+  set_keep_divergent_regions(false);
+}
+
+TEST_F(PGLogTest, merge_log_divergent_regions_old_peer) {
+  TestCase t;
+  t.base.push_back(mk_ple_mod(mk_obj(1), mk_evt(10, 100), mk_evt(8, 80)));
+
+  auto e = mk_ple_mod(mk_obj(1), mk_evt(10, 101), mk_evt(10, 100));
+  e.clean_regions.mark_data_region_dirty(0, 4096);
+  t.div.push_back(e);
+
+  // some OSD of the pg would remove the object, so everyone does, and
+  // the primary recovers all of it
+  t.final.add(mk_obj(1), mk_evt(10, 100), mk_evt(0, 0), false);
+  t.toremove.insert(mk_obj(1));
+
+  t.setup();
+  LogHandler h;
+  test_merge_log(t, &h);
+  EXPECT_EQ(1u, h.removed.count(mk_obj(1)));
+  EXPECT_FALSE(
+    missing.get_items().at(mk_obj(1)).clean_regions.object_is_exist());
+
+  // the primary's view of a replica which removed the object
+  clear();
+  log = t.get_fullauth();
+  pg_missing_t omissing = t.init;
+  IndexedLog olog = t.get_fulldiv();
+  pg_info_t oinfo = t.get_divinfo();
+  proc_replica_log(oinfo, olog, omissing, pg_shard_t(1, shard_id_t(0)));
+  const auto& item = omissing.get_items().at(mk_obj(1));
+  EXPECT_EQ(mk_evt(10, 100), item.need);
+  EXPECT_FALSE(item.clean_regions.object_is_exist());
+  EXPECT_TRUE(item.clean_regions.omap_is_dirty());
+}
+
 TEST_F(PGLogTest, merge_log_split_missing_entries_at_head) {
   TestCase t;
   t.auth.push_back(mk_ple_mod_rb(mk_obj(1), mk_evt(10, 100), mk_evt(8, 70)));
@@ -2768,6 +2832,46 @@ TEST_F(PGLogTrimTest, TestTrimNoTrimmed) {
   EXPECT_EQ(2u, log.dups.size());
 }
 
+TEST_F(PGLogTrimTest, TestIndexAndRollForward)
+{
+  SetUp(20);
+  PGLog::IndexedLog log;
+  log.head = mk_evt(9, 0);
+
+  const hobject_t obj1 = mk_obj(1);
+  for (auto [oid, v, pv] : {std::tuple{obj1, mk_evt(10, 100), mk_evt(8, 70)},
+			    std::tuple{obj1, mk_evt(10, 101), mk_evt(10, 100)},
+			    std::tuple{mk_obj(2), mk_evt(10, 102), mk_evt(8, 80)}}) {
+    auto e = mk_ple_mod_rb(oid, v, pv);
+    e.mod_desc.append(4096);
+    log.add(e);
+  }
+
+  // the index is keyed by the soid of the newest entry of each object
+  auto it = log.objects.find(obj1);
+  ASSERT_NE(log.objects.end(), it);
+  EXPECT_EQ(mk_evt(10, 101), it->second->version);
+  EXPECT_EQ(&it->second->soid, &it->first.get());
+
+  // rolled forward entries drop their rollback info
+  list<hobject_t> removed;
+  TestHandler h(removed);
+  log.roll_forward_to(mk_evt(10, 101), &h);
+  for (const auto& e : log.log) {
+    bool rolled_forward = e.version <= mk_evt(10, 101);
+    EXPECT_EQ(rolled_forward, !e.can_rollback());
+    EXPECT_EQ(rolled_forward, e.mod_desc.bl.length() == 0);
+  }
+
+  // trimming an older entry of an object leaves its index intact
+  log.trim(cct, mk_evt(10, 100), nullptr, nullptr, nullptr);
+  EXPECT_EQ(2u, log.log.size());
+  it = log.objects.find(obj1);
+  ASSERT_NE(log.objects.end(), it);
+  EXPECT_EQ(&log.log.front(), it->second);
+  EXPECT_EQ(&log.log.front().soid, &it->first.get());
+}
+
 
 TEST_F(PGLogTrimTest, TestTrimNoDups)
 {
@@ -2938,7 +3042,7 @@ TEST_F(PGLogTest, _merge_object_divergent_entries) {
                                     orig_entries, oinfo,
                                     log.get_can_rollback_to(),
                                     missing, &rollbacker,
-                                    this);
+                                    false, this);
     // No core dump
   }
   {
@@ -2964,7 +3068,7 @@ TEST_F(PGLogTest, _merge_object_divergent_entries) {
                                     orig_entries, oinfo,
                                     log.get_can_rollback_to(),
                                     missing, &rollbacker,
-                                    this);
+                                    false, this);
     // No core dump
   }
 }
@@ -0,0 +1,130 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+/*
+ * Throughput of the object context cache lookups get_object_context()
+ * does, SharedLRU against ShardedSharedLRU, with a few hot objects
+ * taking most of the lookups the way bucket index or rbd header
+ * objects do.
+ */
+
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/ceph_argparse.h"
+#include "common/Clock.h"
+#include "common/shared_cache.hpp"
+#include "common/sharded_shared_cache.hpp"
+#include "global/global_init.h"
+#include "osd/osd_internal_types.h"
+
+using namespace std;
+
+namespace {
+
+struct workload_t {
+  unsigned threads;
+  unsigned lookups;
+  unsigned objects;
+  unsigned hot;
+};
+
+vector<hobject_t> make_oids(unsigned objects)
+{
+  vector<hobject_t> oids;
+  for (unsigned i = 0; i < objects; ++i) {
+    oids.emplace_back(object_t("obj" + to_string(i)), "", CEPH_NOSNAP, i, 1, "");
+  }
+  return oids;
+}
+
+template <typename Cache>
+double run(Cache& cache, const vector<hobject_t>& oids, const workload_t& w)
+{
+  vector<thread> threads;
+  std::atomic<bool> go{false};
+  for (unsigned t = 0; t < w.threads; ++t) {
+    threads.emplace_back([&cache, &oids, &w, &go, t] {
+      mt19937 rng{t};
+      uniform_int_distribution<unsigned> pct{0, 99};
+      uniform_int_distribution<unsigned> hot{0, w.hot - 1};
+      uniform_int_distribution<unsigned> any{0, w.objects - 1};
+      while (!go) {
+	this_thread::yield();
+      }
+      for (unsigned i = 0; i < w.lookups; ++i) {
+	// 90% of the lookups go to the hot objects
+	const auto& oid = oids[pct(rng) < 90 ? hot(rng) : any(rng)];
+	ObjectContextRef obc = cache.lookup(oid);
+	if (!obc) {
+	  obc = cache.lookup_or_create(oid);
+	}
+      }
+    });
+  }
+  utime_t start = ceph_clock_now();
+  go = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  double elapsed = ceph_clock_now() - start;
+  return double(w.threads) * w.lookups / elapsed;
+}
+
+void usage(const char *name)
+{
+  cout << name << " <threads> <lookups> [objects] [hot objects]\n"
+       << "\t threads: the number of threads looking up object contexts\n"
+       << "\t lookups: the number of lookups per thread\n"
+       << "\t objects: the number of objects (default 4096)\n"
+       << "\t hot objects: the number of objects taking 90% of the lookups"
+       << " (default 8)\n";
+}
+
+}
+
+int main(int argc, const char **argv)
+{
+  if (argc < 3) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  workload_t w;
+  w.threads = atoi(argv[1]);
+  w.lookups = atoi(argv[2]);
+  w.objects = argc > 3 ? atoi(argv[3]) : 4096;
+  w.hot = argc > 4 ? atoi(argv[4]) : 8;
+  if (!w.threads || !w.objects || !w.hot || w.hot > w.objects) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_OSD,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  const auto& conf = cct->_conf;
+  const auto min_size = conf->osd_pg_object_context_cache_count;
+  const auto max_size =
+    conf.get_val<uint64_t>("osd_pg_object_context_cache_max_count");
+  const auto shards =
+    conf.get_val<uint64_t>("osd_pg_object_context_cache_shards");
+  const auto oids = make_oids(w.objects);
+
+  cout << w.threads << " threads, " << w.lookups << " lookups per thread, "
+       << w.hot << " hot objects out of " << w.objects << std::endl;
+  {
+    SharedLRU<hobject_t, ObjectContext> cache{cct.get(), size_t(min_size)};
+    cout << "SharedLRU: " << run(cache, oids, w) << " lookups/s" << std::endl;
+  }
+  {
+    ShardedSharedLRU<hobject_t, ObjectContext> cache{
+      cct.get(), size_t(min_size), max_size, unsigned(shards)};
+    cout << "ShardedSharedLRU: " << run(cache, oids, w) << " lookups/s, "
+	 << "capacity " << cache.get_capacity() << std::endl;
+  }
+  return 0;
+}
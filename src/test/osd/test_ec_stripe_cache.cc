@@ -0,0 +1,132 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <gtest/gtest.h>
+#include "osd/ECStripeCache.h"
+#include "global/global_context.h"
+#include "common/config_proxy.h"
+
+using namespace std;
+
+static extent_map stripes(uint64_t off, uint64_t len, char c)
+{
+  bufferlist bl;
+  bl.append(string(len, c));
+  extent_map out;
+  out.insert(off, len, bl);
+  return out;
+}
+
+static extent_set want(uint64_t off, uint64_t len)
+{
+  extent_set out;
+  out.insert(off, len);
+  return out;
+}
+
+static hobject_t obj(const char *name)
+{
+  return hobject_t(object_t(name), "", CEPH_NOSNAP, 0, 1, "");
+}
+
+TEST(ECStripeCache, put_get)
+{
+  ECStripeCache cache(g_ceph_context);
+  pg_t pgid(0, 1);
+
+  ASSERT_TRUE(cache.get(pgid, obj("a"), want(0, 8192)).empty());
+
+  cache.put(pgid, obj("a"), stripes(4096, 4096, 'a'));
+  ASSERT_EQ(4096u, cache.get_bytes());
+
+  extent_map hit = cache.get(pgid, obj("a"), want(0, 16384));
+  ASSERT_EQ(want(4096, 4096), hit.get_interval_set());
+  ASSERT_EQ('a', hit.begin().get_val()[0]);
+
+  // a later write of the same stripe replaces it
+  cache.put(pgid, obj("a"), stripes(4096, 8192, 'b'));
+  ASSERT_EQ(8192u, cache.get_bytes());
+  hit = cache.get(pgid, obj("a"), want(4096, 4096));
+  ASSERT_EQ(want(4096, 4096), hit.get_interval_set());
+  ASSERT_EQ('b', hit.begin().get_val()[0]);
+
+  // other pgs and objects don't see it
+  ASSERT_TRUE(cache.get(pg_t(1, 1), obj("a"), want(4096, 4096)).empty());
+  ASSERT_TRUE(cache.get(pgid, obj("b"), want(4096, 4096)).empty());
+}
+
+TEST(ECStripeCache, invalidate)
+{
+  ECStripeCache cache(g_ceph_context);
+  pg_t pg1(0, 1), pg2(1, 1);
+
+  cache.put(pg1, obj("a"), stripes(0, 4096, 'a'));
+  cache.put(pg1, obj("b"), stripes(0, 4096, 'b'));
+  cache.put(pg2, obj("a"), stripes(0, 4096, 'c'));
+  ASSERT_EQ(3 * 4096u, cache.get_bytes());
+
+  cache.invalidate(pg1, obj("a"));
+  ASSERT_TRUE(cache.get(pg1, obj("a"), want(0, 4096)).empty());
+  ASSERT_FALSE(cache.get(pg1, obj("b"), want(0, 4096)).empty());
+
+  cache.clear_pg(pg1);
+  ASSERT_TRUE(cache.get(pg1, obj("b"), want(0, 4096)).empty());
+  ASSERT_FALSE(cache.get(pg2, obj("a"), want(0, 4096)).empty());
+  ASSERT_EQ(4096u, cache.get_bytes());
+
+  cache.clear();
+  ASSERT_EQ(0u, cache.get_bytes());
+}
+
+TEST(ECStripeCache, trim)
+{
+  g_ceph_context->_conf.set_val_or_die("osd_ec_stripe_cache_size", "8192");
+  ECStripeCache cache(g_ceph_context);
+  pg_t pgid(0, 1);
+
+  cache.put(pgid, obj("a"), stripes(0, 4096, 'a'));
+  cache.put(pgid, obj("b"), stripes(0, 4096, 'b'));
+  // touch a so b is the oldest
+  ASSERT_FALSE(cache.get(pgid, obj("a"), want(0, 4096)).empty());
+  cache.put(pgid, obj("c"), stripes(0, 4096, 'c'));
+
+  ASSERT_EQ(8192u, cache.get_bytes());
+  ASSERT_FALSE(cache.get(pgid, obj("a"), want(0, 4096)).empty());
+  ASSERT_TRUE(cache.get(pgid, obj("b"), want(0, 4096)).empty());
+  ASSERT_FALSE(cache.get(pgid, obj("c"), want(0, 4096)).empty());
+
+  g_ceph_context->_conf.set_val_or_die("osd_ec_stripe_cache_size", "0");
+  cache.put(pgid, obj("d"), stripes(0, 4096, 'd'));
+  ASSERT_TRUE(cache.get(pgid, obj("d"), want(0, 4096)).empty());
+  g_ceph_context->_conf.rm_val("osd_ec_stripe_cache_size");
+}
+
+TEST(ECStripeCache, request_cache_bytes)
+{
+  g_ceph_context->_conf.set_val_or_die("osd_ec_stripe_cache_size", "65536");
+  ECStripeCache cache(g_ceph_context);
+  auto pricache = cache.get_pricache();
+
+  ASSERT_EQ(-EOPNOTSUPP,
+	    pricache->request_cache_bytes(PriorityCache::Priority::PRI0, 0));
+  // an empty cache still asks for its whole budget, so it can grow into it
+  ASSERT_EQ(0u, cache.get_bytes());
+  ASSERT_EQ(65536,
+	    pricache->request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  pricache->set_cache_bytes(PriorityCache::Priority::PRI1, 16384);
+  ASSERT_EQ(65536 - 16384,
+	    pricache->request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  pricache->set_cache_bytes(PriorityCache::Priority::PRI1, 65536);
+  ASSERT_EQ(0,
+	    pricache->request_cache_bytes(PriorityCache::Priority::PRI1, 0));
+  g_ceph_context->_conf.rm_val("osd_ec_stripe_cache_size");
+}
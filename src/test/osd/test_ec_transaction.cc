@@ -15,6 +15,7 @@
 #include <gtest/gtest.h>
 #include "osd/PGTransaction.h"
 #include "osd/ECTransaction.h"
+#include "test/erasure-code/ErasureCodeExample.h"
 
 #include "test/unit.cc"
 
@@ -122,3 +123,51 @@ TEST(ectransaction, many_writes)
   ASSERT_EQ(0u, plan.to_read.size());
   ASSERT_EQ(1u, plan.will_write.size());
 }
+
+TEST(ectransaction, parity_delta)
+{
+  hobject_t h;
+  ECUtil::stripe_info_t sinfo(2, 8192);
+  ceph::ErasureCodeInterfaceRef ecimpl(new ErasureCodeExample());
+  auto get_plan = [&](uint64_t off, uint64_t len) {
+    PGTransactionUPtr t(new PGTransaction);
+    bufferlist a;
+    a.append_zero(len);
+    t->write(h, off, a.length(), a, 0);
+    return ECTransaction::get_write_plan(
+      sinfo,
+      std::move(t),
+      [&](const hobject_t &i) {
+	ECUtil::HashInfoRef ref(new ECUtil::HashInfo(3));
+	ref->set_total_chunk_size_clear_hash(32768);
+	ref->set_projected_total_logical_size(sinfo, 65536);
+	return ref;
+      },
+      &dpp);
+  };
+
+  // 512 bytes in the second chunk of the first stripe: read and write
+  // that chunk and the parity chunk instead of 2 reads and 3 writes
+  {
+    auto plan = get_plan(4096, 512);
+    ASSERT_EQ(1u, plan.to_read.size());
+    ASSERT_TRUE(ECTransaction::plan_parity_delta(sinfo, ecimpl, plan, &dpp));
+    ASSERT_EQ(1u, plan.parity_deltas.size());
+    auto &delta = plan.parity_deltas.begin()->second;
+    ASSERT_EQ(plan.to_read[h], delta.stripes);
+    ASSERT_EQ(std::set<int>({1, 2}), delta.shards);
+  }
+
+  // both data chunks: no cheaper than encoding the stripe
+  {
+    auto plan = get_plan(2048, 4096);
+    ASSERT_FALSE(ECTransaction::plan_parity_delta(sinfo, ecimpl, plan, &dpp));
+    ASSERT_TRUE(plan.parity_deltas.empty());
+  }
+
+  // extends the object
+  {
+    auto plan = get_plan(65536 - 512, 1024);
+    ASSERT_FALSE(ECTransaction::plan_parity_delta(sinfo, ecimpl, plan, &dpp));
+  }
+}
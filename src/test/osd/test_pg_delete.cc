@@ -0,0 +1,24 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <climits>
+
+#include "gtest/gtest.h"
+
+#include "osd/PG.h"
+
+TEST(PGDelete, list_max)
+{
+  // osd_target_transaction_size, capped by the ObjectStore's ideal
+  // listing size, unless a batch size is set
+  ASSERT_EQ(30, PG::get_delete_list_max(64, 30, 0));
+  ASSERT_EQ(64, PG::get_delete_list_max(64, 128, 0));
+  ASSERT_EQ(10, PG::get_delete_list_max(64, 30, 10));
+  ASSERT_EQ(50, PG::get_delete_list_max(64, 30, 50));
+  // which is taken as is
+  ASSERT_EQ(128, PG::get_delete_list_max(64, 30, 128));
+  ASSERT_EQ(65536, PG::get_delete_list_max(64, 30, 65536));
+  // and can't overflow the listing size
+  ASSERT_EQ(INT_MAX, PG::get_delete_list_max(64, 30, 1ull << 32));
+  ASSERT_EQ(INT_MAX, PG::get_delete_list_max(64, 30, UINT64_MAX));
+}
@@ -0,0 +1,48 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "gtest/gtest.h"
+
+#include "osd/OSD.h"
+
+TEST(RecoveryPacing, bytes_sleep)
+{
+  const uint64_t rate = 1 << 20;
+  const float max_sleep = 60;
+  uint64_t scheduled = 0;
+
+  // no pacing, but the counter is followed
+  ASSERT_FLOAT_EQ(0, recovery_bytes_sleep(1ull << 40, &scheduled, 0,
+					  max_sleep));
+  ASSERT_EQ(1ull << 40, scheduled);
+
+  // turning it on only charges the bytes recovered from then on
+  ASSERT_FLOAT_EQ(1, recovery_bytes_sleep((1ull << 40) + (1 << 20),
+					  &scheduled, rate, max_sleep));
+  // nothing recovered since the previous op was scheduled
+  ASSERT_FLOAT_EQ(0, recovery_bytes_sleep((1ull << 40) + (1 << 20),
+					  &scheduled, rate, max_sleep));
+  ASSERT_FLOAT_EQ(0.5, recovery_bytes_sleep((1ull << 40) + (3 << 19),
+					    &scheduled, rate, max_sleep));
+}
+
+TEST(RecoveryPacing, bytes_sleep_counter_reset)
+{
+  const uint64_t rate = 1 << 20;
+  const float max_sleep = 60;
+  uint64_t scheduled = 1ull << 40;
+
+  // perf reset zeroed the counter
+  ASSERT_FLOAT_EQ(0, recovery_bytes_sleep(0, &scheduled, rate, max_sleep));
+  ASSERT_EQ(0u, scheduled);
+  ASSERT_FLOAT_EQ(2, recovery_bytes_sleep(2 << 20, &scheduled, rate,
+					  max_sleep));
+}
+
+TEST(RecoveryPacing, bytes_sleep_capped)
+{
+  uint64_t scheduled = 0;
+  ASSERT_FLOAT_EQ(60, recovery_bytes_sleep(1ull << 40, &scheduled, 1 << 20,
+					   60));
+  ASSERT_EQ(1ull << 40, scheduled);
+}
@@ -755,6 +755,106 @@ for (unsigned i = 0; i < 4; ++i) {
 } // end for, didn't want to reindent
 }
 
+TEST(pg_interval_t, skipped_up_thru)
+{
+  //
+  // The primary of the old interval gets its up_thru bumped into the
+  // interval in a map that a pg skips.  Closing the interval against the
+  // map before it would lose maybe_went_rw, so the map must not be
+  // skippable.
+  //
+  int osd_id = 1;
+  int other_osd = osd_id + 4;
+  epoch_t epoch = 40;
+  int64_t pool_id = 200;
+  int pg_num = 4;
+  auto make_map = [&](epoch_t up_thru, epoch_t other_up_thru) {
+    std::shared_ptr<OSDMap> osdmap(new OSDMap());
+    osdmap->set_max_osd(10);
+    osdmap->set_state(osd_id, CEPH_OSD_EXISTS);
+    osdmap->set_state(osd_id + 1, CEPH_OSD_EXISTS);
+    osdmap->set_state(other_osd, CEPH_OSD_EXISTS);
+    osdmap->set_epoch(epoch);
+    OSDMap::Incremental inc(epoch + 1);
+    inc.new_pools[pool_id].min_size = 2;
+    inc.new_pools[pool_id].set_pg_num(pg_num);
+    inc.new_pools[pool_id].set_pg_num_pending(pg_num);
+    inc.new_up_thru[osd_id] = up_thru;
+    inc.new_up_thru[other_osd] = other_up_thru;
+    osdmap->apply_incremental(inc);
+    return osdmap;
+  };
+  epoch_t same_interval_since = epoch;
+  epoch_t last_epoch_clean = epoch - 10;
+  std::shared_ptr<OSDMap> stale = make_map(epoch - 10, 0);
+  std::shared_ptr<OSDMap> bumped = make_map(epoch, 0);
+  std::shared_ptr<OSDMap> unrelated = make_map(epoch - 10, epoch);
+  boost::scoped_ptr<IsPGRecoverablePredicate> recoverable(new ReplicatedBackend::RPCRecPred());
+  vector<int> old_acting = {osd_id, osd_id + 1};
+  vector<int> old_up = old_acting;
+  vector<int> new_acting = {osd_id + 1};
+  vector<int> new_up = new_acting;
+  pg_t pgid;
+  pgid.set_pool(pool_id);
+
+  ASSERT_TRUE(PastIntervals::interval_inputs_changed(
+    old_acting, old_up, bumped.get(), stale.get(), pgid));
+  ASSERT_FALSE(PastIntervals::interval_inputs_changed(
+    old_acting, old_up, unrelated.get(), stale.get(), pgid));
+  ASSERT_FALSE(PastIntervals::interval_inputs_changed(
+    old_acting, old_up, stale.get(), stale.get(), pgid));
+
+  //
+  // The interval closed out against the map with the bump
+  //
+  {
+    ostringstream out;
+    PastIntervals past_intervals;
+    ASSERT_TRUE(PastIntervals::check_new_interval(osd_id,
+						  osd_id + 1,
+						  old_acting,
+						  new_acting,
+						  osd_id,
+						  osd_id + 1,
+						  old_up,
+						  new_up,
+						  same_interval_since,
+						  last_epoch_clean,
+						  bumped,
+						  bumped,
+						  pgid,
+						  *recoverable,
+						  &past_intervals,
+						  &out));
+    ASSERT_NE(string::npos, out.str().find("includes interval"));
+  }
+
+  //
+  // The same interval closed out against the map before the bump
+  //
+  {
+    ostringstream out;
+    PastIntervals past_intervals;
+    ASSERT_TRUE(PastIntervals::check_new_interval(osd_id,
+						  osd_id + 1,
+						  old_acting,
+						  new_acting,
+						  osd_id,
+						  osd_id + 1,
+						  old_up,
+						  new_up,
+						  same_interval_since,
+						  last_epoch_clean,
+						  bumped,
+						  stale,
+						  pgid,
+						  *recoverable,
+						  &past_intervals,
+						  &out));
+    ASSERT_NE(string::npos, out.str().find("does not include interval"));
+  }
+}
+
 TEST(pg_t, get_ancestor)
 {
   ASSERT_EQ(pg_t(0, 0), pg_t(16, 0).get_ancestor(16));
@@ -78,6 +78,15 @@ TEST(Arch, all)
   expected = strstr(flags, " sse2 ") ? 1 : 0;
   EXPECT_EQ(expected, ceph_arch_intel_sse2);
 
+  expected = strstr(flags, " avx2 ") ? 1 : 0;
+  EXPECT_EQ(expected, ceph_arch_intel_avx2);
+
+  expected = strstr(flags, " avx512f ") ? 1 : 0;
+  EXPECT_EQ(expected, ceph_arch_intel_avx512f);
+
+  expected = strstr(flags, " avx512bw ") ? 1 : 0;
+  EXPECT_EQ(expected, ceph_arch_intel_avx512bw);
+
 #endif
 
 #endif
@@ -588,6 +588,18 @@ public:
     ceph_assert(r == 0);
     ASSERT_EQ(snaps, obj->second);
   }
+
+  void check_head_not_mapped() {
+    std::lock_guard l{lock};
+    if (hobject_to_snap.empty())
+      return;
+    hobject_t head = rand_choose(hobject_to_snap)->first;
+    ASSERT_TRUE(SnapMapper::may_be_mapped(head));
+    head.snap = CEPH_NOSNAP;
+    ASSERT_FALSE(SnapMapper::may_be_mapped(head));
+    set<snapid_t> snaps;
+    ASSERT_EQ(-ENOENT, mapper->get_snaps(head, &snaps));
+  }
 };
 
 class SnapMapperTest : public ::testing::Test {
@@ -658,6 +670,17 @@ TEST_F(SnapMapperTest, Simple) {
   get_tester().trim_snap();
 }
 
+TEST_F(SnapMapperTest, HeadNotMapped) {
+  init(1);
+  get_tester().create_snap();
+  for (int i = 0; i < 10; ++i) {
+    get_tester().create_object();
+  }
+  for (int i = 0; i < 10; ++i) {
+    get_tester().check_head_not_mapped();
+  }
+}
+
 TEST_F(SnapMapperTest, More) {
   init(1);
   run();